@@ -0,0 +1,322 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <netdb.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+// Loopback benchmark of socket options (src_socket): HTTP_SERV is started
+// once per variant with the options appended to the given configuration (the
+// last element wins), every connection of -c clients fetches -p for -d
+// seconds. Server closes connection after respond, so each request pays for
+// the handshake and accept, which is what the listener options change.
+
+struct bench_variant{
+  const char *            name;
+  const char *            elements;   // appended to <configuration>
+  bool                    fastopen;   // client sends request in SYN
+};
+
+struct bench_result{
+  std::size_t             requests;
+  std::size_t             failed;
+  std::uint64_t           bytes;
+  std::vector<double>     latencies;  // us, from connect to the end of respond
+};
+
+const bench_variant variants[] = {
+  {"baseline",          "", false},
+  {"listen-backlog",    "<listen-backlog>4096</listen-backlog>", false},
+  {"accept-batch 1",    "<accept-batch>1</accept-batch>", false},
+  {"defer-accept",      "<defer-accept>5</defer-accept>", false},
+  {"TCP-fastopen",      "<TCP-fastopen>256</TCP-fastopen>", true},
+  {"TCP-nodelay",       "<TCP-nodelay>on</TCP-nodelay>", false},
+  {"TCP-cork",          "<TCP-cork>on</TCP-cork>", false},
+  {"buffers",           "<send-buffer>1M</send-buffer><receive-buffer>256K</receive-buffer>", false},
+  {"all",               "<listen-backlog>4096</listen-backlog><defer-accept>5</defer-accept><TCP-fastopen>256</TCP-fastopen>"
+                        "<TCP-nodelay>on</TCP-nodelay><TCP-cork>on</TCP-cork>"
+                        "<send-buffer>1M</send-buffer><receive-buffer>256K</receive-buffer>", true}
+};
+
+void PrintHelp(char * name){
+  std::cerr << "\tUsage: " << name << " [-c concurrency] [-d seconds] [-p path] <HTTP_SERV binary> <configuration file>\n"
+            << "\t  -c  connections in flight (default 16)\n"
+            << "\t  -d  duration of one variant (default 5)\n"
+            << "\t  -p  requested path (default /)\n\n";
+}
+
+// value of the first <name> element, configuration is not validated here: server does it
+std::string ElementOf(const std::string & config, const std::string & name){
+  std::size_t begin = config.find("<" + name + ">");
+  if (begin == config.npos){
+    return std::string();
+  }
+  begin += name.size() + 2;
+  std::size_t end = config.find("</" + name + ">", begin);
+  return end == config.npos ? std::string() : config.substr(begin, end - begin);
+}
+
+bool WriteVariant(const std::string & config, const bench_variant & variant, std::string & pathname){
+  std::size_t end = config.rfind("</configuration>");
+  if (end == config.npos){
+    std::cerr << "Error!!! Configuration file has no </configuration>\n";
+    return false;
+  }
+
+  char name[] = "/tmp/http_bench_XXXXXX.xml";
+  int  fd     = mkstemps(name, 4);
+  if (fd < 0){
+    std::perror("Error!!! Cannot create configuration of variant ");
+    return false;
+  }
+  close(fd);
+
+  std::ofstream file(name);
+  file << config.substr(0, end) << "  " << variant.elements << "\n" << config.substr(end);
+  pathname = name;
+  return static_cast<bool>(file);
+}
+
+pid_t StartServer(const char * binary, const std::string & config){
+  pid_t pid = fork();
+  if (pid != 0){
+    return pid;
+  }
+
+  int null_fd = open("/dev/null", O_RDWR);
+  dup2(null_fd, STDIN_FILENO);
+  dup2(null_fd, STDOUT_FILENO);
+  dup2(null_fd, STDERR_FILENO);
+  execl(binary, binary, config.c_str(), static_cast<char *>(nullptr));
+  _exit(127);
+}
+
+void StopServer(pid_t pid){
+  kill(pid, SIGTERM);
+  for (int i = 0; i < 200; ++i){
+    if (waitpid(pid, nullptr, WNOHANG) == pid){
+      return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  kill(pid, SIGKILL);
+  waitpid(pid, nullptr, 0);
+}
+
+bool WaitListener(const addrinfo * address, pid_t pid){
+  for (int i = 0; i < 1000; ++i){
+    if (waitpid(pid, nullptr, WNOHANG) == pid){
+      return false;
+    }
+    int fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+    if (fd >= 0 && connect(fd, address->ai_addr, address->ai_addrlen) == 0){
+      close(fd);
+      return true;
+    }
+    if (fd >= 0) close(fd);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return false;
+}
+
+// with Fast Open the first part of request goes in SYN once cookie is cached
+bool Exchange(const addrinfo * address, const std::string & request, bool fastopen, std::uint64_t & size){
+  int fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+  if (fd < 0){
+    return false;
+  }
+
+  std::size_t sent = 0;
+  if (fastopen){
+    ssize_t rc = sendto(fd, request.data(), request.size(), MSG_FASTOPEN | MSG_NOSIGNAL, address->ai_addr, address->ai_addrlen);
+    if (rc < 0){
+      close(fd);
+      return false;
+    }
+    sent = rc;
+  }
+  else if (connect(fd, address->ai_addr, address->ai_addrlen) < 0){
+    close(fd);
+    return false;
+  }
+
+  while (sent < request.size()){
+    ssize_t rc = send(fd, request.data() + sent, request.size() - sent, MSG_NOSIGNAL);
+    if (rc < 0){
+      if (errno == EINTR) continue;
+      close(fd);
+      return false;
+    }
+    sent += rc;
+  }
+
+  char    buff[16384];
+  ssize_t rc;
+  while ((rc = recv(fd, buff, sizeof(buff), 0)) != 0){
+    if (rc < 0){
+      if (errno == EINTR) continue;
+      close(fd);
+      return false;
+    }
+    size += rc;
+  }
+  close(fd);
+  return size > 0;
+}
+
+double Percentile(const std::vector<double> & sorted, double p){
+  if (sorted.empty()){
+    return 0;
+  }
+  std::size_t i = std::min(sorted.size() - 1, static_cast<std::size_t>(p / 100.0 * sorted.size()));
+  return sorted[i];
+}
+
+bench_result Load(const addrinfo * address, const std::string & request, bool fastopen,
+                  std::size_t concurrency, double seconds){
+  std::vector<bench_result> results(concurrency, bench_result{0, 0, 0, {}});
+  auto                      stop = std::chrono::steady_clock::now() + std::chrono::duration<double>(seconds);
+
+  std::vector<std::thread> threads;
+  for (std::size_t t = 0; t < concurrency; ++t){
+    threads.emplace_back([&, t](){
+      bench_result & result = results[t];
+      while (std::chrono::steady_clock::now() < stop){
+        std::uint64_t size  = 0;
+        auto          begin = std::chrono::steady_clock::now();
+        if (!Exchange(address, request, fastopen, size)){
+          ++result.failed;
+          continue;
+        }
+        ++result.requests;
+        result.bytes += size;
+        result.latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count());
+      }
+    });
+  }
+  for (auto it = threads.begin(); it != threads.end(); ++it){
+    it->join();
+  }
+
+  bench_result total = {0, 0, 0, {}};
+  for (auto it = results.begin(); it != results.end(); ++it){
+    total.requests += it->requests;
+    total.failed   += it->failed;
+    total.bytes    += it->bytes;
+    total.latencies.insert(total.latencies.end(), it->latencies.begin(), it->latencies.end());
+  }
+  std::sort(total.latencies.begin(), total.latencies.end());
+  return total;
+}
+
+int main(int argc, char * argv[]){
+  std::size_t   concurrency = 16;
+  double        seconds     = 5;
+  std::string   path        = "/";
+  int           arg         = 1;
+
+  for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2){
+    std::string option = argv[arg];
+    if      (option == "-c") concurrency = std::max(1, std::atoi(argv[arg + 1]));
+    else if (option == "-d") seconds     = std::atof(argv[arg + 1]);
+    else if (option == "-p") path        = argv[arg + 1];
+    else{
+      std::cerr << "Error!!! Unknown option " << option << "\n";
+      PrintHelp(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (argc - arg < 2 || seconds <= 0){
+    std::cerr << "Error!!! Too few arguments!\n";
+    PrintHelp(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  std::ifstream file(argv[arg + 1]);
+  if (!file){
+    std::perror((std::string("Error!!! Cannot open configuration file `") + argv[arg + 1] + "` ").c_str());
+    return EXIT_FAILURE;
+  }
+  std::stringstream stream;
+  stream << file.rdbuf();
+  std::string config = stream.str();
+
+  std::string host = ElementOf(config, "IP-address");
+  std::string port = ElementOf(config, "TCP-port");
+
+  addrinfo   hints;
+  addrinfo * address = nullptr;
+  std::memset(&hints, 0, sizeof(hints));
+  hints.ai_family   = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  int rc = getaddrinfo(host.empty() ? "127.0.0.1" : host.c_str(), port.c_str(), &hints, &address);
+  if (rc){
+    std::cerr << "Error!!! Cannot resolve " << host << ":" << port << ": " << gai_strerror(rc) << "\n";
+    return EXIT_FAILURE;
+  }
+
+  // server side of Fast Open is enabled by bit 2 of the sysctl, client side by bit 1
+  std::ifstream sysctl("/proc/sys/net/ipv4/tcp_fastopen");
+  int           tfo = 0;
+  if (sysctl >> tfo && (tfo & 3) != 3){
+    std::cout << "net.ipv4.tcp_fastopen is " << tfo << ": Fast Open falls back to regular handshake, set it to 3 to measure it\n";
+  }
+
+  std::string request = "GET " + path + " HTTP/1.1\r\nHost: " + (host.empty() ? "127.0.0.1" : host) + "\r\n\r\n";
+  bool        failed  = false;
+
+  std::cout << "concurrency: " << concurrency << ", duration: " << seconds << " s, path: " << path << "\n\n";
+
+  for (const bench_variant & variant : variants){
+    std::string pathname;
+    if (!WriteVariant(config, variant, pathname)){
+      failed = true;
+      break;
+    }
+
+    pid_t pid = StartServer(argv[arg], pathname);
+    if (pid < 0 || !WaitListener(address, pid)){
+      std::cerr << "Error!!! Server of variant `" << variant.name << "` is not listening\n";
+      if (pid > 0) StopServer(pid);
+      unlink(pathname.c_str());
+      failed = true;
+      continue;
+    }
+
+    bench_result result = Load(address, request, variant.fastopen, concurrency, seconds);
+    StopServer(pid);
+    unlink(pathname.c_str());
+
+    double mean = 0;
+    for (auto it = result.latencies.begin(); it != result.latencies.end(); ++it){
+      mean += *it;
+    }
+    mean = result.latencies.size() ? mean / result.latencies.size() : 0;
+
+    std::cout << variant.name << ":\n"
+              << "  throughput: " << result.requests / seconds << " req/s, " << result.bytes / seconds / (1 << 20) << " MiB/s, failed: "
+              << result.failed << "\n"
+              << "  latency us: mean " << mean << ", p50 " << Percentile(result.latencies, 50) << ", p90 "
+              << Percentile(result.latencies, 90) << ", p99 " << Percentile(result.latencies, 99)
+              << ", max " << (result.latencies.size() ? result.latencies.back() : 0) << std::endl;
+    failed |= result.failed != 0;
+  }
+  freeaddrinfo(address);
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
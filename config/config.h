@@ -1,10 +1,13 @@
 #pragma once
 
 #include <iostream>
+#include <vector>
 
-#define MAX_LISTENING_CLIENTS (100)
+#define MAX_LISTENING_CLIENTS (100)    //default listen backlog
+#define ACCEPT_BATCH          (64)     //default connections accepted by one wake up of event loop
 
 #define MAX_BUFFER_SIZE       (8192)
+#define REQUEST_ARENA_SIZE    (64 << 10) //per-worker block for request and respond, bigger ones go to heap
 
 #define NO_BLOCKING_POLL      (0)      //non-blocking poll
 #define INFTIM                (-1)     //blocking poll to infinity time
@@ -12,11 +15,97 @@
 
 #define FILE_MIME_TYPES       ("/etc/mime.types")
 
+#define TLS_SESSION_CACHE     (20480)  //default number of cached TLS sessions
+#define TLS_SESSION_TIMEOUT   (300)    //lifetime of cached session/ticket, in seconds
+
+#define HTTP2_MAX_STREAMS     (100)    //default SETTINGS_MAX_CONCURRENT_STREAMS
+#define HTTP2_IDLE_TIMEOUT    (30)     //default: HTTP/2 connection without frames is closed, in seconds
+
+#define CACHE_SIZE            (64 << 20) //default memory budget of content cache, in bytes
+#define CACHE_MAX_FILE_SIZE   (1 << 20)  //bigger files are only indexed, body is sent from file
+#define WARMUP_MAX_FILE_SIZE  (64 << 10) //files up to this size are preloaded by warmup
+#define WARMUP_HOT_PATHS      (1024)     //number of paths saved to hot list
+#define GETDENTS_BUFFER_SIZE  (32768)    //batch of directory entries read by one getdents64
+
+#define ZEROCOPY_THRESHOLD    (64 << 10) //shared bodies from this size are sent by MSG_ZEROCOPY
+
+#define TRACE_RING_SIZE       (256)              //default number of kept sampled request timelines
+#define TRACE_ENDPOINT        ("/server-trace")  //default path of sampled timelines, JSON
+
+#define INDEX_FILE            ("index.html")     //default file which answers for its directory
+#define AUTOINDEX_PAGE_SIZE   (500)              //default number of entries on one page of listing
+
+// site served for its names in Host header, it has its own cache budget
+struct virtual_host_info{
+  std::vector<std::string> names;         // lowercased, the first one is primary
+  std::string     root_path;
+  std::size_t     cache_size;             // files of other hosts never evict files of this one
+  std::size_t     cache_max_file_size;
+  std::uint32_t   http2_idle_timeout;     // applied to HTTP/2 connection from its first request to host
+};
+
 struct parse_info{
   std::string     config_path;
   std::string     ip;
   std::string     root_path;
-  std::uint32_t   number_workers;
+  std::string     bundle_path;            // packed root directory, is searched before root_path
+  std::uint32_t   number_workers;         // at start, pool resizes itself between min and max
+  std::uint32_t   min_workers;
+  std::uint32_t   max_workers;
   std::uint16_t   port;
   bool            is_ipv4;
+
+  std::uint16_t   tls_port;               // 0 - HTTPS listener is disabled
+  std::string     tls_certificate;
+  std::string     tls_private_key;
+  std::uint32_t   tls_session_cache;      // 0 - server side session cache is disabled
+  std::uint32_t   tls_session_timeout;
+  bool            tls_session_tickets;
+  bool            tls_kernel_offload;     // hand symmetric crypto to kernel TLS (kTLS)
+
+  bool            http2;                  // h2 over TLS (ALPN) and h2c with prior knowledge
+  std::uint32_t   http2_max_streams;
+  std::uint32_t   http2_idle_timeout;
+  std::uint32_t   http2_max_connections;  // h2 connections which hold pool workers at once, 0 - half of max-workers
+
+  std::size_t     cache_size;             // 0 - content cache is disabled
+  std::size_t     cache_max_file_size;
+
+  bool            warmup;                 // walk root directory at start and preload files to cache
+  std::uint32_t   warmup_threads;
+  std::size_t     warmup_max_file_size;
+  std::string     warmup_hot_list;        // paths requested most by previous run
+  std::string     warmup_ready_file;      // is created when warmup is completed
+
+  std::vector<int> worker_cpus;           // empty - workers are not pinned
+  std::vector<int> reactor_cpus;          // cpus of thread which polls and accepts
+  bool            numa_local;             // cache shard per NUMA node, used by workers of this node
+  bool            incoming_cpu;           // steer connection to workers of node which received it
+  bool            numa_report;            // count local/cross-node requests, printed by SIGUSR2
+
+  std::size_t     zerocopy_threshold;     // 0 - MSG_ZEROCOPY is not used
+
+  std::uint32_t   prefork_processes;      // 0 - one process with thread pool
+  std::size_t     prefork_shared_cache;   // content cache shared by worker processes, 0 - disabled
+
+  std::uint32_t   trace_sample_rate;      // timeline of 1 of N requests, 0 - sampling is disabled
+  std::uint32_t   trace_ring_size;
+  std::string     trace_endpoint;         // served when sampling is enabled, to loopback clients of default host
+
+  std::string     capture_file;           // binary log of requests for HTTP_REPLAY, empty - no capture
+
+  std::uint32_t   listen_backlog;
+  std::uint32_t   defer_accept;           // seconds listener waits for request after handshake, 0 - off
+  std::uint32_t   tcp_fastopen;           // queue of Fast Open requests, 0 - off
+  bool            tcp_nodelay;
+  bool            tcp_cork;               // header and body of respond are coalesced into full segments
+  std::size_t     send_buffer;            // 0 - kernel autotuning
+  std::size_t     receive_buffer;
+  std::uint32_t   accept_batch;
+
+  std::string     index_file;             // empty - directory is never answered by a file
+  bool            autoindex;              // listing of directory without index file, otherwise 403
+  std::size_t     autoindex_page_size;    // entries on one page of listing
+
+  std::vector<virtual_host_info> virtual_hosts; // requests for other hosts are served from root_path
 };
\ No newline at end of file
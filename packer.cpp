@@ -0,0 +1,275 @@
+#include <bundle.h>
+#include <content_cache.h>
+#include <config.h>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <vector>
+#include <map>
+#include <set>
+
+#include <dirent.h>
+#include <time.h>
+#include <zlib.h>
+
+// Offline packer of root directory into bundle for <bundle-path>.
+// Headers are formed the same way as HTTP_Server forms them.
+
+struct pack_file{
+  std::string           path;     // relative to root
+  struct stat           _stat;
+  std::string           headers;
+  std::string           gzip_headers;
+  std::vector<uint8_t>  gzip;
+};
+
+std::map<std::string, std::string> extension_mime;
+
+void PrintHelp(char * name){
+  std::cerr << "\tUsage: " << name << " [-z] <root directory> <output bundle>\n"
+            << "\t  -z  add gzip variant for files which compress well\n\n";
+}
+
+void LoadMimeTypes(){
+  std::ifstream types(FILE_MIME_TYPES);
+  std::string   line;
+
+  while (std::getline(types, line)){
+    if (line.empty() || line[0] == '#'){
+      continue;
+    }
+
+    std::istringstream fields(line);
+    std::string        type, ext;
+    fields >> type;
+    while (fields >> ext){
+      extension_mime[ext] = type;
+    }
+  }
+}
+
+// symlinked directories are followed, `parents` (device, inode) of the
+// current path stop a symlink which leads back to one of them
+void Walk(const std::string & root, const std::string & relative, std::set<std::pair<dev_t, ino_t>> & parents,
+          std::vector<pack_file> & files){
+  DIR * dir = opendir((root + relative).c_str());
+  if (!dir){
+    std::perror(("Error!!! Cannot open directory `" + root + relative + "` ").c_str());
+    return;
+  }
+
+  struct stat _stat;
+  if (fstat(dirfd(dir), &_stat) < 0 || !parents.insert(std::make_pair(_stat.st_dev, _stat.st_ino)).second){
+    std::cerr << "Warning!!! Directory `" << root + relative << "` is a symlink cycle, it is skipped.\n";
+    closedir(dir);
+    return;
+  }
+
+  while (dirent * entry = readdir(dir)){
+    std::string name = entry->d_name;
+    if (name == "." || name == ".."){
+      continue;
+    }
+
+    pack_file file;
+    file.path = relative + name;
+
+    if (stat((root + file.path).c_str(), &file._stat) < 0){
+      continue;
+    }
+
+    if (S_ISDIR(file._stat.st_mode)){
+      Walk(root, file.path + '/', parents, files);
+    }
+    else if (S_ISREG(file._stat.st_mode)){
+      files.push_back(file);
+    }
+  }
+
+  parents.erase(std::make_pair(_stat.st_dev, _stat.st_ino));
+  closedir(dir);
+}
+
+std::string HttpDate(const timespec & ts){
+  tm    t;
+  char  buf[80];
+
+  localtime_r(&ts.tv_sec, &t);
+  strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S %Z\n", &t);
+  return buf;
+}
+
+std::string ContentType(const std::string & path){
+  const char * extension = std::strrchr(path.c_str(), '.');
+
+  if (extension && *++extension){
+    auto it_type = extension_mime.find(extension);
+    if (it_type != extension_mime.end()){
+      return it_type->second;
+    }
+  }
+  return "";
+}
+
+bool IsCompressible(const std::string & type){
+  return type.compare(0, 5, "text/") == 0 || type.find("javascript") != type.npos || type.find("json") != type.npos ||
+         type.find("xml") != type.npos || type.find("svg") != type.npos;
+}
+
+bool Gzip(const std::vector<uint8_t> & src, std::vector<uint8_t> & dst){
+  z_stream stream;
+  std::memset(&stream, 0, sizeof(stream));
+
+  if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK){
+    return false;
+  }
+
+  dst.resize(deflateBound(&stream, src.size()));
+
+  stream.next_in   = const_cast<uint8_t *>(src.data());
+  stream.avail_in  = src.size();
+  stream.next_out  = dst.data();
+  stream.avail_out = dst.size();
+
+  int rc = deflate(&stream, Z_FINISH);
+  dst.resize(stream.total_out);
+  deflateEnd(&stream);
+
+  return rc == Z_STREAM_END;
+}
+
+bool ReadFile(const std::string & pathname, std::vector<uint8_t> & dst){
+  std::ifstream file(pathname, std::ios::binary);
+  dst.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  return !file.bad();
+}
+
+int main(int argc, char * argv[]){
+  bool  with_gzip = false;
+  int   arg       = 1;
+
+  if (argc > arg && std::string(argv[arg]) == "-z"){
+    with_gzip = true;
+    ++arg;
+  }
+
+  if (argc - arg < 2){
+    std::cerr << "Error!!! Too few arguments!\n";
+    PrintHelp(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  std::string root   = argv[arg];
+  std::string output = argv[arg + 1];
+  if (root[root.size() - 1] != '/'){
+    root.push_back('/');
+  }
+
+  LoadMimeTypes();
+
+  std::vector<pack_file>              files;
+  std::set<std::pair<dev_t, ino_t>>   parents;
+  Walk(root, "", parents, files);
+
+  // index is searched by binary search
+  std::sort(files.begin(), files.end(), [](const pack_file & a, const pack_file & b){ return a.path < b.path; });
+
+  bundle_header header;
+  std::memcpy(header.magic, BUNDLE_MAGIC, sizeof(header.magic));
+  header.version      = BUNDLE_VERSION;
+  header.count        = files.size();
+  header.index_offset = sizeof(bundle_header);
+
+  std::vector<bundle_entry> index(files.size());
+  std::uint64_t             offset = header.index_offset + files.size() * sizeof(bundle_entry);
+
+  // first pass: headers and gzip variants, offsets of everything
+  for (std::size_t i = 0; i < files.size(); ++i){
+    pack_file &    file  = files[i];
+    bundle_entry & entry = index[i];
+    std::string    etag;
+    std::string    type  = ContentType(file.path);
+
+    Content_Cache::MakeETag(file._stat.st_mtim, file._stat.st_size, etag);
+
+    std::string common = "Last-Modified: " + HttpDate(file._stat.st_mtim);
+
+    file.headers = common + "ETag: " + etag + "\nServer: YP\nContent-Length: " + std::to_string(file._stat.st_size) +
+                   "\nContent-Type: " + type + "\n\n";
+
+    if (with_gzip && IsCompressible(type)){
+      std::vector<uint8_t> body;
+      if (ReadFile(root + file.path, body) && Gzip(body, file.gzip) && file.gzip.size() < body.size() * 9 / 10){
+        file.gzip_headers = common + "ETag: " + etag.substr(0, etag.size() - 1) + "-gzip\"\nServer: YP\nContent-Length: " +
+                            std::to_string(file.gzip.size()) + "\nContent-Type: " + type +
+                            "\nContent-Encoding: gzip\nVary: Accept-Encoding\n\n";
+      }
+      else{
+        file.gzip.clear();
+      }
+    }
+
+    std::memset(&entry, 0, sizeof(entry));
+
+    entry.path_offset         = offset;
+    entry.path_size           = file.path.size();
+    offset                   += entry.path_size;
+
+    entry.headers_offset      = offset;
+    entry.headers_size        = file.headers.size();
+    offset                   += entry.headers_size;
+
+    entry.gzip_headers_offset = offset;
+    entry.gzip_headers_size   = file.gzip_headers.size();
+    offset                   += entry.gzip_headers_size;
+
+    entry.gzip_offset         = offset;
+    entry.gzip_size           = file.gzip.size();
+    offset                   += entry.gzip_size;
+
+    entry.body_offset         = offset;
+    entry.body_size           = file._stat.st_size;
+    offset                   += entry.body_size;
+  }
+
+  std::ofstream bundle(output, std::ios::binary | std::ios::trunc);
+  if (!bundle){
+    std::perror(("Error!!! Cannot create bundle `" + output + "` ").c_str());
+    return EXIT_FAILURE;
+  }
+
+  bundle.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  bundle.write(reinterpret_cast<const char *>(index.data()), index.size() * sizeof(bundle_entry));
+
+  // second pass: data in the same order as offsets were given
+  std::uint64_t gzip_files = 0;
+  for (std::size_t i = 0; i < files.size(); ++i){
+    pack_file &          file = files[i];
+    std::vector<uint8_t> body;
+
+    if (!ReadFile(root + file.path, body) || body.size() != index[i].body_size){
+      std::cerr << "Error!!! File `" << root + file.path << "` was changed while packing!\n";
+      return EXIT_FAILURE;
+    }
+
+    bundle.write(file.path.data(), file.path.size());
+    bundle.write(file.headers.data(), file.headers.size());
+    bundle.write(file.gzip_headers.data(), file.gzip_headers.size());
+    bundle.write(reinterpret_cast<const char *>(file.gzip.data()), file.gzip.size());
+    bundle.write(reinterpret_cast<const char *>(body.data()), body.size());
+
+    gzip_files += !file.gzip.empty();
+  }
+
+  if (!bundle){
+    std::perror(("Error!!! Cannot write bundle `" + output + "` ").c_str());
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Packed " << files.size() << " files (" << gzip_files << " with gzip variant) into `" << output
+            << "`, " << offset << " bytes\n";
+
+  return EXIT_SUCCESS;
+}
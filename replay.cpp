@@ -0,0 +1,250 @@
+#include <capture.h>
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <vector>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+// Replay of capture file (<capture-file>) against running HTTP_SERV: requests
+// go at their original pace (scaled by -s) from -c connections at most, every
+// respond is compared by status and size with the captured one.
+
+struct replay_request{
+  capture_record          record;
+  std::string             bytes;
+};
+
+struct replay_result{
+  bool                    done;       // respond was received
+  std::uint16_t           status;
+  std::uint64_t           size;
+  double                  latency_us; // from connect to the end of respond
+};
+
+void PrintHelp(char * name){
+  std::cerr << "\tUsage: " << name << " [-s speed] [-c concurrency] [-n number] <capture file> <host> <port>\n"
+            << "\t  -s  pace of capture is multiplied by it, 0 - as fast as possible (default 1)\n"
+            << "\t  -c  requests in flight at most (default 16)\n"
+            << "\t  -n  replay only first number requests\n\n";
+}
+
+bool LoadCapture(const std::string & pathname, std::vector<replay_request> & requests){
+  std::ifstream file(pathname, std::ios::binary);
+  if (!file){
+    std::perror(("Error!!! Cannot open capture file `" + pathname + "` ").c_str());
+    return false;
+  }
+
+  capture_header header;
+  if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+      std::memcmp(header.magic, CAPTURE_MAGIC, sizeof(header.magic)) || header.version != CAPTURE_VERSION){
+    std::cerr << "Error!!! `" << pathname << "` is not a capture file of version " << CAPTURE_VERSION << "\n";
+    return false;
+  }
+
+  replay_request request;
+  while (file.read(reinterpret_cast<char *>(&request.record), sizeof(request.record))){
+    request.bytes.resize(request.record.request_size);
+    if (!file.read(&request.bytes[0], request.bytes.size())){
+      std::cerr << "Warning! Capture file is truncated, the last record is dropped.\n";
+      break;
+    }
+    requests.push_back(request);
+  }
+
+  // worker processes flush their batches in any order
+  std::stable_sort(requests.begin(), requests.end(), [](const replay_request & a, const replay_request & b){
+    return a.record.time_ns < b.record.time_ns;
+  });
+  return true;
+}
+
+// server closes connection after respond, so respond is everything up to EOF
+bool Exchange(const addrinfo * address, const std::string & request, replay_result & result){
+  int fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+  if (fd < 0){
+    return false;
+  }
+  if (connect(fd, address->ai_addr, address->ai_addrlen) < 0){
+    close(fd);
+    return false;
+  }
+
+  std::size_t sent = 0;
+  while (sent < request.size()){
+    ssize_t rc = send(fd, request.data() + sent, request.size() - sent, MSG_NOSIGNAL);
+    if (rc < 0){
+      if (errno == EINTR) continue;
+      close(fd);
+      return false;
+    }
+    sent += rc;
+  }
+
+  char    buff[16384];
+  char    head[16] = {0};
+  ssize_t rc;
+  while ((rc = recv(fd, buff, sizeof(buff), 0)) != 0){
+    if (rc < 0){
+      if (errno == EINTR) continue;
+      close(fd);
+      return false;
+    }
+    if (result.size < sizeof(head) - 1){
+      std::memcpy(head + result.size, buff, std::min<std::size_t>(rc, sizeof(head) - 1 - result.size));
+    }
+    result.size += rc;
+  }
+  close(fd);
+
+  result.status = result.size > 9 ? std::strtoul(head + 9, nullptr, 10) : 0;
+  return true;
+}
+
+double Percentile(const std::vector<double> & sorted, double p){
+  if (sorted.empty()){
+    return 0;
+  }
+  std::size_t i = std::min(sorted.size() - 1, static_cast<std::size_t>(p / 100.0 * sorted.size()));
+  return sorted[i];
+}
+
+std::string RequestLine(const std::string & bytes){
+  std::size_t end = bytes.find_first_of("\r\n");
+  return bytes.substr(0, std::min<std::size_t>(end, 80));
+}
+
+int main(int argc, char * argv[]){
+  double        speed       = 1;
+  std::size_t   concurrency = 16;
+  std::size_t   limit       = 0;
+  int           arg         = 1;
+
+  for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2){
+    std::string option = argv[arg];
+    if      (option == "-s") speed       = std::atof(argv[arg + 1]);
+    else if (option == "-c") concurrency = std::max(1, std::atoi(argv[arg + 1]));
+    else if (option == "-n") limit       = std::atoll(argv[arg + 1]);
+    else{
+      std::cerr << "Error!!! Unknown option " << option << "\n";
+      PrintHelp(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (argc - arg < 3 || speed < 0){
+    std::cerr << "Error!!! Too few arguments!\n";
+    PrintHelp(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  std::vector<replay_request> requests;
+  if (!LoadCapture(argv[arg], requests)){
+    return EXIT_FAILURE;
+  }
+  if (limit && limit < requests.size()){
+    requests.resize(limit);
+  }
+  if (requests.empty()){
+    std::cerr << "Capture file has no requests.\n";
+    return EXIT_SUCCESS;
+  }
+
+  addrinfo   hints;
+  addrinfo * address = nullptr;
+  std::memset(&hints, 0, sizeof(hints));
+  hints.ai_family   = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  int rc = getaddrinfo(argv[arg + 1], argv[arg + 2], &hints, &address);
+  if (rc){
+    std::cerr << "Error!!! Cannot resolve " << argv[arg + 1] << ": " << gai_strerror(rc) << "\n";
+    return EXIT_FAILURE;
+  }
+
+  std::vector<replay_result>  results(requests.size(), replay_result{false, 0, 0, 0});
+  std::atomic<std::size_t>    next(0);
+  std::uint64_t               first_ns = requests.front().record.time_ns;
+  auto                        start    = std::chrono::steady_clock::now();
+
+  // every thread is one connection in flight: it takes the next request and waits for its time
+  std::vector<std::thread> threads;
+  for (std::size_t t = 0; t < std::min(concurrency, requests.size()); ++t){
+    threads.emplace_back([&](){
+      for (std::size_t i = next++; i < requests.size(); i = next++){
+        if (speed > 0){
+          auto offset = std::chrono::nanoseconds(static_cast<std::int64_t>((requests[i].record.time_ns - first_ns) / speed));
+          std::this_thread::sleep_until(start + offset);
+        }
+
+        replay_result & result = results[i];
+        auto            begin  = std::chrono::steady_clock::now();
+        result.done       = Exchange(address, requests[i].bytes, result);
+        result.latency_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count();
+      }
+    });
+  }
+  for (auto it = threads.begin(); it != threads.end(); ++it){
+    it->join();
+  }
+
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  freeaddrinfo(address);
+
+  std::vector<double>                   latencies;
+  std::map<std::uint16_t, std::size_t>  statuses;
+  std::uint64_t                         bytes = 0;
+  std::size_t                           failed = 0, status_diff = 0, size_diff = 0, printed = 0;
+
+  for (std::size_t i = 0; i < requests.size(); ++i){
+    const capture_record & record = requests[i].record;
+    const replay_result &  result = results[i];
+
+    if (!result.done){
+      ++failed;
+      continue;
+    }
+
+    latencies.push_back(result.latency_us);
+    bytes += result.size;
+    ++statuses[result.status];
+
+    bool status_differs = result.status != record.status;
+    bool size_differs   = result.size   != record.response_size;
+    status_diff += status_differs;
+    size_diff   += size_differs;
+
+    if ((status_differs || size_differs) && printed++ < 10){
+      std::cout << "diff: `" << RequestLine(requests[i].bytes) << "` captured " << record.status << "/" << record.response_size
+                << " bytes, replayed " << result.status << "/" << result.size << " bytes\n";
+    }
+  }
+  std::sort(latencies.begin(), latencies.end());
+
+  double mean = 0;
+  for (auto it = latencies.begin(); it != latencies.end(); ++it){
+    mean += *it;
+  }
+  mean = latencies.size() ? mean / latencies.size() : 0;
+
+  std::cout << "\nrequests: " << requests.size() << ", failed: " << failed << ", elapsed: " << elapsed << " s\n"
+            << "throughput: " << latencies.size() / elapsed << " req/s, " << bytes / elapsed / (1 << 20) << " MiB/s\n"
+            << "latency us: mean " << mean << ", p50 " << Percentile(latencies, 50) << ", p90 " << Percentile(latencies, 90)
+            << ", p99 " << Percentile(latencies, 99) << ", p99.9 " << Percentile(latencies, 99.9)
+            << ", max " << (latencies.size() ? latencies.back() : 0) << "\n"
+            << "status:";
+  for (auto it = statuses.begin(); it != statuses.end(); ++it){
+    std::cout << " " << it->first << "x" << it->second;
+  }
+  std::cout << "\ndiffers from capture: status " << status_diff << ", size " << size_diff << std::endl;
+
+  return (failed || status_diff) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -1,8 +1,6 @@
 #include <http_server.h>
 #include <iostream>
 
-HTTP_Server * server;  // global for SIGUSR1 handler
-
 void PrintHelp(char * name){
   std::cerr << "\tUsage: %s <name xml configuration file>\n\n";
 }
@@ -14,7 +12,7 @@ int main(int argc, char * argv[]){
     return EXIT_FAILURE;
   }
 
-  server = new HTTP_Server(argv[1]);
+  HTTP_Server * server = new HTTP_Server(argv[1]);
   server->Run();
 
   delete server;
@@ -0,0 +1,87 @@
+#include <request_arena.h>
+
+#include <cstring>
+#include <cstdlib>
+#include <new>
+#include <algorithm>
+
+Request_Arena::Request_Arena(std::size_t size) :
+  block(new char[size]), block_size(size), resource(block.get(), block_size, &upstream){
+  std::memset(block.get(), 0, block_size);
+}
+
+void * Request_Arena::Overflow_Resource::do_allocate(std::size_t bytes, std::size_t alignment){
+  ++overflows;
+  return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+
+void Request_Arena::Overflow_Resource::do_deallocate(void * p, std::size_t bytes, std::size_t alignment){
+  std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+}
+
+#ifdef HTTP_SERVER_ALLOC_STATS
+
+// every global operator new is counted per thread, worker reports the difference per request
+namespace{
+  thread_local std::uint64_t heap_allocations = 0;
+}
+
+std::uint64_t Request_Arena::HeapAllocations(){
+  return heap_allocations;
+}
+
+void * operator new(std::size_t size){
+  ++heap_allocations;
+  if (void * p = std::malloc(size ? size : 1)){
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void * operator new[](std::size_t size){
+  return operator new(size);
+}
+
+void * operator new(std::size_t size, const std::nothrow_t &) noexcept{
+  ++heap_allocations;
+  return std::malloc(size ? size : 1);
+}
+
+void * operator new[](std::size_t size, const std::nothrow_t & tag) noexcept{
+  return operator new(size, tag);
+}
+
+// over-aligned types (and pmr resources asked for such alignment) come here
+void * operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept{
+  ++heap_allocations;
+  void * p = nullptr;
+  std::size_t align = std::max(static_cast<std::size_t>(alignment), sizeof(void *));
+  return posix_memalign(&p, align, size ? size : 1) ? nullptr : p;
+}
+
+void * operator new(std::size_t size, std::align_val_t alignment){
+  if (void * p = operator new(size, alignment, std::nothrow)){
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void * operator new[](std::size_t size, std::align_val_t alignment){
+  return operator new(size, alignment);
+}
+
+void * operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t & tag) noexcept{
+  return operator new(size, alignment, tag);
+}
+
+void operator delete(void * p) noexcept                     { std::free(p); }
+void operator delete[](void * p) noexcept                   { std::free(p); }
+void operator delete(void * p, std::size_t) noexcept        { std::free(p); }
+void operator delete[](void * p, std::size_t) noexcept      { std::free(p); }
+
+void operator delete(void * p, std::align_val_t) noexcept                     { std::free(p); }
+void operator delete[](void * p, std::align_val_t) noexcept                   { std::free(p); }
+void operator delete(void * p, std::size_t, std::align_val_t) noexcept        { std::free(p); }
+void operator delete[](void * p, std::size_t, std::align_val_t) noexcept      { std::free(p); }
+
+#endif
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <memory_resource>
+#include <cstdint>
+
+// containers of request path, they take memory from arena of worker
+typedef std::pmr::vector<uint8_t>   byte_buffer;
+typedef std::pmr::string            arena_string;
+
+// Bump allocator of one worker: everything which is built for a request is
+// taken from preallocated block and dropped at once by Reset after respond.
+// Requests bigger than the block continue in heap (counted as overflows).
+class Request_Arena : public std::pmr::memory_resource{
+
+    class Overflow_Resource : public std::pmr::memory_resource{
+      public:
+        std::uint64_t overflows = 0;
+
+      private:
+        void *  do_allocate   (std::size_t bytes, std::size_t alignment) override;
+        void    do_deallocate (void * p, std::size_t bytes, std::size_t alignment) override;
+        bool    do_is_equal   (const std::pmr::memory_resource & other) const noexcept override { return this == &other; }
+    };
+
+    std::unique_ptr<char[]>               block;
+    std::size_t                           block_size;
+    Overflow_Resource                     upstream;
+    std::pmr::monotonic_buffer_resource   resource;
+
+    void *  do_allocate   (std::size_t bytes, std::size_t alignment) override { return resource.allocate(bytes, alignment); }
+    void    do_deallocate (void *, std::size_t, std::size_t) override {}
+    bool    do_is_equal   (const std::pmr::memory_resource & other) const noexcept override { return this == &other; }
+
+  public:
+
+    Request_Arena() = delete;
+    Request_Arena(const Request_Arena &) = delete;
+
+    // block is allocated and touched by calling thread, so pinned worker gets it on its own node
+    explicit Request_Arena(std::size_t size);
+
+    void                  Reset       () { resource.release(); }
+    std::uint64_t         Overflows   () const { return upstream.overflows; }
+
+#ifdef HTTP_SERVER_ALLOC_STATS
+    // global heap allocations made by calling thread since its start
+    static std::uint64_t  HeapAllocations();
+#endif
+};
@@ -0,0 +1,327 @@
+#include <autoindex.h>
+
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include <config.h>
+
+namespace {
+  struct linux_dirent64{
+    ino64_t         d_ino;
+    off64_t         d_off;
+    unsigned short  d_reclen;
+    unsigned char   d_type;
+    char            d_name[];
+  };
+
+  const char * sort_names[SORT_KEYS] = {"name", "size", "mtime"};
+
+  void AppendHTML(std::string & dst, std::string_view text){
+    for (auto it = text.begin(); it != text.end(); ++it){
+      switch (*it){
+        case '&':  dst.append("&amp;");  break;
+        case '<':  dst.append("&lt;");   break;
+        case '>':  dst.append("&gt;");   break;
+        case '"':  dst.append("&quot;"); break;
+        case '\'': dst.append("&#39;");  break;
+        default:   dst.push_back(*it);
+      }
+    }
+  }
+
+  void AppendJSON(std::string & dst, std::string_view text){
+    char buff[8];
+    for (auto it = text.begin(); it != text.end(); ++it){
+      unsigned char c = *it;
+      if (c == '"' || c == '\\'){
+        dst.push_back('\\');
+        dst.push_back(c);
+      }
+      else if (c < 0x20){
+        snprintf(buff, sizeof(buff), "\\u%04x", c);
+        dst.append(buff);
+      }
+      else{
+        dst.push_back(c);
+      }
+    }
+  }
+
+  // every byte except unreserved ones, so name is one path segment
+  void AppendURI(std::string & dst, std::string_view text){
+    static const char hex[] = "0123456789ABCDEF";
+    for (auto it = text.begin(); it != text.end(); ++it){
+      unsigned char c = *it;
+      if (std::isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~'){
+        dst.push_back(c);
+      }
+      else{
+        dst.push_back('%');
+        dst.push_back(hex[c >> 4]);
+        dst.push_back(hex[c & 15]);
+      }
+    }
+  }
+
+  void AppendTime(std::string & dst, std::int64_t seconds){
+    char   buff[32];
+    time_t t = seconds;
+    tm     tstruct;
+    gmtime_r(&t, &tstruct);
+    strftime(buff, sizeof(buff), "%Y-%m-%d %H:%M", &tstruct);
+    dst.append(buff);
+  }
+}
+
+Directory_Index::Directory_Index(std::size_t _page_size) : page_size(std::max<std::size_t>(_page_size, 1)), clock(0){
+}
+
+listing_query Directory_Index::ParseQuery(std::string_view query){
+  listing_query result = {false, SORT_NAME, false, 1};
+
+  while (query.size()){
+    std::size_t      end   = query.find('&');
+    std::string_view param = query.substr(0, end);
+    query.remove_prefix(end == query.npos ? query.size() : end + 1);
+
+    std::size_t      eq    = param.find('=');
+    std::string_view name  = param.substr(0, eq);
+    std::string_view value = eq == param.npos ? std::string_view() : param.substr(eq + 1);
+
+    if (name == "format"){
+      result.json = value == "json";
+    }
+    else if (name == "sort"){
+      for (int key = 0; key < SORT_KEYS; ++key){
+        if (value == sort_names[key]) result.sort = static_cast<listing_sort>(key);
+      }
+    }
+    else if (name == "order"){
+      result.descending = value == "desc";
+    }
+    else if (name == "page"){
+      long page   = std::strtol(std::string(value).c_str(), nullptr, 10);
+      result.page = page > 0 ? page : 1;
+    }
+  }
+  return result;
+}
+
+// hidden entries are not listed
+std::shared_ptr<Directory_Index::listing> Directory_Index::Scan(const std::string & directory, const timespec & mtime){
+  int dir_fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (dir_fd < 0){
+    return nullptr;
+  }
+
+  std::shared_ptr<listing> dir = std::make_shared<listing>();
+  dir->mtime = mtime;
+  dir->used  = clock.load();
+
+  alignas(linux_dirent64) char buf[GETDENTS_BUFFER_SIZE];
+
+  long rc;
+  while ((rc = syscall(SYS_getdents64, dir_fd, buf, sizeof(buf))) > 0){
+    for (long pos = 0; pos < rc;){
+      linux_dirent64 * dirent = reinterpret_cast<linux_dirent64 *>(buf + pos);
+      pos += dirent->d_reclen;
+
+      if (dirent->d_name[0] == '.'){
+        continue;
+      }
+
+      // links are shown as their targets, broken ones are skipped
+      struct stat _stat = {0};
+      if (fstatat(dir_fd, dirent->d_name, &_stat, 0) < 0){
+        continue;
+      }
+
+      listing_entry entry;
+      entry.name   = dirent->d_name;
+      entry.is_dir = S_ISDIR(_stat.st_mode);
+      entry.size   = entry.is_dir ? 0 : _stat.st_size;
+      entry.mtime  = _stat.st_mtim.tv_sec;
+      dir->entries.push_back(std::move(entry));
+    }
+  }
+  close(dir_fd);
+
+  if (rc < 0){
+    return nullptr;
+  }
+  return dir;
+}
+
+// directories go before files, name breaks ties; descending listing is read backwards
+const std::vector<std::uint32_t> & Directory_Index::Order(listing & dir, listing_sort sort){
+  std::vector<std::uint32_t> & order = dir.orders[sort];
+  if (order.size() == dir.entries.size()){
+    return order;
+  }
+
+  order.resize(dir.entries.size());
+  for (std::size_t i = 0; i < order.size(); ++i){
+    order[i] = i;
+  }
+
+  const std::vector<listing_entry> & entries = dir.entries;
+  std::sort(order.begin(), order.end(), [&entries, sort](std::uint32_t a, std::uint32_t b){
+    const listing_entry & x = entries[a];
+    const listing_entry & y = entries[b];
+    if (x.is_dir != y.is_dir) return x.is_dir;
+    if (sort == SORT_SIZE  && x.size  != y.size)  return x.size  < y.size;
+    if (sort == SORT_MTIME && x.mtime != y.mtime) return x.mtime < y.mtime;
+    return x.name < y.name;
+  });
+  return order;
+}
+
+listing_page Directory_Index::Render(listing & dir, std::string_view uri, const listing_query & query){
+  const std::vector<std::uint32_t> & order = Order(dir, query.sort);
+
+  std::size_t pages = std::max<std::size_t>(1, (order.size() + page_size - 1) / page_size);
+  std::size_t page  = std::min(query.page, pages);
+  std::size_t first = (page - 1) * page_size;
+  std::size_t last  = std::min(order.size(), first + page_size);
+
+  std::shared_ptr<std::string> dst = std::make_shared<std::string>();
+  char buff[160];
+
+  auto entry_at = [&](std::size_t i) -> const listing_entry & {
+    return dir.entries[order[query.descending ? order.size() - 1 - i : i]];
+  };
+
+  if (query.json){
+    dst->append("{\"path\":\"");
+    AppendJSON(*dst, uri);
+    snprintf(buff, sizeof(buff), "\",\"total\":%zu,\"page\":%zu,\"pages\":%zu,\"sort\":\"%s\",\"order\":\"%s\",\"entries\":[",
+             order.size(), page, pages, sort_names[query.sort], query.descending ? "desc" : "asc");
+    dst->append(buff);
+
+    for (std::size_t i = first; i < last; ++i){
+      const listing_entry & entry = entry_at(i);
+      dst->append(i == first ? "{\"name\":\"" : ",{\"name\":\"");
+      AppendJSON(*dst, entry.name);
+      snprintf(buff, sizeof(buff), "\",\"type\":\"%s\",\"size\":%llu,\"mtime\":%lld}", entry.is_dir ? "dir" : "file",
+               static_cast<unsigned long long>(entry.size), static_cast<long long>(entry.mtime));
+      dst->append(buff);
+    }
+    dst->append("]}\n");
+    return dst;
+  }
+
+  std::string title;
+  AppendHTML(title, uri);
+
+  dst->append("<!DOCTYPE html>\n<html>\n<head><meta charset=\"utf-8\"><title>Index of ").append(title)
+      .append("</title></head>\n<body>\n<h1>Index of ").append(title).append("</h1>\n<table>\n<tr>");
+
+  // header links sort by the column, the current column switches its order
+  for (int key = 0; key < SORT_KEYS; ++key){
+    bool desc = key == query.sort && !query.descending;
+    snprintf(buff, sizeof(buff), "<th><a href=\"?sort=%s&amp;order=%s\">%s</a></th>", sort_names[key], desc ? "desc" : "asc", sort_names[key]);
+    dst->append(buff);
+  }
+  dst->append("</tr>\n");
+  if (uri != "/"){
+    dst->append("<tr><td><a href=\"../\">../</a></td><td></td><td></td></tr>\n");
+  }
+
+  for (std::size_t i = first; i < last; ++i){
+    const listing_entry & entry = entry_at(i);
+    dst->append("<tr><td><a href=\"");
+    AppendURI(*dst, entry.name);
+    dst->append(entry.is_dir ? "/\">" : "\">");
+    AppendHTML(*dst, entry.name);
+    dst->append(entry.is_dir ? "/</a></td><td>-" : "</a></td><td>");
+    if (!entry.is_dir){
+      dst->append(std::to_string(entry.size));
+    }
+    dst->append("</td><td>");
+    AppendTime(*dst, entry.mtime);
+    dst->append("</td></tr>\n");
+  }
+  dst->append("</table>\n");
+
+  if (pages > 1){
+    dst->append("<p>");
+    for (std::size_t link : {page - 1, page + 1}){
+      if (link < 1 || link > pages) continue;
+      snprintf(buff, sizeof(buff), "<a href=\"?sort=%s&amp;order=%s&amp;page=%zu\">%s</a> ", sort_names[query.sort],
+               query.descending ? "desc" : "asc", link, link < page ? "previous" : "next");
+      dst->append(buff);
+    }
+    snprintf(buff, sizeof(buff), "page %zu of %zu, %zu entries</p>\n", page, pages, order.size());
+    dst->append(buff);
+  }
+  dst->append("</body>\n</html>\n");
+  return dst;
+}
+
+listing_page Directory_Index::Page(const std::string & directory, const timespec & mtime,
+                                   std::string_view uri, const listing_query & query){
+  std::unique_lock<std::mutex> lk(mtx);
+  auto                     found = listings.find(directory);
+  std::shared_ptr<listing> dir   = found != listings.end() ? found->second : nullptr;
+  bool is_fresh = dir && dir->mtime.tv_sec == mtime.tv_sec && dir->mtime.tv_nsec == mtime.tv_nsec;
+  lk.unlock();
+
+  // concurrent scans of one directory are possible, the last one is kept
+  if (!is_fresh){
+    dir = Scan(directory, mtime);
+    if (!dir){
+      return nullptr;
+    }
+
+    lk.lock();
+    listings[directory] = dir;
+    if (listings.size() > AUTOINDEX_CACHE_DIRS){
+      auto oldest = listings.end();
+      for (auto it = listings.begin(); it != listings.end(); ++it){
+        if (it->first != directory && (oldest == listings.end() || it->second->used < oldest->second->used)){
+          oldest = it;
+        }
+      }
+      if (oldest != listings.end()) listings.erase(oldest);
+    }
+    lk.unlock();
+  }
+
+  // pages past the last one are the same last page, they share one cached copy
+  listing_query clamped = query;
+  std::size_t   pages   = std::max<std::size_t>(1, (dir->entries.size() + page_size - 1) / page_size);
+  clamped.page = std::min(query.page, pages);
+
+  std::string key(uri);
+  key.push_back('\n');
+  key.append(query.json ? "json " : "html ").append(sort_names[query.sort]).append(query.descending ? " desc " : " asc ")
+     .append(std::to_string(clamped.page));
+
+  std::lock_guard<std::mutex> dir_lk(dir->mtx);
+  std::uint64_t now = ++clock;
+  dir->used = now;
+
+  auto it = dir->pages.find(key);
+  if (it != dir->pages.end()){
+    it->second.used = now;
+    return it->second.page;
+  }
+
+  listing_page page = Render(*dir, uri, clamped);
+  if (dir->pages.size() >= AUTOINDEX_CACHE_PAGES){
+    auto oldest = dir->pages.begin();
+    for (auto candidate = dir->pages.begin(); candidate != dir->pages.end(); ++candidate){
+      if (candidate->second.used < oldest->second.used) oldest = candidate;
+    }
+    dir->pages.erase(oldest);
+  }
+  dir->pages.emplace(key, cached_page{page, now});
+  return page;
+}
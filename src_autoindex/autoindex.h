@@ -0,0 +1,82 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+#include <time.h>
+
+#define AUTOINDEX_CACHE_DIRS    (128)   //scanned directories kept, the least recently used is dropped
+#define AUTOINDEX_CACHE_PAGES   (32)    //rendered pages kept for one directory, the least recently used is dropped
+
+enum listing_sort{
+  SORT_NAME,
+  SORT_SIZE,
+  SORT_MTIME,
+  SORT_KEYS
+};
+
+struct listing_query{
+  bool            json;         // false - HTML
+  listing_sort    sort;
+  bool            descending;
+  std::size_t     page;         // from 1
+};
+
+struct listing_entry{
+  std::string     name;
+  bool            is_dir;
+  std::uint64_t   size;
+  std::int64_t    mtime;        // seconds
+};
+
+typedef std::shared_ptr<const std::string> listing_page;
+
+// Generated listings of directories which have no index file. Directory is
+// read once per its mtime by getdents64 in batches; entries are kept sorted
+// by every key on demand and pages are rendered from the kept orders, so a
+// request never builds the whole listing. Sizes and times of entries are the
+// ones of the scan: they do not change mtime of directory.
+class Directory_Index{
+
+    struct cached_page{
+      listing_page                      page;
+      std::uint64_t                     used;     // value of clock at the last request
+    };
+
+    struct listing{
+      timespec                          mtime;
+      std::vector<listing_entry>        entries;
+      std::vector<std::uint32_t>        orders[SORT_KEYS];  // ascending, empty - not sorted yet
+      std::map<std::string, cached_page> pages;             // query with clamped page and uri -> rendered page
+      std::atomic<std::uint64_t>        used;     // value of clock at the last request
+      std::mutex                        mtx;
+    };
+
+    std::size_t                         page_size;
+
+    std::mutex                          mtx;
+    std::unordered_map<std::string, std::shared_ptr<listing>> listings;   // absolute path -> scan
+    std::atomic<std::uint64_t>          clock;
+
+    std::shared_ptr<listing>  Scan      (const std::string & directory, const timespec & mtime);
+    const std::vector<std::uint32_t> & Order (listing & dir, listing_sort sort);
+    listing_page              Render    (listing & dir, std::string_view uri, const listing_query & query);
+
+  public:
+
+    Directory_Index(std::size_t _page_size);
+
+    // ?format=json&sort=name|size|mtime&order=desc&page=N, unknown parameters are ignored
+    static listing_query  ParseQuery  (std::string_view query);
+
+    // page of `directory` (with trailing slash) linked under `uri`, nullptr - directory cannot be read
+    listing_page          Page        (const std::string & directory, const timespec & mtime,
+                                       std::string_view uri, const listing_query & query);
+};
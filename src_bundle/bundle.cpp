@@ -0,0 +1,102 @@
+#include <bundle.h>
+
+#include <cstdio>
+#include <algorithm>
+
+Static_Bundle::Static_Bundle(const std::string & pathname) : data(nullptr), size(0), header(nullptr), index(nullptr){
+  int fd = open(pathname.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0){
+    std::string path = "\nError!!! Cannot open bundle `" + pathname + "` ";
+    std::perror(path.c_str());
+    return;
+  }
+
+  struct stat _stat = {0};
+  if (fstat(fd, &_stat) < 0 || static_cast<std::size_t>(_stat.st_size) < sizeof(bundle_header)){
+    std::cerr << "\nError!!! Bundle `" << pathname << "` is too small!\n";
+    close(fd);
+    return;
+  }
+
+  void * map = mmap(nullptr, _stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (map == MAP_FAILED){
+    std::string path = "\nError!!! Cannot mmap bundle `" + pathname + "` ";
+    std::perror(path.c_str());
+    return;
+  }
+
+  data   = static_cast<const uint8_t *>(map);
+  size   = _stat.st_size;
+  header = reinterpret_cast<const bundle_header *>(data);
+
+  if (!Validate()){
+    std::cerr << "\nError!!! File `" << pathname << "` is not a valid bundle!\n";
+    munmap(const_cast<uint8_t *>(data), size);
+    data = nullptr;
+    return;
+  }
+
+  index = reinterpret_cast<const bundle_entry *>(data + header->index_offset);
+
+  std::cout << "Bundle `" << pathname << "` mapped: " << header->count << " files, " << size << " bytes\n";
+}
+
+bool Static_Bundle::Validate(){
+  if (std::memcmp(header->magic, BUNDLE_MAGIC, sizeof(header->magic)) || header->version != BUNDLE_VERSION){
+    return false;
+  }
+
+  if (header->index_offset > size || (size - header->index_offset) / sizeof(bundle_entry) < header->count){
+    return false;
+  }
+
+  const bundle_entry * entries = reinterpret_cast<const bundle_entry *>(data + header->index_offset);
+  for (std::uint32_t i = 0; i < header->count; ++i){
+    const bundle_entry & e = entries[i];
+    if (!InFile(e.path_offset, e.path_size) || !InFile(e.headers_offset, e.headers_size) || !InFile(e.body_offset, e.body_size) ||
+        !InFile(e.gzip_headers_offset, e.gzip_headers_size) || !InFile(e.gzip_offset, e.gzip_size)){
+      return false;
+    }
+  }
+  return true;
+}
+
+// offset + length may wrap around, so they are compared separately
+bool Static_Bundle::InFile(std::uint64_t offset, std::uint64_t length) const{
+  return offset <= size && size - offset >= length;
+}
+
+const bundle_entry * Static_Bundle::Find(const char * path, std::size_t length) const{
+  std::uint32_t low = 0, high = header->count;
+
+  while (low < high){
+    std::uint32_t        mid   = low + (high - low) / 2;
+    const bundle_entry & entry = index[mid];
+
+    int rc = std::memcmp(data + entry.path_offset, path, std::min<std::size_t>(entry.path_size, length));
+    if (!rc){
+      rc = (entry.path_size < length) ? -1 : (entry.path_size > length);
+    }
+
+    if (!rc){
+      return &entry;
+    }
+
+    if (rc < 0){
+      low  = mid + 1;
+    }
+    else{
+      high = mid;
+    }
+  }
+
+  return nullptr;
+}
+
+Static_Bundle::~Static_Bundle(){
+  if (data){
+    munmap(const_cast<uint8_t *>(data), size);
+  }
+}
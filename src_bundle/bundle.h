@@ -0,0 +1,72 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <cstdint>
+#include <cstring>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Packed static-asset bundle: the whole root directory in one file, built
+// offline by HTTP_PACK and served by the server from read-only mmap.
+//
+//  bundle_header | bundle_entry[count] sorted by path | paths, headers, bodies
+//
+// All offsets are from the beginning of file. Headers are precomputed for
+// 200 respond: everything after Date up to and including the empty line.
+
+#define BUNDLE_MAGIC    ("HTTPBNDL")
+#define BUNDLE_VERSION  (1)
+
+struct bundle_header{
+    char            magic[8];
+    std::uint32_t   version;
+    std::uint32_t   count;
+    std::uint64_t   index_offset;
+};
+
+struct bundle_entry{
+    std::uint64_t   path_offset;
+    std::uint64_t   headers_offset;
+    std::uint64_t   body_offset;
+    std::uint64_t   body_size;
+    std::uint64_t   gzip_headers_offset;  // precompressed variant, gzip_size == 0 - there is no such
+    std::uint64_t   gzip_offset;
+    std::uint64_t   gzip_size;
+    std::uint32_t   path_size;
+    std::uint32_t   headers_size;
+    std::uint32_t   gzip_headers_size;
+    std::uint32_t   reserved;
+};
+
+static_assert(sizeof(bundle_header) == 24, "bundle_header layout is a part of file format");
+static_assert(sizeof(bundle_entry)  == 72, "bundle_entry layout is a part of file format");
+
+class Static_Bundle{
+
+    const uint8_t *         data;
+    std::size_t             size;
+
+    const bundle_header *   header;
+    const bundle_entry *    index;
+
+    inline bool             Validate    ();
+    inline bool             InFile      (std::uint64_t offset, std::uint64_t length) const;
+
+  public:
+
+    Static_Bundle() = delete;
+    Static_Bundle(const std::string & pathname);
+
+    bool                    IsOpen      () const { return data != nullptr; }
+
+    // binary search by path relative to root, without leading '/'
+    const bundle_entry *    Find        (const char * path, std::size_t length) const;
+
+    const uint8_t *         At          (std::uint64_t offset) const { return data + offset; }
+
+    ~Static_Bundle();
+};
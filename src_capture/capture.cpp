@@ -0,0 +1,103 @@
+#include <capture.h>
+
+#include <cstdio>
+#include <cerrno>
+#include <time.h>
+
+Traffic_Capture::Traffic_Capture(const std::string & pathname) : fd(-1), first_ns(0){
+  fd = open(pathname.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+  if (fd < 0){
+    std::perror(("\nError!!! Cannot open capture file `" + pathname + "` ").c_str());
+    return;
+  }
+
+  // the file is continued by the next capture with the same format
+  struct stat _stat = {0};
+  if (fstat(fd, &_stat) == 0 && _stat.st_size == 0){
+    capture_header header;
+    std::memcpy(header.magic, CAPTURE_MAGIC, sizeof(header.magic));
+    header.version  = CAPTURE_VERSION;
+    header.reserved = 0;
+
+    if (write(fd, &header, sizeof(header)) != sizeof(header)){
+      std::perror("\nError!!! Cannot write capture header ");
+      close(fd);
+      fd = -1;
+      return;
+    }
+  }
+
+  buffer.reserve(CAPTURE_BUFFER_SIZE);
+}
+
+Traffic_Capture::~Traffic_Capture(){
+  if (fd >= 0){
+    std::lock_guard<std::mutex> lk(mtx);
+    WriteBuffer();
+    close(fd);
+  }
+}
+
+std::uint64_t Traffic_Capture::Now(){
+  timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+// one write per batch: O_APPEND keeps records of different processes whole
+void Traffic_Capture::WriteBuffer(){
+  const uint8_t * src  = buffer.data();
+  std::size_t     size = buffer.size();
+
+  while (size){
+    ssize_t rc = write(fd, src, size);
+    if (rc < 0){
+      if (errno == EINTR) continue;
+      std::perror("\nError!!! Cannot write capture file ");
+      break;
+    }
+    src  += rc;
+    size -= rc;
+  }
+  buffer.clear();
+}
+
+void Traffic_Capture::Append(std::uint64_t time_ns, const void * request, std::uint32_t request_size,
+                             std::uint16_t status, std::uint64_t response_size, std::uint16_t flags){
+  if (fd < 0){
+    return;
+  }
+
+  capture_record record;
+  record.time_ns       = time_ns;
+  record.response_size = response_size;
+  record.request_size  = request_size;
+  record.status        = status;
+  record.flags         = flags;
+
+  std::lock_guard<std::mutex> lk(mtx);
+
+  if (buffer.empty()){
+    first_ns = time_ns;
+  }
+
+  const uint8_t * rec = reinterpret_cast<const uint8_t *>(&record);
+  const uint8_t * req = static_cast<const uint8_t *>(request);
+  buffer.insert(buffer.end(), rec, rec + sizeof(record));
+  buffer.insert(buffer.end(), req, req + request_size);
+
+  if (buffer.size() >= CAPTURE_BUFFER_SIZE || Now() - first_ns >= CAPTURE_FLUSH_NS){
+    WriteBuffer();
+  }
+}
+
+void Traffic_Capture::Flush(){
+  if (fd < 0){
+    return;
+  }
+
+  std::lock_guard<std::mutex> lk(mtx);
+  if (buffer.size()){
+    WriteBuffer();
+  }
+}
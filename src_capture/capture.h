@@ -0,0 +1,74 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+#include <cstring>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+// Binary log of received requests, it is played back by HTTP_REPLAY.
+//
+//  capture_header | (capture_record | raw request bytes)...
+//
+// Records are appended by whole buffers with O_APPEND, so worker processes
+// share one file; they come in order of flush, not of time, and replay
+// sorts them by `time_ns`.
+
+#define CAPTURE_MAGIC       ("HTTPCAPT")
+#define CAPTURE_VERSION     (1)
+#define CAPTURE_BUFFER_SIZE (64 << 10)  //records are written by batches of this size
+#define CAPTURE_FLUSH_NS    (1000000000ULL) //or when the oldest of them waits that long
+
+enum capture_flags{
+  CAPTURE_TLS       = 1,
+};
+
+struct capture_header{
+    char            magic[8];
+    std::uint32_t   version;
+    std::uint32_t   reserved;
+};
+
+struct capture_record{
+    std::uint64_t   time_ns;        // CLOCK_REALTIME when request was received
+    std::uint64_t   response_size;  // respond built by server, headers included
+    std::uint32_t   request_size;   // raw bytes follow the record
+    std::uint16_t   status;
+    std::uint16_t   flags;
+};
+
+static_assert(sizeof(capture_header) == 16, "capture_header layout is a part of file format");
+static_assert(sizeof(capture_record) == 24, "capture_record layout is a part of file format");
+
+class Traffic_Capture{
+
+    std::mutex              mtx;
+    int                     fd;
+    std::vector<uint8_t>    buffer;
+    std::uint64_t           first_ns;   // time of the oldest buffered record
+
+    inline void             WriteBuffer ();
+
+  public:
+
+    Traffic_Capture() = delete;
+    Traffic_Capture(const Traffic_Capture &) = delete;
+    explicit Traffic_Capture(const std::string & pathname);
+
+    bool          IsOpen      () const { return fd >= 0; }
+
+    void          Append      (std::uint64_t time_ns, const void * request, std::uint32_t request_size,
+                               std::uint16_t status, std::uint64_t response_size, std::uint16_t flags);
+
+    // batch is written at once, event loop calls it when server is idle
+    void          Flush       ();
+
+    static std::uint64_t  Now ();
+
+    ~Traffic_Capture();
+};
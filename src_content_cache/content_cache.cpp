@@ -0,0 +1,167 @@
+#include <content_cache.h>
+
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+
+Content_Cache::Content_Cache(std::size_t _max_size, std::size_t _max_file_size, cache_headers_builder _build_headers) :
+  max_size(_max_size), max_file_size(_max_file_size), size(0), build_headers(_build_headers){
+}
+
+bool Content_Cache::IsCacheable(off_t file_size) const{
+  return max_size && static_cast<std::size_t>(file_size) <= std::min(max_file_size, max_size);
+}
+
+std::size_t Content_Cache::Cost(const cache_entry & entry) const{
+  return entry.path.size() + entry.headers.size() + entry.body.size() + sizeof(cache_entry);
+}
+
+// mutex must be locked
+void Content_Cache::Evict(std::size_t needed){
+  while (lru.size() && size + needed > max_size){
+    auto it_slot = entries.find(lru.back());
+    size        -= Cost(*it_slot->second.entry);
+    entries.erase(it_slot);
+    lru.pop_back();
+  }
+}
+
+cache_entry_ptr Content_Cache::Lookup(std::string_view path, const struct stat & _stat){
+  // key of map is std::string: buffer of thread is reused, so hit does not allocate
+  thread_local std::string key;
+  key.assign(path.data(), path.size());
+
+  std::lock_guard<std::mutex> lk(mtx);
+
+  auto it_slot = entries.find(key);
+  if (it_slot == entries.end()){
+    return nullptr;
+  }
+
+  std::shared_ptr<cache_entry> & entry = it_slot->second.entry;
+  if (entry->size != _stat.st_size || entry->mtime.tv_sec != _stat.st_mtim.tv_sec || entry->mtime.tv_nsec != _stat.st_mtim.tv_nsec){
+    // file was changed since it was cached
+    size -= Cost(*entry);
+    lru.erase(it_slot->second.lru);
+    entries.erase(it_slot);
+    return nullptr;
+  }
+
+  lru.splice(lru.begin(), lru, it_slot->second.lru);
+  ++entry->hits;
+  return entry;
+}
+
+cache_entry_ptr Content_Cache::Load(const std::string & path, const timespec & mtime, off_t file_size, bool with_body){
+  std::shared_ptr<cache_entry> entry = std::make_shared<cache_entry>();
+
+  entry->path     = path;
+  entry->mtime    = mtime;
+  entry->size     = file_size;
+  entry->has_body = with_body && IsCacheable(file_size);
+  entry->hits     = 0;
+
+  MakeETag(mtime, file_size, entry->etag);
+  build_headers(*entry);
+
+  if (entry->has_body && !ReadBody(path, file_size, entry->body)){
+    return nullptr;
+  }
+
+  std::size_t cost = Cost(*entry);
+  if (cost > max_size){
+    return entry; // may be served, but is not cached
+  }
+
+  std::lock_guard<std::mutex> lk(mtx);
+
+  auto it_slot = entries.find(path);
+  if (it_slot != entries.end()){
+    entry->hits = it_slot->second.entry->hits.load();
+    size       -= Cost(*it_slot->second.entry);
+    lru.erase(it_slot->second.lru);
+    entries.erase(it_slot);
+  }
+
+  Evict(cost);
+
+  lru.push_front(path);
+  slot tmp;
+  tmp.entry     = entry;
+  tmp.lru       = lru.begin();
+  entries[path] = tmp;
+  size         += cost;
+
+  return entry;
+}
+
+bool Content_Cache::ReadBody(const std::string & path, off_t file_size, std::vector<uint8_t> & dst){
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0){
+    return false;
+  }
+
+  dst.resize(file_size);
+
+  off_t offset = 0;
+  while (offset < file_size){
+    ssize_t rc = pread(fd, dst.data() + offset, file_size - offset, offset);
+    if (rc <= 0){
+      if (rc < 0 && errno == EINTR) continue;
+      break;
+    }
+    offset += rc;
+  }
+
+  close(fd);
+  return offset == file_size;
+}
+
+// the same form as nginx: "mtime-size" in hex
+void Content_Cache::MakeETag(const timespec & mtime, off_t file_size, std::string & etag){
+  char buf[64];
+  snprintf(buf, sizeof(buf), "\"%lx-%lx\"", static_cast<unsigned long>(mtime.tv_sec), static_cast<unsigned long>(file_size));
+  etag = buf;
+}
+
+void Content_Cache::CollectHits(const std::string & root_path, std::unordered_map<std::string, std::uint32_t> & hits){
+  std::lock_guard<std::mutex> lk(mtx);
+  for (auto it = entries.begin(); it != entries.end(); ++it){
+    std::uint32_t entry_hits = it->second.entry->hits;
+    if (entry_hits && it->first.compare(0, root_path.size(), root_path) == 0){
+      hits[it->first.substr(root_path.size())] += entry_hits;
+    }
+  }
+}
+
+void Content_Cache::SaveHotList(const std::string & pathname, const std::unordered_map<std::string, std::uint32_t> & hits, std::size_t number){
+  std::vector<std::pair<std::uint32_t, std::string>> hot;
+  for (auto it = hits.begin(); it != hits.end(); ++it){
+    hot.push_back(std::make_pair(it->second, it->first));
+  }
+
+  std::sort(hot.begin(), hot.end(), [](const std::pair<std::uint32_t, std::string> & a, const std::pair<std::uint32_t, std::string> & b){
+    return a.first > b.first;
+  });
+
+  std::ofstream file(pathname, std::ios::trunc);
+  if (!file){
+    std::string path = "\nError!!! Cannot write hot list `" + pathname + "` ";
+    std::perror(path.c_str());
+    return;
+  }
+
+  for (std::size_t i = 0; i < hot.size() && i < number; ++i){
+    file << hot[i].second << '\n';
+  }
+}
+
+std::size_t Content_Cache::Size(){
+  std::lock_guard<std::mutex> lk(mtx);
+  return size;
+}
+
+std::size_t Content_Cache::Count(){
+  std::lock_guard<std::mutex> lk(mtx);
+  return entries.size();
+}
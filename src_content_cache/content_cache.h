@@ -0,0 +1,79 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+// Index of webroot files (metadata, precomputed headers and ETag) and their
+// content, limited by memory budget. Entries are immutable after insertion,
+// so worker keeps its entry alive by shared_ptr while response is sent.
+struct cache_entry{
+    std::string                 path;
+    timespec                    mtime;
+    off_t                       size;
+    std::string                 etag;
+    std::vector<uint8_t>        headers;    // all headers after Date, including empty line
+    std::vector<uint8_t>        body;
+    bool                        has_body;   // false - only index entry, file is too big for cache
+    mutable std::atomic<std::uint32_t> hits;
+};
+
+typedef std::shared_ptr<const cache_entry>          cache_entry_ptr;
+typedef std::function<void (cache_entry & entry)>   cache_headers_builder;
+
+class Content_Cache{
+
+    struct slot{
+      std::shared_ptr<cache_entry>                  entry;
+      std::list<std::string>::iterator              lru;
+    };
+
+    std::mutex                                      mtx;
+    std::unordered_map<std::string, slot>           entries;
+    std::list<std::string>                          lru;        // front - most recently used
+
+    std::size_t                                     max_size;
+    std::size_t                                     max_file_size;
+    std::size_t                                     size;
+
+    cache_headers_builder                           build_headers;
+
+    inline void             Evict       (std::size_t needed);
+    inline std::size_t      Cost        (const cache_entry & entry) const;
+
+  public:
+
+    Content_Cache() = delete;
+    Content_Cache(std::size_t _max_size, std::size_t _max_file_size, cache_headers_builder _build_headers);
+
+    bool                    IsCacheable (off_t file_size) const;
+
+    // entry which matches file mtime and size, nullptr if there is no such
+    cache_entry_ptr         Lookup      (std::string_view path, const struct stat & _stat);
+
+    // reads file (if `with_body` and it fits into budget) and puts it to cache
+    cache_entry_ptr         Load        (const std::string & path, const timespec & mtime, off_t file_size, bool with_body);
+
+    static void             MakeETag    (const timespec & mtime, off_t file_size, std::string & etag);
+    static bool             ReadBody    (const std::string & path, off_t size, std::vector<uint8_t> & dst);
+
+    // adds hits of cached paths under `root_path` (relative to it) to `hits`
+    void                    CollectHits (const std::string & root_path, std::unordered_map<std::string, std::uint32_t> & hits);
+
+    // `number` of most requested paths, one per line
+    static void             SaveHotList (const std::string & pathname, const std::unordered_map<std::string, std::uint32_t> & hits, std::size_t number);
+
+    std::size_t             Size        ();
+    std::size_t             Count       ();
+};
@@ -0,0 +1,211 @@
+#include <shared_cache.h>
+
+#include <cstdio>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <new>
+
+#define SHARED_CACHE_SLOT_PER (16 << 10) //one index slot per this size of data area
+
+Shared_Cache::Shared_Cache(std::size_t _size, std::size_t _max_file_size, std::size_t _number_processes) :
+  base(nullptr), size(_size), header(nullptr), pins(nullptr), number_processes(std::max<std::size_t>(_number_processes, 1)), process(0),
+  slots(nullptr), number_slots(0), data(nullptr), data_size(0), half_size(0), max_file_size(_max_file_size){
+  number_slots = std::max<std::size_t>(size / SHARED_CACHE_SLOT_PER, 64);
+
+  // slots follow pins at 8 bytes boundary
+  std::size_t pins_size  = (number_processes * sizeof(half_pins) + 7) & ~std::size_t(7);
+  std::size_t index_size = sizeof(region_header) + pins_size + number_slots * sizeof(cache_slot);
+  if (size <= index_size){
+    std::cerr << "\nError!!! Shared cache size " << size << " is too small!\n";
+    return;
+  }
+
+  void * map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (map == MAP_FAILED){
+    std::perror("\nError!!! Cannot map shared cache ");
+    return;
+  }
+
+  base      = static_cast<uint8_t *>(map);
+  header    = new (base) region_header();
+  pins      = new (base + sizeof(region_header)) half_pins[number_processes]();
+  slots     = reinterpret_cast<cache_slot *>(base + sizeof(region_header) + pins_size);
+  data      = base + index_size;
+  data_size = size - index_size;
+  half_size = data_size / 2;
+
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+  pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+  pthread_mutex_init(&header->mtx, &attr);
+  pthread_mutexattr_destroy(&attr);
+}
+
+Shared_Cache::~Shared_Cache(){
+  if (base){
+    pthread_mutex_destroy(&header->mtx);
+    munmap(base, size);
+  }
+}
+
+// owner died in the middle of Insert: slot is published last, so index is consistent
+bool Shared_Cache::Lock(){
+  int rc = pthread_mutex_lock(&header->mtx);
+  if (rc == EOWNERDEAD){
+    pthread_mutex_consistent(&header->mtx);
+    rc = 0;
+  }
+  return rc == 0;
+}
+
+void Shared_Cache::Unlock(){
+  pthread_mutex_unlock(&header->mtx);
+}
+
+// FNV-1a, 0 is reserved for free slot
+std::uint64_t Shared_Cache::Hash(std::string_view path){
+  std::uint64_t hash = 14695981039346656037ULL;
+  for (auto it = path.begin(); it != path.end(); ++it){
+    hash ^= static_cast<uint8_t>(*it);
+    hash *= 1099511628211ULL;
+  }
+  return hash ? hash : 1;
+}
+
+// slot of `path` or free slot where it goes, nullptr - table is full; mutex must be locked
+Shared_Cache::cache_slot * Shared_Cache::Find(std::string_view path, std::uint64_t hash){
+  for (std::size_t i = 0; i < number_slots; ++i){
+    cache_slot & slot = slots[(hash + i) % number_slots];
+    if (!slot.hash){
+      return &slot;
+    }
+    if (slot.hash == hash && slot.path_size == path.size() &&
+        std::memcmp(data + slot.path_offset, path.data(), path.size()) == 0){
+      return &slot;
+    }
+  }
+  return nullptr;
+}
+
+bool Shared_Cache::IsCacheable(off_t file_size) const{
+  return base && static_cast<std::size_t>(file_size) <= max_file_size;
+}
+
+void Shared_Cache::Attach(std::size_t i){
+  if (!base || i >= number_processes){
+    return;
+  }
+  process = i;
+  pins[i][0] = 0;
+  pins[i][1] = 0;
+}
+
+// hit holds the half of `slot` until its owner is released; mutex must be locked
+void Shared_Cache::Pin(const cache_slot & slot, shared_cache_hit & hit){
+  std::atomic<std::uint32_t> * pin = &pins[process][slot.headers_offset >= half_size];
+  pin->fetch_add(1);
+
+  hit.headers      = data + slot.headers_offset;
+  hit.headers_size = slot.headers_size;
+  hit.body         = hit.headers + hit.headers_size;
+  hit.body_size    = slot.body_size;
+  hit.owner        = std::shared_ptr<std::atomic<std::uint32_t>>(pin, unpin(), std::pmr::polymorphic_allocator<char>(&pin_pool));
+}
+
+// the other half becomes current, entries in it are dropped; false - some
+// response still holds it. Mutex must be locked
+bool Shared_Cache::Reclaim(){
+  std::uint32_t other = header->current ^ 1;
+  for (std::size_t i = 0; i < number_processes; ++i){
+    if (pins[i][other].load()){
+      return false;
+    }
+  }
+
+  std::vector<cache_slot> kept;
+  kept.reserve(header->count);
+  for (std::size_t i = 0; i < number_slots; ++i){
+    if (slots[i].hash && (slots[i].headers_offset >= half_size) != other){
+      kept.push_back(slots[i]);
+    }
+  }
+
+  // index is built again before the half is given out: owner which dies
+  // in the middle loses entries, but no slot is left over reused bytes
+  std::memset(static_cast<void *>(slots), 0, number_slots * sizeof(cache_slot));
+  header->count = 0;
+  for (auto it = kept.begin(); it != kept.end(); ++it){
+    *Find(std::string_view(reinterpret_cast<const char *>(data + it->path_offset), it->path_size), it->hash) = *it;
+    ++header->count;
+  }
+
+  header->used[other] = 0;
+  header->current     = other;
+  ++header->reclaims;
+  return true;
+}
+
+bool Shared_Cache::Lookup(std::string_view path, const struct stat & _stat, shared_cache_hit & hit){
+  if (!base || !Lock()){
+    return false;
+  }
+
+  cache_slot * slot  = Find(path, Hash(path));
+  bool         found = slot && slot->hash && static_cast<off_t>(slot->body_size) == _stat.st_size &&
+                       slot->mtime_sec == _stat.st_mtim.tv_sec && slot->mtime_nsec == _stat.st_mtim.tv_nsec;
+  if (found){
+    Pin(*slot, hit);
+  }
+  Unlock();
+
+  ++(found ? header->hits : header->misses);
+  return found;
+}
+
+bool Shared_Cache::Insert(std::string_view path, const struct stat & _stat,
+                          const std::vector<uint8_t> & headers, const std::vector<uint8_t> & body, shared_cache_hit & hit){
+  std::size_t needed = path.size() + headers.size() + body.size();
+  if (!base || needed > half_size || !Lock()){
+    return false;
+  }
+
+  std::uint64_t hash = Hash(path);
+  cache_slot *  slot = Find(path, hash);
+
+  if (!slot || header->used[header->current] + needed > half_size){
+    slot = Reclaim() ? Find(path, hash) : nullptr;
+  }
+  if (!slot){
+    Unlock();
+    return false;
+  }
+
+  // bytes of replaced entry stay as they are: they may be sent right now
+  std::uint64_t offset = header->current * half_size + header->used[header->current];
+  uint8_t *     dst    = data + offset;
+  std::memcpy(dst, path.data(), path.size());
+  std::memcpy(dst + path.size(), headers.data(), headers.size());
+  std::memcpy(dst + path.size() + headers.size(), body.data(), body.size());
+
+  cache_slot tmp;
+  tmp.hash           = hash;
+  tmp.path_offset    = offset;
+  tmp.path_size      = path.size();
+  tmp.headers_offset = offset + path.size();
+  tmp.headers_size   = headers.size();
+  tmp.body_size      = body.size();
+  tmp.mtime_sec      = _stat.st_mtim.tv_sec;
+  tmp.mtime_nsec     = _stat.st_mtim.tv_nsec;
+
+  // space is taken before slot is published, so dead owner leaves no slot over free bytes
+  header->used[header->current] += needed;
+  if (!slot->hash) ++header->count;
+  *slot = tmp;
+
+  Pin(tmp, hit);
+
+  Unlock();
+  return true;
+}
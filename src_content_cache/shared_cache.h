@@ -0,0 +1,113 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <memory_resource>
+#include <atomic>
+#include <cstdint>
+
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// view of cached file, it stays valid while `owner` is held
+struct shared_cache_hit{
+    const uint8_t *               headers;
+    std::size_t                   headers_size;
+    const uint8_t *               body;
+    std::size_t                   body_size;
+    std::shared_ptr<const void>   owner;
+};
+
+// Content cache of prefork mode in anonymous shared mapping, created by
+// master before fork, so every worker process serves hot files from the
+// same pages. Data area is two halves written in turn: when the current one
+// is full, the other one is reclaimed with its entries, unless a response in
+// flight of some worker process still holds it. Index is open-addressing
+// table under robust process-shared mutex: worker which dies holding it
+// does not block the others.
+class Shared_Cache{
+
+    struct cache_slot{
+      std::uint64_t   hash;           // 0 - free slot
+      std::uint64_t   path_offset;
+      std::uint32_t   path_size;
+      std::uint32_t   headers_size;
+      std::int64_t    mtime_sec;
+      std::int64_t    mtime_nsec;
+      std::uint64_t   headers_offset; // body follows headers
+      std::uint64_t   body_size;
+    };
+
+    struct region_header{
+      pthread_mutex_t             mtx;
+      std::uint64_t               used[2];    // bytes of every half of data area
+      std::uint32_t               current;    // half which entries are appended to
+      std::uint32_t               count;
+      std::atomic<std::uint64_t>  hits;
+      std::atomic<std::uint64_t>  misses;
+      std::atomic<std::uint64_t>  reclaims;
+    };
+
+    // responses in flight of one worker process which hold every half
+    typedef std::atomic<std::uint32_t> half_pins[2];
+
+    // owner of hit releases its pin, control blocks are reused by pool
+    struct unpin{
+      void operator()(std::atomic<std::uint32_t> * pin) const { pin->fetch_sub(1); }
+    };
+
+    uint8_t *         base;
+    std::size_t       size;
+    region_header *   header;
+    half_pins *       pins;
+    std::size_t       number_processes;
+    std::size_t       process;        // slot of this worker process in `pins`
+    cache_slot *      slots;
+    std::size_t       number_slots;
+    uint8_t *         data;
+    std::size_t       data_size;
+    std::size_t       half_size;
+    std::size_t       max_file_size;
+
+    std::pmr::synchronized_pool_resource  pin_pool;
+
+    inline bool         Lock        ();
+    inline void         Unlock      ();
+    inline cache_slot * Find        (std::string_view path, std::uint64_t hash);
+    inline void         Pin         (const cache_slot & slot, shared_cache_hit & hit);
+    inline bool         Reclaim     ();
+    static std::uint64_t Hash       (std::string_view path);
+
+  public:
+
+    Shared_Cache() = delete;
+    Shared_Cache(const Shared_Cache &) = delete;
+    Shared_Cache(std::size_t _size, std::size_t _max_file_size, std::size_t _number_processes);
+
+    bool          IsOpen      () const { return base != nullptr; }
+    bool          IsCacheable (off_t file_size) const;
+
+    // worker process `i` starts using cache, pins left by its dead predecessor are dropped
+    void          Attach      (std::size_t i);
+
+    // entry which matches file mtime and size
+    bool          Lookup      (std::string_view path, const struct stat & _stat, shared_cache_hit & hit);
+
+    // copies headers and body to shared memory, false - there is no room
+    bool          Insert      (std::string_view path, const struct stat & _stat,
+                               const std::vector<uint8_t> & headers, const std::vector<uint8_t> & body, shared_cache_hit & hit);
+
+    std::size_t   Used        () const { return header ? header->used[0] + header->used[1] : 0; }
+    std::size_t   DataSize    () const { return data_size; }
+    std::size_t   Count       () const { return header ? header->count : 0; }
+    std::uint64_t Hits        () const { return header ? header->hits.load() : 0; }
+    std::uint64_t Misses      () const { return header ? header->misses.load() : 0; }
+    std::uint64_t Reclaims    () const { return header ? header->reclaims.load() : 0; }
+
+    ~Shared_Cache();
+};
@@ -0,0 +1,192 @@
+#include <warmup.h>
+
+#include <fstream>
+#include <cstring>
+
+namespace {
+  struct linux_dirent64{
+    ino64_t         d_ino;
+    off64_t         d_off;
+    unsigned short  d_reclen;
+    unsigned char   d_type;
+    char            d_name[];
+  };
+}
+
+Webroot_Warmup::Webroot_Warmup(parse_info & _info, const std::string & _root_path, Content_Cache & _cache,
+                               const std::vector<int> & _cpus) :
+  info(_info), cache(_cache), root_path(_root_path), cpus(_cpus), pending(0), is_stopped(false), is_ready(false), files(0), preloaded(0), preloaded_bytes(0){
+}
+
+void Webroot_Warmup::LoadHotList(){
+  if (info.warmup_hot_list.empty()){
+    return;
+  }
+
+  std::ifstream file(info.warmup_hot_list);
+  std::string   path;
+  while (std::getline(file, path)){
+    if (path.size()){
+      hot_paths.insert(root_path + path);
+    }
+  }
+}
+
+void Webroot_Warmup::Start(){
+  std::cout << "\033[1;35mWarmup of " << root_path << " started...\033[0m\n";
+  coordinator = std::thread([this](){ this->Run(); });
+}
+
+void Webroot_Warmup::Run(){
+  auto start = std::chrono::steady_clock::now();
+
+  LoadHotList();
+
+  pending = 1;
+  directories.push_back(root_path);
+
+  std::vector<std::thread> walkers;
+  for (std::size_t i = 0; i < info.warmup_threads; ++i){
+    // pinned walkers read files, so preloaded bodies are placed on the node of their shard
+    walkers.push_back(std::thread([this](){
+      NUMA_Topology::PinThread(pthread_self(), this->cpus);
+      this->Walk();
+    }));
+  }
+  for (auto it = walkers.begin(); it != walkers.end(); ++it){
+    it->join();
+  }
+
+  if (is_stopped){
+    return;
+  }
+
+  is_ready = true;
+
+  auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "\033[1;32mWarmup completed: \033[0m" << files << " files indexed, " << preloaded << " preloaded ("
+            << preloaded_bytes << " bytes) in " << ms << " ms\n";
+
+  if (!info.warmup_ready_file.empty()){
+    int fd = open(info.warmup_ready_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0){
+      std::string path = "\nError!!! Cannot create warmup ready file `" + info.warmup_ready_file + "` ";
+      std::perror(path.c_str());
+    }
+    else{
+      close(fd);
+    }
+  }
+}
+
+void Webroot_Warmup::Walk(){
+  while (true){
+    std::unique_lock<std::mutex> lk(mtx);
+    cv.wait(lk, [this]{ return this->directories.size() || !this->pending || this->is_stopped; });
+
+    if (!pending || is_stopped){
+      return;
+    }
+
+    std::string directory = directories.front();
+    directories.pop_front();
+    lk.unlock();
+
+    Scan(directory);
+
+    lk.lock();
+    if (!--pending){
+      cv.notify_all(); // whole tree is walked
+    }
+  }
+}
+
+void Webroot_Warmup::Scan(const std::string & directory){
+  int dir_fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (dir_fd < 0){
+    std::string path = "\nError!!! Warmup cannot open `" + directory + "` ";
+    std::perror(path.c_str());
+    return;
+  }
+
+  alignas(linux_dirent64) char buf[GETDENTS_BUFFER_SIZE];
+
+  while (!is_stopped){
+    long rc = syscall(SYS_getdents64, dir_fd, buf, sizeof(buf));
+    if (rc <= 0){
+      break;
+    }
+
+    for (long pos = 0; pos < rc;){
+      linux_dirent64 * dirent = reinterpret_cast<linux_dirent64 *>(buf + pos);
+      pos += dirent->d_reclen;
+
+      if (!std::strcmp(dirent->d_name, ".") || !std::strcmp(dirent->d_name, "..")){
+        continue;
+      }
+      Visit(dir_fd, directory, dirent->d_name, dirent->d_type);
+    }
+  }
+
+  close(dir_fd);
+}
+
+void Webroot_Warmup::Visit(int dir_fd, const std::string & directory, const char * name, unsigned char type){
+  if (type == DT_DIR){
+    std::lock_guard<std::mutex> lk(mtx);
+    ++pending;
+    directories.push_back(directory + name + '/');
+    cv.notify_one();
+    return;
+  }
+
+  struct statx stx;
+  if (statx(dir_fd, name, AT_STATX_SYNC_AS_STAT, STATX_TYPE | STATX_SIZE | STATX_MTIME, &stx) < 0){
+    return;
+  }
+
+  if (S_ISDIR(stx.stx_mode)){
+    if (type == DT_UNKNOWN){ // symlinks to directories are not followed
+      std::lock_guard<std::mutex> lk(mtx);
+      ++pending;
+      directories.push_back(directory + name + '/');
+      cv.notify_one();
+    }
+    return;
+  }
+
+  if (!S_ISREG(stx.stx_mode)){
+    return;
+  }
+
+  std::string path = directory + name;
+  timespec    mtime;
+  mtime.tv_sec  = stx.stx_mtime.tv_sec;
+  mtime.tv_nsec = stx.stx_mtime.tv_nsec;
+
+  bool with_body = stx.stx_size <= info.warmup_max_file_size || hot_paths.count(path);
+
+  cache_entry_ptr entry = cache.Load(path, mtime, stx.stx_size, with_body);
+
+  ++files;
+  if (entry && entry->has_body){
+    ++preloaded;
+    preloaded_bytes += entry->size;
+  }
+}
+
+void Webroot_Warmup::Stop(){
+  {
+    std::lock_guard<std::mutex> lk(mtx);
+    is_stopped = true;
+  }
+  cv.notify_all();
+
+  if (coordinator.joinable()){
+    coordinator.join();
+  }
+}
+
+Webroot_Warmup::~Webroot_Warmup(){
+  Stop();
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <deque>
+#include <unordered_set>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include <config.h>
+#include <content_cache.h>
+#include <numa_topology.h>
+
+// Startup phase which walks root directory by several threads (getdents64 +
+// statx), puts every file to the index of cache and preloads content of small
+// files and of hot paths recorded by previous run. Server serves requests
+// while warmup is running, readiness is reported when it is done.
+class Webroot_Warmup{
+
+    parse_info &                      info;
+    Content_Cache &                   cache;
+    std::string                       root_path;  // directory of the host which owns `cache`
+    std::vector<int>                  cpus;       // walkers are pinned to them, empty - not pinned
+
+    std::unordered_set<std::string>   hot_paths;
+
+    std::mutex                        mtx;
+    std::condition_variable           cv;
+    std::deque<std::string>           directories;
+    std::size_t                       pending;    // directories queued or being scanned
+
+    std::thread                       coordinator;
+    std::atomic<bool>                 is_stopped;
+    std::atomic<bool>                 is_ready;
+
+    std::atomic<std::size_t>          files;
+    std::atomic<std::size_t>          preloaded;
+    std::atomic<std::size_t>          preloaded_bytes;
+
+    inline void   LoadHotList ();
+    void          Walk        ();
+    void          Scan        (const std::string & directory);
+    void          Visit       (int dir_fd, const std::string & directory, const char * name, unsigned char type);
+    void          Run         ();
+
+  public:
+
+    Webroot_Warmup() = delete;
+    Webroot_Warmup(parse_info & _info, const std::string & _root_path, Content_Cache & _cache,
+                   const std::vector<int> & _cpus = std::vector<int>());
+
+    void          Start       ();
+    void          Stop        ();
+    bool          IsReady     () const { return is_ready; }
+
+    ~Webroot_Warmup();
+};
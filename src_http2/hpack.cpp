@@ -0,0 +1,430 @@
+#include <hpack.h>
+
+#include <algorithm>
+
+namespace {
+
+  // rfc7541 Appendix A
+  const char * const static_table[HPACK_Table::STATIC_SIZE][2] =
+    {
+      {":authority",                  ""              },
+      {":method",                     "GET"           },
+      {":method",                     "POST"          },
+      {":path",                       "/"             },
+      {":path",                       "/index.html"   },
+      {":scheme",                     "http"          },
+      {":scheme",                     "https"         },
+      {":status",                     "200"           },
+      {":status",                     "204"           },
+      {":status",                     "206"           },
+      {":status",                     "304"           },
+      {":status",                     "400"           },
+      {":status",                     "404"           },
+      {":status",                     "500"           },
+      {"accept-charset",              ""              },
+      {"accept-encoding",             "gzip, deflate" },
+      {"accept-language",             ""              },
+      {"accept-ranges",               ""              },
+      {"accept",                      ""              },
+      {"access-control-allow-origin", ""              },
+      {"age",                         ""              },
+      {"allow",                       ""              },
+      {"authorization",               ""              },
+      {"cache-control",               ""              },
+      {"content-disposition",         ""              },
+      {"content-encoding",            ""              },
+      {"content-language",            ""              },
+      {"content-length",              ""              },
+      {"content-location",            ""              },
+      {"content-range",               ""              },
+      {"content-type",                ""              },
+      {"cookie",                      ""              },
+      {"date",                        ""              },
+      {"etag",                        ""              },
+      {"expect",                      ""              },
+      {"expires",                     ""              },
+      {"from",                        ""              },
+      {"host",                        ""              },
+      {"if-match",                    ""              },
+      {"if-modified-since",           ""              },
+      {"if-none-match",               ""              },
+      {"if-range",                    ""              },
+      {"if-unmodified-since",         ""              },
+      {"last-modified",               ""              },
+      {"link",                        ""              },
+      {"location",                    ""              },
+      {"max-forwards",                ""              },
+      {"proxy-authenticate",          ""              },
+      {"proxy-authorization",         ""              },
+      {"range",                       ""              },
+      {"referer",                     ""              },
+      {"refresh",                     ""              },
+      {"retry-after",                 ""              },
+      {"server",                      ""              },
+      {"set-cookie",                  ""              },
+      {"strict-transport-security",   ""              },
+      {"transfer-encoding",           ""              },
+      {"user-agent",                  ""              },
+      {"vary",                        ""              },
+      {"via",                         ""              },
+      {"www-authenticate",            ""              },
+    };
+
+  // rfc7541 Appendix B: length of code for each symbol (256 - EOS).
+  // The code is canonical, so codes themselves are restored from lengths.
+  const uint8_t huffman_length[257] =
+    {
+      13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+      28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+       6, 10, 10, 12, 13,  6,  8, 11, 10, 10,  8, 11,  8,  6,  6,  6,
+       5,  5,  5,  6,  6,  6,  6,  6,  6,  6,  7,  8, 15,  6, 12, 10,
+      13,  6,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,
+       7,  7,  7,  7,  7,  7,  7,  7,  8,  7,  8, 13, 19, 13, 14,  6,
+      15,  5,  6,  5,  6,  5,  6,  6,  6,  5,  7,  7,  6,  6,  6,  5,
+       6,  7,  6,  5,  5,  6,  7,  7,  7,  7,  7, 15, 11, 14, 13, 28,
+      20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+      24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+      22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+      21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+      26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+      19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+      20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+      26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+      30
+    };
+
+  const uint8_t HUFFMAN_MAX_LENGTH = 30;
+
+  // canonical decoding tables: for each code length - first code, its number
+  // of codes and position of the first symbol in `symbols`
+  struct huffman_decode_table{
+    std::uint32_t first_code [HUFFMAN_MAX_LENGTH + 1];
+    std::uint32_t count      [HUFFMAN_MAX_LENGTH + 1];
+    std::uint32_t first_index[HUFFMAN_MAX_LENGTH + 1];
+    std::uint16_t symbols    [257];
+
+    huffman_decode_table(){
+      std::fill(count, count + HUFFMAN_MAX_LENGTH + 1, 0);
+      for (std::size_t sym = 0; sym < 257; ++sym){
+        ++count[huffman_length[sym]];
+      }
+
+      std::uint32_t code = 0, index = 0;
+      for (std::size_t len = 1; len <= HUFFMAN_MAX_LENGTH; ++len){
+        first_code[len]  = code;
+        first_index[len] = index;
+        index           += count[len];
+        code             = (code + count[len]) << 1;
+      }
+
+      std::uint32_t next[HUFFMAN_MAX_LENGTH + 1];
+      std::copy(first_index, first_index + HUFFMAN_MAX_LENGTH + 1, next);
+      for (std::size_t sym = 0; sym < 257; ++sym){
+        symbols[next[huffman_length[sym]]++] = sym;
+      }
+    }
+  };
+
+  const huffman_decode_table huffman;
+
+  const std::size_t ENTRY_OVERHEAD = 32;
+}
+
+const std::size_t HPACK_Table::STATIC_SIZE;
+const std::size_t HPACK_Table::DEFAULT_SIZE;
+
+HPACK_Table::HPACK_Table(std::size_t _max_size) : size(0), max_size(_max_size){
+}
+
+void HPACK_Table::Evict(std::size_t needed){
+  while (dynamic.size() && size + needed > max_size){
+    size -= dynamic.back().first.size() + dynamic.back().second.size() + ENTRY_OVERHEAD;
+    dynamic.pop_back();
+  }
+}
+
+void HPACK_Table::Add(const std::string & name, const std::string & value){
+  std::size_t entry = name.size() + value.size() + ENTRY_OVERHEAD;
+
+  // rfc7541 4.4: entry larger than table empties it and is not added
+  Evict(entry);
+  if (entry > max_size){
+    return;
+  }
+
+  dynamic.push_front(header_field(name, value));
+  size += entry;
+}
+
+bool HPACK_Table::Get(std::size_t index, header_field & field) const{
+  if (!index){
+    return false;
+  }
+
+  if (index <= STATIC_SIZE){
+    field.first  = static_table[index - 1][0];
+    field.second = static_table[index - 1][1];
+    return true;
+  }
+
+  index -= STATIC_SIZE + 1;
+  if (index >= dynamic.size()){
+    return false;
+  }
+
+  field = dynamic[index];
+  return true;
+}
+
+void HPACK_Table::SetMaxSize(std::size_t _max_size){
+  max_size = _max_size;
+  Evict(0);
+}
+
+long HPACK_Table::Find(const std::string & name, const std::string & value) const{
+  long name_index = 0;
+
+  for (std::size_t i = 0; i < STATIC_SIZE; ++i){
+    if (name == static_table[i][0]){
+      if (value == static_table[i][1]){
+        return i + 1;
+      }
+      if (!name_index){
+        name_index = -static_cast<long>(i + 1);
+      }
+    }
+  }
+
+  for (std::size_t i = 0; i < dynamic.size(); ++i){
+    if (dynamic[i].first == name){
+      if (dynamic[i].second == value){
+        return STATIC_SIZE + i + 1;
+      }
+      if (!name_index){
+        name_index = -static_cast<long>(STATIC_SIZE + i + 1);
+      }
+    }
+  }
+
+  return name_index;
+}
+
+HPACK_Decoder::HPACK_Decoder(std::size_t _max_size) : table(_max_size), settings_max_size(_max_size){
+}
+
+// rfc7541 5.1
+bool HPACK_Decoder::DecodeInteger(const uint8_t *& src, const uint8_t * end, uint8_t prefix, std::uint64_t & value){
+  if (src >= end){
+    return false;
+  }
+
+  uint8_t mask = (1 << prefix) - 1;
+  value        = *src++ & mask;
+  if (value < mask){
+    return true;
+  }
+
+  for (unsigned shift = 0; src < end && shift < 56; shift += 7){
+    uint8_t b = *src++;
+    value    += static_cast<std::uint64_t>(b & 0x7f) << shift;
+    if (!(b & 0x80)){
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// rfc7541 5.2
+bool HPACK_Decoder::DecodeString(const uint8_t *& src, const uint8_t * end, std::string & str){
+  if (src >= end){
+    return false;
+  }
+
+  bool          is_huffman = *src & 0x80;
+  std::uint64_t len;
+
+  if (!DecodeInteger(src, end, 7, len) || len > static_cast<std::uint64_t>(end - src)){
+    return false;
+  }
+
+  str.clear();
+  if (is_huffman){
+    if (!HuffmanDecode(src, len, str)){
+      return false;
+    }
+  }
+  else{
+    str.assign(reinterpret_cast<const char *>(src), len);
+  }
+
+  src += len;
+  return true;
+}
+
+bool HPACK_Decoder::HuffmanDecode(const uint8_t * src, std::size_t len, std::string & str){
+  std::uint32_t code = 0;
+  std::size_t   bits = 0;
+
+  for (std::size_t i = 0; i < len; ++i){
+    for (int bit = 7; bit >= 0; --bit){
+      code = (code << 1) | ((src[i] >> bit) & 1);
+      ++bits;
+
+      if (bits > HUFFMAN_MAX_LENGTH){
+        return false;
+      }
+
+      if (huffman.count[bits] && code - huffman.first_code[bits] < huffman.count[bits]){
+        uint16_t sym = huffman.symbols[huffman.first_index[bits] + code - huffman.first_code[bits]];
+        if (sym == 256){
+          return false; // rfc7541 5.2: EOS in string literal is an error
+        }
+        str.push_back(static_cast<char>(sym));
+        code = 0;
+        bits = 0;
+      }
+    }
+  }
+
+  // padding: at most 7 bits, the most significant bits of EOS (all ones)
+  return bits < 8 && code == (1u << bits) - 1;
+}
+
+hpack_result HPACK_Decoder::Decode(const uint8_t * src, std::size_t len, header_list & headers, std::size_t max_list_size){
+  const uint8_t * end = src + len;
+  bool            may_update_size = true; // rfc7541 4.2: only at the beginning of block
+  std::size_t     list_size       = 0;
+
+  while (src < end){
+    uint8_t       b = *src;
+    std::uint64_t index;
+    header_field  field;
+
+    if (b & 0x80){                                  // 6.1 indexed header field
+      if (!DecodeInteger(src, end, 7, index) || !table.Get(index, field)){
+        return HPACK_COMPRESSION_ERROR;
+      }
+      // a few bytes repeat a big dynamic entry, the list is checked before it grows
+      list_size += field.first.size() + field.second.size() + 32;
+      if (list_size > max_list_size){
+        return HPACK_TOO_LARGE;
+      }
+      headers.push_back(field);
+      may_update_size = false;
+      continue;
+    }
+
+    if ((b & 0xe0) == 0x20){                        // 6.3 dynamic table size update
+      if (!may_update_size || !DecodeInteger(src, end, 5, index) || index > settings_max_size){
+        return HPACK_COMPRESSION_ERROR;
+      }
+      table.SetMaxSize(index);
+      continue;
+    }
+
+    may_update_size   = false;
+    bool is_indexing  = (b & 0xc0) == 0x40;          // 6.2.1 with incremental indexing
+
+    if (!DecodeInteger(src, end, is_indexing ? 6 : 4, index)){
+      return HPACK_COMPRESSION_ERROR;
+    }
+
+    if (index){
+      if (!table.Get(index, field)){
+        return HPACK_COMPRESSION_ERROR;
+      }
+    }
+    else if (!DecodeString(src, end, field.first)){
+      return HPACK_COMPRESSION_ERROR;
+    }
+
+    if (!DecodeString(src, end, field.second)){
+      return HPACK_COMPRESSION_ERROR;
+    }
+
+    if (is_indexing){
+      table.Add(field.first, field.second);
+    }
+
+    list_size += field.first.size() + field.second.size() + 32;
+    if (list_size > max_list_size){
+      return HPACK_TOO_LARGE;
+    }
+    headers.push_back(field);
+  }
+
+  return HPACK_OK;
+}
+
+HPACK_Encoder::HPACK_Encoder() : table(HPACK_Table::DEFAULT_SIZE), size_update(false){
+}
+
+void HPACK_Encoder::EncodeInteger(std::uint64_t value, uint8_t prefix, uint8_t flags, std::vector<uint8_t> & dst){
+  uint8_t mask = (1 << prefix) - 1;
+
+  if (value < mask){
+    dst.push_back(flags | value);
+    return;
+  }
+
+  dst.push_back(flags | mask);
+  value -= mask;
+  while (value >= 0x80){
+    dst.push_back(0x80 | (value & 0x7f));
+    value >>= 7;
+  }
+  dst.push_back(value);
+}
+
+void HPACK_Encoder::EncodeString(const std::string & str, std::vector<uint8_t> & dst){
+  // literals are sent raw: response values (dates, lengths, types) gain little from huffman
+  EncodeInteger(str.size(), 7, 0x00, dst);
+  dst.insert(dst.end(), str.begin(), str.end());
+}
+
+// values which repeat from response to response, they are worth dynamic table entry
+bool HPACK_Encoder::IsIndexable(const std::string & name){
+  return name == "server" || name == "content-type";
+}
+
+void HPACK_Encoder::SetMaxSize(std::size_t _max_size){
+  _max_size = std::min(_max_size, HPACK_Table::DEFAULT_SIZE);
+  if (_max_size != table.MaxSize()){
+    table.SetMaxSize(_max_size);
+    size_update = true;
+  }
+}
+
+void HPACK_Encoder::Encode(const header_list & headers, std::vector<uint8_t> & dst){
+  if (size_update){
+    EncodeInteger(table.MaxSize(), 5, 0x20, dst);
+    size_update = false;
+  }
+
+  for (auto it = headers.begin(); it != headers.end(); ++it){
+    long index = table.Find(it->first, it->second);
+
+    if (index > 0){
+      EncodeInteger(index, 7, 0x80, dst);
+      continue;
+    }
+
+    bool is_indexing = IsIndexable(it->first);
+    if (is_indexing){
+      EncodeInteger(-index, 6, 0x40, dst);
+    }
+    else{
+      EncodeInteger(-index, 4, 0x00, dst);
+    }
+
+    if (!index){
+      EncodeString(it->first, dst);
+    }
+    EncodeString(it->second, dst);
+
+    if (is_indexing){
+      table.Add(it->first, it->second);
+    }
+  }
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <utility>
+#include <cstdint>
+
+// HPACK header compression for HTTP/2 (RFC 7541)
+
+typedef std::pair<std::string, std::string>  header_field;
+typedef std::vector<header_field>            header_list;
+
+enum hpack_result{
+  HPACK_OK,
+  HPACK_COMPRESSION_ERROR,
+  HPACK_TOO_LARGE,          // decoded list is over the limit, the rest of block is not decoded
+};
+
+class HPACK_Table{
+
+    std::deque<header_field>  dynamic;          // newest entry is at the front
+    std::size_t               size;             // rfc7541 4.1: sum of (name + value + 32)
+    std::size_t               max_size;
+
+    inline void               Evict           (std::size_t needed);
+
+  public:
+
+    static const std::size_t  STATIC_SIZE = 61;
+    static const std::size_t  DEFAULT_SIZE = 4096;
+
+    HPACK_Table(std::size_t _max_size = DEFAULT_SIZE);
+
+    void                      Add             (const std::string & name, const std::string & value);
+    bool                      Get             (std::size_t index, header_field & field) const;
+    void                      SetMaxSize      (std::size_t _max_size);
+    std::size_t               MaxSize         () const { return max_size; }
+
+    // returns index of full match, or (negative) index of name-only match, or 0
+    long                      Find            (const std::string & name, const std::string & value) const;
+};
+
+class HPACK_Decoder{
+
+    HPACK_Table               table;
+    std::size_t               settings_max_size; // upper bound we announced in SETTINGS_HEADER_TABLE_SIZE
+
+    static bool               DecodeInteger   (const uint8_t *& src, const uint8_t * end, uint8_t prefix, std::uint64_t & value);
+    static bool               DecodeString    (const uint8_t *& src, const uint8_t * end, std::string & str);
+    static bool               HuffmanDecode   (const uint8_t * src, std::size_t len, std::string & str);
+
+  public:
+
+    HPACK_Decoder(std::size_t _max_size = HPACK_Table::DEFAULT_SIZE);
+
+    // decodes complete header block; `max_list_size` bounds sum of (name + value + 32)
+    // of decoded fields, as SETTINGS_MAX_HEADER_LIST_SIZE does (rfc7540 6.5.2)
+    hpack_result              Decode          (const uint8_t * src, std::size_t len, header_list & headers, std::size_t max_list_size);
+};
+
+class HPACK_Encoder{
+
+    HPACK_Table               table;
+    bool                      size_update;      // peer changed SETTINGS_HEADER_TABLE_SIZE
+
+    static void               EncodeInteger   (std::uint64_t value, uint8_t prefix, uint8_t flags, std::vector<uint8_t> & dst);
+    static void               EncodeString    (const std::string & str, std::vector<uint8_t> & dst);
+
+    static bool               IsIndexable     (const std::string & name);
+
+  public:
+
+    HPACK_Encoder();
+
+    void                      SetMaxSize      (std::size_t _max_size);
+    void                      Encode          (const header_list & headers, std::vector<uint8_t> & dst);
+};
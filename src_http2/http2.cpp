@@ -0,0 +1,721 @@
+#include <http2.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+const char          HTTP2_Session::PREFACE[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+const std::size_t   HTTP2_Session::PREFACE_SIZE;
+const std::size_t   HTTP2_Session::FRAME_HEADER_SIZE;
+const std::size_t   HTTP2_Session::DEFAULT_FRAME_SIZE;
+const std::int64_t  HTTP2_Session::DEFAULT_WINDOW;
+const std::int64_t  HTTP2_Session::MAX_WINDOW;
+const std::size_t   HTTP2_Session::MAX_HEADER_LIST;
+const std::size_t   HTTP2_Session::MAX_CONTINUATIONS;
+
+namespace {
+  inline uint32_t get_uint32(const uint8_t * src){
+    return (static_cast<uint32_t>(src[0]) << 24) | (static_cast<uint32_t>(src[1]) << 16) |
+           (static_cast<uint32_t>(src[2]) << 8)  |  static_cast<uint32_t>(src[3]);
+  }
+
+  inline void put_uint32(std::vector<uint8_t> & dst, uint32_t value){
+    dst.push_back(value >> 24);
+    dst.push_back(value >> 16);
+    dst.push_back(value >> 8);
+    dst.push_back(value);
+  }
+
+  // value is written into HTTP/1.1 text by handler: no line breaks and NUL (rfc7540 10.3)
+  inline bool is_field_value(const std::string & value){
+    return value.find_first_of(std::string("\r\n\0", 3)) == std::string::npos;
+  }
+
+  // part of request line: no whitespace and controls
+  inline bool is_token(const std::string & value){
+    return value.size() && std::all_of(value.begin(), value.end(), [](unsigned char c){ return c > 0x20 && c != 0x7f; });
+  }
+
+  // rfc7540 8.1.2: names are lowercase
+  inline bool is_field_name(const std::string & name){
+    return name.size() && std::all_of(name.begin(), name.end(), [](unsigned char c){ return c > 0x20 && c != 0x7f && !std::isupper(c); });
+  }
+
+  inline void put_setting(std::vector<uint8_t> & dst, uint16_t id, uint32_t value){
+    dst.push_back(id >> 8);
+    dst.push_back(id);
+    put_uint32(dst, value);
+  }
+}
+
+HTTP2_Session::HTTP2_Session(HTTP2_Transport & _transport, HTTP2_Handler & _handler, std::uint32_t _max_streams) :
+  transport(_transport), handler(_handler), input_pos(0), max_streams(_max_streams), last_stream_id(0),
+  continuation_id(0), continuations(0), conn_send_window(DEFAULT_WINDOW), peer_initial_window(DEFAULT_WINDOW),
+  peer_max_frame(DEFAULT_FRAME_SIZE), is_goaway(false){
+}
+
+void HTTP2_Session::PutFrameHeader(uint8_t * dst, std::size_t length, uint8_t type, uint8_t flags, uint32_t stream_id){
+  stream_id &= 0x7fffffff;
+
+  dst[0] = length >> 16;
+  dst[1] = length >> 8;
+  dst[2] = length;
+  dst[3] = type;
+  dst[4] = flags;
+  dst[5] = stream_id >> 24;
+  dst[6] = stream_id >> 16;
+  dst[7] = stream_id >> 8;
+  dst[8] = stream_id;
+}
+
+bool HTTP2_Session::SendFrame(uint8_t type, uint8_t flags, uint32_t stream_id, const uint8_t * payload, std::size_t length){
+  output.resize(FRAME_HEADER_SIZE + length);
+  PutFrameHeader(output.data(), length, type, flags, stream_id);
+  if (length){
+    std::memcpy(output.data() + FRAME_HEADER_SIZE, payload, length);
+  }
+  return transport.send(output.data(), output.size());
+}
+
+bool HTTP2_Session::SendSettings(){
+  std::vector<uint8_t> payload;
+  put_setting(payload, MAX_CONCURRENT_STREAMS, max_streams);
+  put_setting(payload, ENABLE_PUSH,            0);
+  put_setting(payload, MAX_HEADER_LIST_SIZE,   MAX_HEADER_LIST);
+  return SendFrame(SETTINGS, 0, 0, payload.data(), payload.size());
+}
+
+bool HTTP2_Session::SendRstStream(uint32_t stream_id, uint32_t error){
+  std::vector<uint8_t> payload;
+  put_uint32(payload, error);
+  streams.erase(stream_id);
+  return SendFrame(RST_STREAM, 0, stream_id, payload.data(), payload.size());
+}
+
+bool HTTP2_Session::SendWindowUpdate(uint32_t stream_id, uint32_t increment){
+  std::vector<uint8_t> payload;
+  put_uint32(payload, increment);
+  return SendFrame(WINDOW_UPDATE, 0, stream_id, payload.data(), payload.size());
+}
+
+bool HTTP2_Session::SendGoaway(uint32_t error){
+  std::vector<uint8_t> payload;
+  put_uint32(payload, last_stream_id);
+  put_uint32(payload, error);
+  if (error != NO_ERROR && error != REFUSED_STREAM){
+    std::cerr << "\nError!!! HTTP/2 connection error: " << error << std::endl;
+  }
+  return SendFrame(GOAWAY, 0, 0, payload.data(), payload.size());
+}
+
+bool HTTP2_Session::FillInput(){
+  if (input_pos){
+    input.erase(input.begin(), input.begin() + input_pos);
+    input_pos = 0;
+  }
+
+  std::size_t size = input.size();
+  input.resize(size + DEFAULT_FRAME_SIZE);
+
+  int rc = transport.recv(input.data() + size, DEFAULT_FRAME_SIZE);
+  input.resize(size + (rc > 0 ? rc : 0));
+
+  return rc > 0;
+}
+
+bool HTTP2_Session::ReadPreface(){
+  while (input.size() - input_pos < PREFACE_SIZE){
+    if (!FillInput()){
+      return false;
+    }
+  }
+
+  if (!std::equal(PREFACE, PREFACE + PREFACE_SIZE, input.begin() + input_pos)){
+    SendGoaway(PROTOCOL_ERROR);
+    return false;
+  }
+
+  input_pos += PREFACE_SIZE;
+  return true;
+}
+
+bool HTTP2_Session::ProcessFrames(){
+  while (input.size() - input_pos >= FRAME_HEADER_SIZE){
+    const uint8_t * frame  = input.data() + input_pos;
+    std::size_t     length = (frame[0] << 16) | (frame[1] << 8) | frame[2];
+
+    if (length > DEFAULT_FRAME_SIZE){ // we never announce bigger SETTINGS_MAX_FRAME_SIZE
+      SendGoaway(FRAME_SIZE_ERROR);
+      return false;
+    }
+
+    if (input.size() - input_pos < FRAME_HEADER_SIZE + length){
+      break;
+    }
+
+    input_pos += FRAME_HEADER_SIZE + length;
+
+    if (!ProcessFrame(frame[3], frame[4], get_uint32(frame + 5) & 0x7fffffff, frame + FRAME_HEADER_SIZE, length)){
+      return false;
+    }
+  }
+  return true;
+}
+
+bool HTTP2_Session::ProcessFrame(uint8_t type, uint8_t flags, uint32_t stream_id, const uint8_t * payload, std::size_t length){
+  if (continuation_id && (type != CONTINUATION || stream_id != continuation_id)){
+    SendGoaway(PROTOCOL_ERROR);
+    return false;
+  }
+
+  switch(type){
+    case DATA:
+      return OnData(flags, stream_id, payload, length);
+
+    case HEADERS:
+      return OnHeaders(flags, stream_id, payload, length);
+
+    case CONTINUATION:
+      return OnContinuation(flags, stream_id, payload, length);
+
+    case SETTINGS:
+      return OnSettings(flags, stream_id, payload, length);
+
+    case WINDOW_UPDATE:
+      return OnWindowUpdate(stream_id, payload, length);
+
+    case PRIORITY:
+      if (length != 5){
+        return SendRstStream(stream_id, FRAME_SIZE_ERROR);
+      }
+      return true; // streams are served round-robin, priorities are ignored
+
+    case RST_STREAM:
+      if (!stream_id){
+        SendGoaway(PROTOCOL_ERROR);
+        return false;
+      }
+      if (length != 4){
+        SendGoaway(FRAME_SIZE_ERROR);
+        return false;
+      }
+      streams.erase(stream_id);
+      return true;
+
+    case PING:
+      if (stream_id){
+        SendGoaway(PROTOCOL_ERROR);
+        return false;
+      }
+      if (length != 8){
+        SendGoaway(FRAME_SIZE_ERROR);
+        return false;
+      }
+      return (flags & ACK) || SendFrame(PING, ACK, 0, payload, length);
+
+    case GOAWAY:
+      is_goaway = true;
+      return true;
+
+    case PUSH_PROMISE:  // client must not push
+      SendGoaway(PROTOCOL_ERROR);
+      return false;
+
+    default:            // rfc7540 4.1: unknown frame types are ignored
+      return true;
+  }
+}
+
+bool HTTP2_Session::OnHeaders(uint8_t flags, uint32_t stream_id, const uint8_t * payload, std::size_t length){
+  if (!stream_id || !(stream_id & 1)){
+    SendGoaway(PROTOCOL_ERROR);
+    return false;
+  }
+
+  if (flags & PADDED){
+    if (!length || payload[0] >= length){
+      SendGoaway(PROTOCOL_ERROR);
+      return false;
+    }
+    length -= 1 + payload[0];
+    ++payload;
+  }
+
+  if (flags & PRIORITY_FLAG){
+    if (length < 5){
+      SendGoaway(FRAME_SIZE_ERROR);
+      return false;
+    }
+    payload += 5;
+    length  -= 5;
+  }
+
+  auto it_stream = streams.find(stream_id);
+  if (it_stream == streams.end()){
+    if (stream_id <= last_stream_id || is_goaway){
+      SendGoaway(PROTOCOL_ERROR);
+      return false;
+    }
+
+    last_stream_id = stream_id;
+
+    stream tmp;
+    tmp.body_size        = 0;
+    tmp.sent             = 0;
+    tmp.send_window      = peer_initial_window;
+    tmp.is_remote_closed = false;
+    tmp.is_responding    = false;
+    tmp.is_queued        = false;
+
+    it_stream = streams.insert(std::make_pair(stream_id, tmp)).first;
+  }
+  else if (it_stream->second.is_remote_closed){
+    SendGoaway(STREAM_CLOSED);
+    return false;
+  }
+
+  if (!AddHeaderBlock(it_stream->second, payload, length)){
+    return false;
+  }
+  if (flags & END_STREAM){
+    it_stream->second.is_remote_closed = true;
+  }
+
+  if (!(flags & END_HEADERS)){
+    continuation_id = stream_id;
+    continuations   = 0;
+    return true;
+  }
+
+  return EndHeaders(stream_id);
+}
+
+bool HTTP2_Session::OnContinuation(uint8_t flags, uint32_t stream_id, const uint8_t * payload, std::size_t length){
+  auto it_stream = streams.find(stream_id);
+  if (!continuation_id || it_stream == streams.end()){
+    SendGoaway(PROTOCOL_ERROR);
+    return false;
+  }
+
+  // endless CONTINUATION frames, empty ones too, hold the worker without a request
+  if (++continuations > MAX_CONTINUATIONS){
+    SendGoaway(ENHANCE_YOUR_CALM);
+    return false;
+  }
+
+  if (!AddHeaderBlock(it_stream->second, payload, length)){
+    return false;
+  }
+
+  if (!(flags & END_HEADERS)){
+    return true;
+  }
+
+  continuation_id = 0;
+  return EndHeaders(stream_id);
+}
+
+// fragment is kept until END_HEADERS, block larger than the announced list is refused
+bool HTTP2_Session::AddHeaderBlock(stream & cur, const uint8_t * payload, std::size_t length){
+  if (cur.header_block.size() + length > MAX_HEADER_LIST){
+    SendGoaway(ENHANCE_YOUR_CALM);
+    return false;
+  }
+  cur.header_block.insert(cur.header_block.end(), payload, payload + length);
+  return true;
+}
+
+bool HTTP2_Session::EndHeaders(uint32_t stream_id){
+  stream &    cur = streams[stream_id];
+  header_list headers;
+
+  // header block must be decoded even for refused stream to keep HPACK state in sync,
+  // list over the limit leaves HPACK state unknown, so connection is closed
+  switch(decoder.Decode(cur.header_block.data(), cur.header_block.size(), headers, MAX_HEADER_LIST)){
+    case HPACK_OK:
+      break;
+    case HPACK_TOO_LARGE:
+      SendGoaway(ENHANCE_YOUR_CALM);
+      return false;
+    default:
+      SendGoaway(COMPRESSION_ERROR);
+      return false;
+  }
+  cur.header_block.clear();
+
+  if (cur.request.empty()){
+    cur.request.swap(headers);
+
+    if (streams.size() > max_streams){
+      return SendRstStream(stream_id, REFUSED_STREAM);
+    }
+  }
+  // else - trailers, they are not used
+
+  if (!cur.is_remote_closed){
+    return true;
+  }
+
+  return Respond(stream_id);
+}
+
+bool HTTP2_Session::OnData(uint8_t flags, uint32_t stream_id, const uint8_t * payload, std::size_t length){
+  if (!stream_id){
+    SendGoaway(PROTOCOL_ERROR);
+    return false;
+  }
+
+  std::size_t flow_length = length;
+
+  if (flags & PADDED){
+    if (!length || payload[0] >= length){
+      SendGoaway(PROTOCOL_ERROR);
+      return false;
+    }
+  }
+
+  // body of request is not used, but its bytes must be returned to peer's window
+  if (flow_length && !SendWindowUpdate(0, flow_length)){
+    return false;
+  }
+
+  auto it_stream = streams.find(stream_id);
+  if (it_stream == streams.end() || it_stream->second.is_remote_closed){
+    if (stream_id > last_stream_id){
+      SendGoaway(PROTOCOL_ERROR);
+      return false;
+    }
+    return SendRstStream(stream_id, STREAM_CLOSED);
+  }
+
+  if (!(flags & END_STREAM)){
+    return !flow_length || SendWindowUpdate(stream_id, flow_length);
+  }
+
+  it_stream->second.is_remote_closed = true;
+  return Respond(stream_id);
+}
+
+bool HTTP2_Session::OnSettings(uint8_t flags, uint32_t stream_id, const uint8_t * payload, std::size_t length){
+  if (stream_id){
+    SendGoaway(PROTOCOL_ERROR);
+    return false;
+  }
+
+  if (flags & ACK){
+    if (length){
+      SendGoaway(FRAME_SIZE_ERROR);
+      return false;
+    }
+    return true;
+  }
+
+  if (length % 6){
+    SendGoaway(FRAME_SIZE_ERROR);
+    return false;
+  }
+
+  for (const uint8_t * end = payload + length; payload < end; payload += 6){
+    uint16_t id    = (payload[0] << 8) | payload[1];
+    uint32_t value = get_uint32(payload + 2);
+
+    switch(id){
+      case HEADER_TABLE_SIZE:
+        encoder.SetMaxSize(value);
+        break;
+
+      case ENABLE_PUSH:
+        if (value > 1){
+          SendGoaway(PROTOCOL_ERROR);
+          return false;
+        }
+        break;
+
+      case INITIAL_WINDOW_SIZE:{
+        if (value > MAX_WINDOW){
+          SendGoaway(FLOW_CONTROL_ERROR);
+          return false;
+        }
+
+        // rfc7540 6.9.2: change applies to all open streams
+        std::int64_t delta  = static_cast<std::int64_t>(value) - peer_initial_window;
+        peer_initial_window = value;
+
+        for (auto it = streams.begin(); it != streams.end(); ++it){
+          stream & cur      = it->second;
+          cur.send_window  += delta;
+          if (cur.is_responding && !cur.is_queued && cur.send_window > 0){
+            cur.is_queued = true;
+            ready.push_back(it->first);
+          }
+        }
+        break;
+      }
+
+      case MAX_FRAME_SIZE:
+        if (value < DEFAULT_FRAME_SIZE || value > 0xffffff){
+          SendGoaway(PROTOCOL_ERROR);
+          return false;
+        }
+        peer_max_frame = value;
+        break;
+
+      default:
+        break;
+    }
+  }
+
+  return SendFrame(SETTINGS, ACK, 0, nullptr, 0);
+}
+
+bool HTTP2_Session::OnWindowUpdate(uint32_t stream_id, const uint8_t * payload, std::size_t length){
+  if (length != 4){
+    SendGoaway(FRAME_SIZE_ERROR);
+    return false;
+  }
+
+  std::uint32_t increment = get_uint32(payload) & 0x7fffffff;
+
+  if (!stream_id){
+    if (!increment){
+      SendGoaway(PROTOCOL_ERROR);
+      return false;
+    }
+    conn_send_window += increment;
+    if (conn_send_window > MAX_WINDOW){
+      SendGoaway(FLOW_CONTROL_ERROR);
+      return false;
+    }
+    return true;
+  }
+
+  auto it_stream = streams.find(stream_id);
+  if (it_stream == streams.end()){
+    return true; // stream may be already closed by us
+  }
+
+  if (!increment){
+    return SendRstStream(stream_id, PROTOCOL_ERROR);
+  }
+
+  stream & cur      = it_stream->second;
+  cur.send_window  += increment;
+  if (cur.send_window > MAX_WINDOW){
+    return SendRstStream(stream_id, FLOW_CONTROL_ERROR);
+  }
+
+  if (cur.is_responding && !cur.is_queued && cur.send_window > 0){
+    cur.is_queued = true;
+    ready.push_back(stream_id);
+  }
+  return true;
+}
+
+void HTTP2_Session::SplitHead(const std::vector<uint8_t> & head, header_list & headers){
+  const char * begin = reinterpret_cast<const char *>(head.data());
+  const char * end   = begin + head.size();
+
+  // status line: "HTTP/1.1 200 OK"
+  const char * eol   = std::find(begin, end, '\n');
+  const char * code  = std::find(begin, eol, ' ');
+  headers.push_back(header_field(":status", std::string(code + (code != eol), std::min<std::size_t>(3, eol - code))));
+
+  // header lines until empty line, names are lowercase in HTTP/2
+  for (begin = eol + (eol != end); begin < end; begin = eol + (eol != end)){
+    eol = std::find(begin, end, '\n');
+
+    const char * line_end = (eol > begin && eol[-1] == '\r') ? eol - 1 : eol;
+    if (line_end == begin){
+      break;
+    }
+
+    const char * colon = std::find(begin, line_end, ':');
+    std::string  name(begin, colon);
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+    const char * value = colon + (colon != line_end);
+    while (value < line_end && *value == ' ') ++value;
+
+    if (name == "connection" || value == line_end){
+      continue;
+    }
+    headers.push_back(header_field(name, std::string(value, line_end)));
+  }
+}
+
+bool HTTP2_Session::Respond(uint32_t stream_id){
+  stream & cur = streams[stream_id];
+
+  if (!IsValidRequest(cur.request)){
+    return SendRstStream(stream_id, PROTOCOL_ERROR);
+  }
+
+  HTTP2_Respond respond;
+  header_list   headers;
+
+  respond.body_size = 0;
+  handler(cur.request, respond);
+  SplitHead(respond.head, headers);
+
+  std::vector<uint8_t> block;
+  encoder.Encode(headers, block);
+
+  bool is_end_stream = !respond.body_size;
+
+  // header block larger than peer's frame goes as HEADERS + CONTINUATION
+  std::size_t offset = 0;
+  do{
+    std::size_t chunk   = std::min(block.size() - offset, peer_max_frame);
+    bool        is_last = offset + chunk == block.size();
+    uint8_t     flags   = (is_last ? END_HEADERS : 0) | (!offset && is_end_stream ? END_STREAM : 0);
+
+    if (!SendFrame(offset ? CONTINUATION : HEADERS, flags, stream_id, block.data() + offset, chunk)){
+      return false;
+    }
+    offset += chunk;
+  } while (offset < block.size());
+
+  if (is_end_stream){
+    streams.erase(stream_id);
+    return true;
+  }
+
+  cur.body_size     = respond.body_size;
+  cur.read_body     = std::move(respond.read_body);
+  cur.is_responding = true;
+
+  if (cur.send_window > 0){
+    cur.is_queued = true;
+    ready.push_back(stream_id);
+  }
+  return true;
+}
+
+// one DATA frame for each ready stream
+bool HTTP2_Session::SendDataRound(){
+  for (std::size_t n = ready.size(); n && conn_send_window > 0; --n){
+    uint32_t stream_id = ready.front();
+    ready.pop_front();
+
+    auto it_stream = streams.find(stream_id);
+    if (it_stream == streams.end()){
+      continue; // reset by peer
+    }
+
+    stream &    cur   = it_stream->second;
+    std::size_t chunk = std::min<std::int64_t>(std::min<std::int64_t>(peer_max_frame, cur.body_size - cur.sent),
+                                               std::min(cur.send_window, conn_send_window));
+    bool        is_last = cur.sent + chunk == cur.body_size;
+
+    // body is read straight into the frame
+    output.resize(FRAME_HEADER_SIZE + chunk);
+    if (cur.read_body(output.data() + FRAME_HEADER_SIZE, chunk) != chunk){
+      // file became shorter than its Content-Length
+      if (!SendRstStream(stream_id, INTERNAL_ERROR)){
+        return false;
+      }
+      continue;
+    }
+
+    PutFrameHeader(output.data(), chunk, DATA, is_last ? END_STREAM : 0, stream_id);
+    if (!transport.send(output.data(), output.size())){
+      return false;
+    }
+
+    cur.sent          += chunk;
+    cur.send_window   -= chunk;
+    conn_send_window  -= chunk;
+
+    if (is_last){
+      streams.erase(it_stream);
+      continue;
+    }
+
+    cur.is_queued = cur.send_window > 0;
+    if (cur.is_queued){
+      ready.push_back(stream_id);
+    }
+  }
+  return true;
+}
+
+// CONNECT is not served, so :path and :scheme are required
+bool HTTP2_Session::IsValidRequest(const header_list & request){
+  const std::string * method = nullptr, * scheme = nullptr, * path = nullptr, * authority = nullptr;
+  bool                is_regular = false;
+
+  for (auto it = request.begin(); it != request.end(); ++it){
+    const std::string & name  = it->first;
+    const std::string & value = it->second;
+
+    if (!is_field_name(name) || !is_field_value(value)){
+      return false;
+    }
+
+    if (name[0] == ':'){
+      const std::string ** field = name == ":method"    ? &method    :
+                                   name == ":scheme"    ? &scheme    :
+                                   name == ":path"      ? &path      :
+                                   name == ":authority" ? &authority : nullptr;
+      // pseudo-headers are known, single and go before regular fields
+      if (!field || *field || is_regular){
+        return false;
+      }
+      *field = &value;
+      continue;
+    }
+    is_regular = true;
+
+    // rfc7540 8.1.2.2: connection-specific fields
+    if (name == "connection" || name == "keep-alive" || name == "proxy-connection" ||
+        name == "transfer-encoding" || name == "upgrade" || (name == "te" && value != "trailers")){
+      return false;
+    }
+  }
+
+  if (!method || !scheme || !path || !is_token(*method) || !is_token(*path) || (authority && !is_token(*authority))){
+    return false;
+  }
+  return (*path)[0] == '/' || (*path == "*" && *method == "OPTIONS");
+}
+
+void HTTP2_Session::Serve(const uint8_t * received, std::size_t size){
+  input.assign(received, received + size);
+  input_pos = 0;
+
+  if (!SendSettings() || !ReadPreface()){
+    return;
+  }
+
+  while (true){
+    if (!ProcessFrames()){
+      return;
+    }
+
+    // send while there is window, new frames are read as soon as they arrive
+    if (ready.size() && conn_send_window > 0 && !transport.readable()){
+      if (!SendDataRound()){
+        return;
+      }
+      continue;
+    }
+
+    if (is_goaway && streams.empty()){
+      SendGoaway(NO_ERROR);
+      return;
+    }
+
+    if (!FillInput()){
+      return;
+    }
+  }
+}
+
+void HTTP2_Session::Refuse(const uint8_t * received, std::size_t size){
+  input.assign(received, received + size);
+  input_pos = 0;
+
+  if (SendSettings() && ReadPreface()){
+    SendGoaway(REFUSED_STREAM);
+  }
+}
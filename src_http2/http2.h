@@ -0,0 +1,162 @@
+#pragma once
+
+#include <iostream>
+#include <functional>
+#include <string>
+#include <vector>
+#include <map>
+#include <deque>
+#include <cstdint>
+
+#include <hpack.h>
+
+// HTTP/2 (RFC 7540) connection served by single worker: frame parser,
+// per-stream flow control and round-robin scheduling of DATA frames, so
+// every stream of the connection progresses with equal share of the window.
+
+struct HTTP2_Transport{
+    std::function<int  (uint8_t * dst, std::size_t size)>        recv;     // blocking, <= 0 - connection is gone
+    std::function<bool (const uint8_t * src, std::size_t size)>  send;     // sends everything or fails
+    std::function<bool ()>                                       readable; // input is available without blocking
+};
+
+// respond of stream: status line and headers as HTTP/1.1 text go as HEADERS,
+// body is read by parts of DATA frames, so it is never copied whole
+struct HTTP2_Respond{
+    std::vector<uint8_t>                                          head;
+    std::size_t                                                   body_size;
+    std::function<std::size_t (uint8_t * dst, std::size_t size)>  read_body; // less than `size` - body is broken
+};
+
+typedef std::function<void (const header_list & request, HTTP2_Respond & respond)> HTTP2_Handler;
+
+class HTTP2_Session{
+
+    enum frame_type : uint8_t{
+      DATA          = 0x0,
+      HEADERS       = 0x1,
+      PRIORITY      = 0x2,
+      RST_STREAM    = 0x3,
+      SETTINGS      = 0x4,
+      PUSH_PROMISE  = 0x5,
+      PING          = 0x6,
+      GOAWAY        = 0x7,
+      WINDOW_UPDATE = 0x8,
+      CONTINUATION  = 0x9,
+    };
+
+    enum frame_flag : uint8_t{
+      END_STREAM    = 0x1,
+      ACK           = 0x1,
+      END_HEADERS   = 0x4,
+      PADDED        = 0x8,
+      PRIORITY_FLAG = 0x20,
+    };
+
+    enum error_code : uint32_t{
+      NO_ERROR            = 0x0,
+      PROTOCOL_ERROR      = 0x1,
+      INTERNAL_ERROR      = 0x2,
+      FLOW_CONTROL_ERROR  = 0x3,
+      STREAM_CLOSED       = 0x5,
+      FRAME_SIZE_ERROR    = 0x6,
+      REFUSED_STREAM      = 0x7,
+      COMPRESSION_ERROR   = 0x9,
+      ENHANCE_YOUR_CALM   = 0xb,
+    };
+
+    enum settings_id : uint16_t{
+      HEADER_TABLE_SIZE       = 0x1,
+      ENABLE_PUSH             = 0x2,
+      MAX_CONCURRENT_STREAMS  = 0x3,
+      INITIAL_WINDOW_SIZE     = 0x4,
+      MAX_FRAME_SIZE          = 0x5,
+      MAX_HEADER_LIST_SIZE    = 0x6,
+    };
+
+    struct stream{
+      header_list           request;
+      std::vector<uint8_t>  header_block;   // HEADERS + CONTINUATION fragments
+      std::size_t           body_size;      // DATA of respond
+      std::function<std::size_t (uint8_t * dst, std::size_t size)> read_body;
+      std::size_t           sent;
+      std::int64_t          send_window;
+      bool                  is_remote_closed;
+      bool                  is_responding;
+      bool                  is_queued;      // stream is in `ready`
+    };
+
+    static const std::size_t    FRAME_HEADER_SIZE   = 9;
+    static const std::size_t    DEFAULT_FRAME_SIZE  = 16384;
+    static const std::int64_t   DEFAULT_WINDOW      = 65535;
+    static const std::int64_t   MAX_WINDOW          = 0x7fffffff;
+    static const std::size_t    MAX_HEADER_LIST     = 65536;  // announced SETTINGS_MAX_HEADER_LIST_SIZE, bound of header block too
+    static const std::size_t    MAX_CONTINUATIONS   = 32;     // CONTINUATION frames of one header block
+
+    HTTP2_Transport             transport;
+    HTTP2_Handler               handler;
+
+    HPACK_Decoder               decoder;
+    HPACK_Encoder               encoder;
+
+    std::vector<uint8_t>        input;
+    std::size_t                 input_pos;
+    std::vector<uint8_t>        output;
+
+    std::map<uint32_t, stream>  streams;
+    std::deque<uint32_t>        ready;          // streams with DATA to send, in round-robin order
+
+    std::uint32_t               max_streams;
+    std::uint32_t               last_stream_id;
+    std::uint32_t               continuation_id; // != 0 - header block is not finished
+    std::size_t                 continuations;   // frames of this block
+
+    std::int64_t                conn_send_window;
+    std::int64_t                peer_initial_window;
+    std::size_t                 peer_max_frame;
+
+    bool                        is_goaway;
+
+    inline void   PutFrameHeader    (uint8_t * dst, std::size_t length, uint8_t type, uint8_t flags, uint32_t stream_id);
+    inline bool   SendFrame         (uint8_t type, uint8_t flags, uint32_t stream_id, const uint8_t * payload, std::size_t length);
+    inline bool   SendSettings      ();
+    inline bool   SendRstStream     (uint32_t stream_id, uint32_t error);
+    inline bool   SendWindowUpdate  (uint32_t stream_id, uint32_t increment);
+    inline bool   SendGoaway        (uint32_t error);
+
+    inline bool   AddHeaderBlock    (stream & cur, const uint8_t * payload, std::size_t length);
+
+    bool          ReadPreface       ();
+    bool          FillInput         ();
+    bool          ProcessFrames     ();
+    bool          ProcessFrame      (uint8_t type, uint8_t flags, uint32_t stream_id, const uint8_t * payload, std::size_t length);
+
+    bool          OnHeaders         (uint8_t flags, uint32_t stream_id, const uint8_t * payload, std::size_t length);
+    bool          OnContinuation    (uint8_t flags, uint32_t stream_id, const uint8_t * payload, std::size_t length);
+    bool          OnData            (uint8_t flags, uint32_t stream_id, const uint8_t * payload, std::size_t length);
+    bool          OnSettings        (uint8_t flags, uint32_t stream_id, const uint8_t * payload, std::size_t length);
+    bool          OnWindowUpdate    (uint32_t stream_id, const uint8_t * payload, std::size_t length);
+
+    bool          EndHeaders        (uint32_t stream_id);
+    bool          Respond           (uint32_t stream_id);
+    bool          SendDataRound     ();
+
+    static void   SplitHead         (const std::vector<uint8_t> & head, header_list & headers);
+
+  public:
+
+    static const char           PREFACE[];
+    static const std::size_t    PREFACE_SIZE = 24;
+
+    HTTP2_Session() = delete;
+    HTTP2_Session(HTTP2_Transport & _transport, HTTP2_Handler & _handler, std::uint32_t _max_streams);
+
+    // `received` - bytes that were already read from connection (prior-knowledge preface)
+    void          Serve             (const uint8_t * received, std::size_t size);
+    // server has no room for connection: GOAWAY REFUSED_STREAM, nothing is served, client may retry
+    void          Refuse            (const uint8_t * received, std::size_t size);
+
+    // rfc7540 8.1.2: malformed request is reset with PROTOCOL_ERROR before handler sees it,
+    // so fields are safe to be written into HTTP/1.1 text
+    static bool   IsValidRequest    (const header_list & request);
+};
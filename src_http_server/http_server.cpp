@@ -1,6 +1,10 @@
 #include <http_server.h>
 
-void HTTP_Server::additional_tools(){
+template <class Policies>
+Basic_HTTP_Server<Policies> * Basic_HTTP_Server<Policies>::instance = nullptr;
+
+template <class Policies>
+void Basic_HTTP_Server<Policies>::additional_tools(){
   {
     struct termios old, _new;
     /* Turn echoing off and fail if we can't. */
@@ -36,9 +40,25 @@ void HTTP_Server::additional_tools(){
   if (signal(SIGUSR1, SIGUSR1_Handler) == SIG_ERR) {
     std::cerr << "\nAn error occurred while setting a signal handler.\n\n";
   }
+
+  // set handler to signal SIGUSR2: print statistics
+  if (signal(SIGUSR2, SIGUSR2_Handler) == SIG_ERR) {
+    std::cerr << "\nAn error occurred while setting a signal handler.\n\n";
+  }
+
+  // event loop ends and destructor saves hot list and buffered capture
+  if (signal(SIGTERM, SIGTERM_Handler) == SIG_ERR || signal(SIGINT, SIGTERM_Handler) == SIG_ERR) {
+    std::cerr << "\nAn error occurred while setting a signal handler.\n\n";
+  }
+
+  // peer may reset connection in the middle of SSL_write/sendfile, it must not kill the server
+  if (signal(SIGPIPE, SIG_IGN) == SIG_ERR) {
+    std::cerr << "\nAn error occurred while ignoring signal SIGPIPE.\n\n";
+  }
 }
 
-void HTTP_Server::init(const char * pathname_config){
+template <class Policies>
+void Basic_HTTP_Server<Policies>::init(const char * pathname_config){
 
   // load server configuration from xml file
   {
@@ -50,116 +70,526 @@ void HTTP_Server::init(const char * pathname_config){
 
   std::cout << "\n\033[1;35mInitializing server...\033[0m\n\n";
 
+  NUMA_Topology::PinThread(pthread_self(), info.reactor_cpus);
+
+  workers          = nullptr;
+  number_workers   = 0;
+  governor         = nullptr;
+  prefork          = nullptr;
+  shared_cache     = nullptr;
+  slot             = nullptr;
+  reload_requested = 0;
+  report_requested = 0;
+  stop_requested   = 0;
+  wake_fd          = -1;
+  tracer           = nullptr;
+  sampled.clear();
+
+  capture = nullptr;
+  if (info.capture_file.size()){
+    capture = new Traffic_Capture(info.capture_file);
+  }
+
+  InitHosts();
+
+  autoindex = nullptr;
+  if (info.autoindex){
+    autoindex = new Directory_Index(info.autoindex_page_size);
+  }
+
+  bundle = nullptr;
+  if (info.bundle_path.size()){
+    bundle = new Static_Bundle(info.bundle_path);
+    if (!bundle->IsOpen()){
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  socket_fd     = CreateListener(info.port);
+  tls_socket_fd = -1;
+  tls           = nullptr;
+
+  // add socket that receive new connection to set of event loop
+  poller.Add(socket_fd, POLLIN);
+
+  if (info.tls_port){
+#ifdef HTTP_SERVER_WITH_TLS
+    tls           = new TLS_Context(info);
+    tls_socket_fd = CreateListener(info.tls_port);
+
+    poller.Add(tls_socket_fd, POLLIN);
+#else
+    std::cerr << "\n\033[1;35mWarning!!! Server was built without TLS support, field TLS-port is ignored.\033[0m\n\n";
+#endif
+  }
+
+  // master only listens and forks, every worker process creates the rest for itself
+  if (info.prefork_processes){
+    prefork = new Prefork_Stats(info.prefork_processes);
+    if (!prefork->IsOpen()){
+      exit(EXIT_FAILURE);
+    }
+    if (info.prefork_shared_cache){
+      shared_cache = new Shared_Cache(info.prefork_shared_cache, info.cache_max_file_size, info.prefork_processes);
+    }
+    return;
+  }
+
+  StartServing();
+}
+
+// default host takes requests without Host header or with unknown one
+template <class Policies>
+void Basic_HTTP_Server<Policies>::InitHosts(){
+  virtual_host_info host;
+  host.root_path           = info.root_path;
+  host.cache_size          = info.cache_size;
+  host.cache_max_file_size = info.cache_max_file_size;
+  host.http2_idle_timeout  = info.http2_idle_timeout;
+
+  // hosts of the previous configuration are kept until now only on reload
+  bool is_reload = !hosts.empty();
+
+  hosts.assign(1, host);
+  hosts.insert(hosts.end(), info.virtual_hosts.begin(), info.virtual_hosts.end());
+
+  std::vector<std::pair<std::string, std::uint32_t>> names;
+  for (std::size_t i = 1; i < hosts.size(); ++i){
+    for (auto it = hosts[i].names.begin(); it != hosts[i].names.end(); ++it){
+      names.emplace_back(*it, i);
+    }
+  }
+
+  // running server keeps serving: every request goes to root-path
+  if (!host_table.Build(names)){
+    Policies::logger::Error("Cannot build table of virtual hosts!", is_reload ? "Virtual hosts are disabled." : nullptr);
+    if (!is_reload){
+      exit(EXIT_FAILURE);
+    }
+    hosts.resize(1);
+    host_table.Build({});
+    return;
+  }
+  if (names.size()){
+    std::cout << "\033[1;35mVirtual hosts: " << hosts.size() - 1 << ", names: " << names.size()
+              << ", table slots: " << host_table.Slots() << "\033[0m\n";
+  }
+}
+
+template <class Policies>
+void Basic_HTTP_Server<Policies>::StartServing(){
+  { // workers wake up event loop when they park connection with unsent respond
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd < 0){
+      Policies::logger::Error("Function eventfd failed!", strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+
+    poller.Add(wake_fd, POLLIN);
+  }
+
+  // every worker process samples its own requests
+  if (info.trace_sample_rate){
+    tracer = new Request_Tracer(info.trace_sample_rate, info.trace_ring_size);
+  }
+
+  StartWorkers();
+}
+
+// workers are pinned round-robin to worker-cpus, one cpu each. NUMA nodes which
+// have workers get their own task queue (incoming-cpu) and cache shard (numa-local).
+// Slots up to max-workers are placed the same way, started ones are number-workers
+template <class Policies>
+void Basic_HTTP_Server<Policies>::StartWorkers(){
+  number_workers = info.max_workers;
+  workers        = new worker_ctx[number_workers]();
+
+  std::vector<bool> has_workers(topology.Nodes(), false);
+  for(std::size_t i = 0; i < number_workers; ++i){
+    if (info.worker_cpus.size()){
+      int cpu         = info.worker_cpus[i % info.worker_cpus.size()];
+      workers[i].cpus = std::vector<int>(1, cpu);
+      workers[i].node = topology.NodeOf(cpu);
+    }
+    // queue of node without started workers would never be served
+    if (i < info.number_workers){
+      has_workers[workers[i].node] = true;
+    }
+  }
+
+  std::size_t used_nodes = 0;
+  node_index.assign(topology.Nodes(), 0);
+  for (std::size_t node = 0; node < topology.Nodes(); ++node){
+    if (has_workers[node]) node_index[node] = used_nodes++;
+  }
+  // no started worker: the only queue waits for the pool to grow
+  if (!used_nodes){
+    used_nodes = 1;
+  }
+  for (std::size_t node = 0; node < topology.Nodes(); ++node){
+    if (!has_workers[node]) node_index[node] = node % used_nodes;
+  }
+
+  if ((info.incoming_cpu || info.numa_local) && info.worker_cpus.empty()){
+    std::cerr << "\n\033[1;35mWarning!!! incoming-cpu and numa-local need worker-cpus, they are ignored.\033[0m\n\n";
+  }
+
+  std::size_t number_queues = info.incoming_cpu ? used_nodes : 1;
+  std::size_t number_shards = info.numa_local   ? used_nodes : 1;
+
+  queues.clear();
+  for (std::size_t i = 0; i < number_queues; ++i){
+    queues.emplace_back();
+  }
+
+  // budget of every host is split between its shards, so one site cannot evict another
+  caches.assign(hosts.size(), std::vector<Content_Cache *>());
+  for (std::size_t host = 0; host < hosts.size(); ++host){
+    for (std::size_t i = 0; hosts[host].cache_size && i < number_shards; ++i){
+      caches[host].push_back(new Content_Cache(hosts[host].cache_size / number_shards, hosts[host].cache_max_file_size,
+                                               [this](cache_entry & entry){ this->BuildCachedHeaders(entry); }));
+    }
+  }
+
+  // workers read it, so it is set before they start
+  if (!slot && info.min_workers < info.max_workers){
+    governor = new Pool_Governor(info.min_workers, info.max_workers);
+  }
+
+  // create "pool" of thread, and start each thread
+  queue_workers.assign(number_queues, 0);
+  active_workers = 0;
+  dequeued       = 0;
+  queue_wait_ns  = 0;
+  disk_wait_ns   = 0;
+  http2_connections = 0;
+  for(std::size_t i = 0; i < number_workers; ++i){
+    workers[i].queue = info.incoming_cpu ? node_index[workers[i].node] : 0;
+    workers[i].shard = info.numa_local   ? node_index[workers[i].node] : 0;
+
+    // worker process serves connections in its event loop
+    if (slot){
+      NUMA_Topology::PinThread(pthread_self(), workers[i].cpus);
+      PrepareWorker(workers[i]);
+      continue;
+    }
+    if (i < info.number_workers){
+      StartWorker(i);
+    }
+  }
+
+  if (governor){
+    governor_stopped = false;
+    governor_thread  = std::thread([this](){ this->RunGovernor(); });
+  }
+}
+
+template <class Policies>
+void Basic_HTTP_Server<Policies>::StartWorker(std::size_t index){
+  worker_ctx & self = workers[index];
+
+  // thread of retired worker has returned already
+  if (self.thread.joinable()){
+    self.thread.join();
+  }
+
+  self.running = true;
+  ++queue_workers[self.queue];
+  ++active_workers;
+  self.thread = std::thread([this, index](){this->RequestHandler(index);});
+}
+
+// load is sampled every interval, decision is taken by Pool_Governor
+template <class Policies>
+void Basic_HTTP_Server<Policies>::RunGovernor(){
+  std::uint64_t last_ns = Pool_Governor::Now(), last_dequeued = 0, last_wait_ns = 0, last_busy_ns = 0, last_io_ns = 0;
+
+  std::unique_lock<std::mutex> lk(governor_mtx);
+  while (!governor_cv.wait_for(lk, std::chrono::milliseconds(POOL_INTERVAL_MS), [this]{ return governor_stopped; })){
+    std::uint64_t now = Pool_Governor::Now(), busy_ns = 0;
+
+    // connection being served counts up to now
+    for (std::size_t i = 0; i < number_workers; ++i){
+      std::uint64_t since = workers[i].busy_since;
+      busy_ns += workers[i].busy_ns + (since && since < now ? now - since : 0);
+    }
+
+    pool_sample sample;
+    sample.active         = active_workers;
+    sample.interval_ns    = now - last_ns;
+    sample.dequeued       = dequeued - last_dequeued;
+    sample.queue_wait_ns  = queue_wait_ns - last_wait_ns;
+    sample.busy_ns        = busy_ns > last_busy_ns ? busy_ns - last_busy_ns : 0;
+    sample.io_wait_ns     = disk_wait_ns - last_io_ns;
+
+    last_ns       = now;
+    last_dequeued += sample.dequeued;
+    last_wait_ns  += sample.queue_wait_ns;
+    last_busy_ns  = std::max(busy_ns, last_busy_ns);
+    last_io_ns    += sample.io_wait_ns;
+
+    ResizePool(governor->Decide(sample));
+  }
+}
+
+// retired worker leaves by a task with fd -2, every queue keeps one worker at least
+template <class Policies>
+void Basic_HTTP_Server<Policies>::ResizePool(std::size_t target){
+  for (std::size_t i = 0; i < number_workers && active_workers < target; ++i){
+    if (!workers[i].running){
+      StartWorker(i);
+    }
+  }
+
+  for (std::size_t i = number_workers; i-- > 0 && active_workers > target;){
+    worker_ctx & self = workers[i];
+    if (self.running && queue_workers[self.queue] > 1){
+      --queue_workers[self.queue];
+      --active_workers;
+      queues[self.queue].Push(connection{-2, nullptr, false, -1, 0});
+    }
+  }
+}
+
+template <class Policies>
+void Basic_HTTP_Server<Policies>::StopGovernor(){
+  if (!governor_thread.joinable()){
+    return;
+  }
+
+  std::unique_lock<std::mutex> lk(governor_mtx);
+  governor_stopped = true;
+  lk.unlock();
+  governor_cv.notify_all();
+
+  governor_thread.join();
+}
+
+template <class Policies>
+void Basic_HTTP_Server<Policies>::FreePool(){
+  StopGovernor();
+  delete governor;
+  governor = nullptr;
+}
+
+template <class Policies>
+void Basic_HTTP_Server<Policies>::ReportPool(){
+  std::cout << "\n\033[1;37mWorker pool report:\033[0m\n";
+  if (governor){
+    governor->Print(active_workers);
+  }
+  else{
+    std::cout << "workers: " << active_workers << " (fixed)" << std::endl;
+  }
+}
+
+// filesystem call of worker, its time tells governor that workers are blocked on disk rather than busy
+template <class Policies>
+template <class F>
+void Basic_HTTP_Server<Policies>::Blocking(F && operation){
+  if (!governor){
+    operation();
+    return;
+  }
+  std::uint64_t start = Pool_Governor::Now();
+  operation();
+  disk_wait_ns += Pool_Governor::Now() - start;
+}
+
+template <class Policies>
+void Basic_HTTP_Server<Policies>::PrepareWorker(worker_ctx & self){
+  self.buff.assign(MAX_BUFFER_SIZE, 0);
+  self.arena.reset(new allocator(REQUEST_ARENA_SIZE));
+}
+
+template <class Policies>
+int Basic_HTTP_Server<Policies>::CreateListener(std::uint16_t port){
+  union{
+      sockaddr_in                 v4;
+      sockaddr_in6                v6;
+  } socket_addr;
+
   memset(&socket_addr, 0, sizeof(socket_addr));
 
-  socket_fd = socket(info.is_ipv4 ? AF_INET : AF_INET6, SOCK_STREAM, IPPROTO_TCP);
+  int listen_fd = socket(info.is_ipv4 ? AF_INET : AF_INET6, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
 
-  if (socket_fd < 0) {
-    std::cerr << "\n\033[1;31mError!!! Cannot create socket! \033[0m\033[1;35" << strerror(errno) << "\033[0m\n\n";
+  if (listen_fd < 0) {
+    Policies::logger::Error("Cannot create socket!", strerror(errno));
     exit(EXIT_FAILURE);
   }
   int rc, on = 1;
 
-  rc = setsockopt(socket_fd, SOL_SOCKET, SO_REUSEADDR, (char *)&on, sizeof(on));
+  rc = setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, (char *)&on, sizeof(on));
   if (rc < 0){
-    std::cerr << "\n\033[1;31mError!!! Function setsockopt! \033[0m\033[1;35" << strerror(errno) << "\033[0m\n\n";
-    close(socket_fd);
+    Policies::logger::Error("Function setsockopt!", strerror(errno));
+    close(listen_fd);
     exit(EXIT_FAILURE);
   }
 
-  rc = ioctl(socket_fd, FIONBIO, (char *)&on);
-  if (rc < 0){
-    std::cerr << "\n\033[1;31mError!!! Function ioctl! \033[0m\033[1;35" << strerror(errno) << "\033[0m\n\n";
-    close(socket_fd);
-    exit(EXIT_FAILURE);
-  }
+  // accepted sockets inherit buffers and TCP_NODELAY, so they are set once here
+  Socket_Options::TuneListener(listen_fd, info);
 
   if(info.is_ipv4){
     socket_addr.v4.sin_family = AF_INET;
-    socket_addr.v4.sin_port   = htons(info.port);
+    socket_addr.v4.sin_port   = htons(port);
     rc                        = inet_pton(AF_INET, info.ip.c_str(), &socket_addr.v4.sin_addr);
   }
   else{
     socket_addr.v6.sin6_family = AF_INET6;
-    socket_addr.v6.sin6_port   = htons(info.port);
+    socket_addr.v6.sin6_port   = htons(port);
     rc                         = inet_pton(AF_INET6, info.ip.c_str(), &socket_addr.v6.sin6_addr);
   }
   if (rc <= 0 ){
-    std::cerr << "\n\033[1;31mError!!! Function inet_pton! \033[0m\033[1;35" << strerror(errno) << "\033[0m\n\n";
-    close(socket_fd);
+    Policies::logger::Error("Function inet_pton!", strerror(errno));
+    close(listen_fd);
     exit(EXIT_FAILURE);
   }
 
-  if (bind(socket_fd, (sockaddr *)&socket_addr, info.is_ipv4 ? sizeof(socket_addr.v4) : sizeof(socket_addr.v6)) == -1) {
-    std::cerr << "\n\033[1;31mError!!! Bind failed! \033[0m\033[1;35m" << strerror(errno) << "\033[0m\n\n";
-    close(socket_fd);
+  if (bind(listen_fd, (sockaddr *)&socket_addr, info.is_ipv4 ? sizeof(socket_addr.v4) : sizeof(socket_addr.v6)) == -1) {
+    Policies::logger::Error("Bind failed!", strerror(errno));
+    close(listen_fd);
     exit(EXIT_FAILURE);
   }
 
-  if (listen(socket_fd, MAX_LISTENING_CLIENTS) == -1) {
-    std::cerr << "\n\033[1;31mError!!! Listen failed! \033[0m\033[1;35m" << strerror(errno) << "\033[0m\n\n";
-    close(socket_fd);
+  if (listen(listen_fd, info.listen_backlog) == -1) {
+    Policies::logger::Error("Listen failed!", strerror(errno));
+    close(listen_fd);
     exit(EXIT_FAILURE);
   }
 
-  { // add socket that receive new connection to vector of pollfd structures
-    pollfd tmp;
-    tmp.fd        = socket_fd;
-    tmp.events    = POLLIN;
+  return listen_fd;
+}
+
+template <class Policies>
+Basic_HTTP_Server<Policies>::Basic_HTTP_Server(std::string & pathname_config){
+  instance = this;
+  init(pathname_config.c_str());
+  additional_tools();
+  StartWarmup();
+}
+
+template <class Policies>
+Basic_HTTP_Server<Policies>::Basic_HTTP_Server(const char * pathname_config){
+  instance = this;
+  init(pathname_config);
+  additional_tools();
+  StartWarmup();
+}
+
+// cached headers depend on MIME types, so warmup starts after additional_tools
+template <class Policies>
+void Basic_HTTP_Server<Policies>::StartWarmup(){
+  if (!info.warmup){
+    return;
+  }
+
+  // every shard is filled by threads of its own node
+  for (std::size_t host = 0; host < caches.size(); ++host){
+    if (hosts[host].root_path.empty()){
+      continue;
+    }
+    for (std::size_t shard = 0; shard < caches[host].size(); ++shard){
+      std::vector<int> cpus;
+      if (caches[host].size() > 1){
+        for (std::size_t node = 0; node < topology.Nodes(); ++node){
+          if (node_index[node] == shard){
+            cpus.insert(cpus.end(), topology.CPUsOf(node).begin(), topology.CPUsOf(node).end());
+          }
+        }
+      }
 
-    cli_poll.push_back(tmp);
+      warmups.push_back(new Webroot_Warmup(info, hosts[host].root_path, *caches[host][shard], cpus));
+      warmups.back()->Start();
+    }
   }
+}
 
-  // create "pool" of thread, and start each thread
-  workers = new std::thread[info.number_workers];
+template <class Policies>
+void Basic_HTTP_Server<Policies>::FreeCache(){
+  for (auto it = warmups.begin(); it != warmups.end(); ++it){
+    (*it)->Stop();
+    delete *it;
+  }
+  warmups.clear();
+
+  // hot list is relative to root-path, so only default host records it
+  std::unordered_map<std::string, std::uint32_t> hits;
+  for (std::size_t host = 0; host < caches.size(); ++host){
+    for (auto it = caches[host].begin(); it != caches[host].end(); ++it){
+      if (host == 0) (*it)->CollectHits(info.root_path, hits);
+      delete *it;
+    }
+  }
+  caches.clear();
 
-  for(std::size_t i = 0; i < info.number_workers; ++i){
-    workers[i] = std::thread([this](){this->RequestHandler();});
+  if (!info.warmup_hot_list.empty() && hits.size()){
+    Content_Cache::SaveHotList(info.warmup_hot_list, hits, WARMUP_HOT_PATHS);
   }
 }
 
-HTTP_Server::HTTP_Server(std::string & pathname_config){
-  init(pathname_config.c_str());
-  additional_tools();
+template <class Policies>
+Content_Cache * Basic_HTTP_Server<Policies>::CacheOf(connection & conn){
+  if (conn.host >= caches.size() || caches[conn.host].empty()){
+    return nullptr;
+  }
+  return caches[conn.host][workers[conn.worker].shard];
 }
 
-HTTP_Server::HTTP_Server(const char * pathname_config){
-  init(pathname_config);
-  additional_tools();
+template <class Policies>
+void Basic_HTTP_Server<Policies>::FreeBundle(){
+  delete bundle;
+  bundle = nullptr;
 }
 
-void HTTP_Server::readFile(const char* filename, std::vector<uint8_t> & data){
-  PutServerName(data);
+template <class Policies>
+void Basic_HTTP_Server<Policies>::FreeAutoindex(){
+  delete autoindex;
+  autoindex = nullptr;
+}
+
+// cache entry outlives arena of request, so headers are built in heap
+template <class Policies>
+void Basic_HTTP_Server<Policies>::BuildCachedHeaders(cache_entry & entry){
+  Response_Chain headers(std::pmr::new_delete_resource());
 
-  // open the file:
-  std::string _filename = filename;
-  std::ifstream file(_filename, std::ios::binary);
+  PutLastModified(entry.mtime, headers);
+  PutETag(entry.etag, headers);
+  PutServerName(headers);
+  PutContentLenth(entry.size, headers);
+  PutContentType(entry.path.c_str(), headers);
 
-  // Stop eating new lines in binary mode!!!
-  file.unsetf(std::ios::skipws);
+  headers.Append("\n"); // payload separation from the header
 
-  // get its size:
-  int fileSize;
+  headers.CopyTo(entry.headers);
+}
 
-  file.seekg(0, std::ios::end);
-  fileSize = file.tellg();
+template <class Policies>
+void Basic_HTTP_Server<Policies>::readFile(const char* filename, Response_Chain & data, connection * conn){
+  PutServerName(data);
 
-  file.seekg(0, std::ios::beg);
+  off_t size = 0;
+  int   fd   = -1;
+  Blocking([&]{ fd = Policies::files::Open(filename, size); });
 
-  PutContentLenth(fileSize,  data);
-  PutContentType(_filename, data);
+  PutContentLenth(size, data);
+  PutContentType(filename, data);
 
-  data.push_back('\n'); // payload separation from the header
+  data.Append("\n"); // payload separation from the header
 
-  // read the data:
-  data.insert(data.end(),
-             std::istream_iterator<uint8_t>(file),
-             std::istream_iterator<uint8_t>());
+  // zero-copy: only header goes to respond, body is sent by worker straight from the file
+  bool can_sendfile = conn && conn->can_sendfile;
+  if (fd >= 0 && can_sendfile){
+    Policies::files::Attach(fd, size, data, true);
+  }
+  else if (fd >= 0){
+    Blocking([&]{ Policies::files::Attach(fd, size, data, false); });
+  }
 }
 
 // Get current date/time, example: Date: Tue, 15 Nov 1994 08:12:31 GMT
 // rfc7232
-void HTTP_Server::GetCurrentDateTime(std::string & buffer, tm * _tstruct) {
+template <class Policies>
+void Basic_HTTP_Server<Policies>::GetCurrentDateTime(Response_Chain & dst, tm * _tstruct) {
   time_t     now = time(0);
   tm         tstruct;
   char       local_buf[80];
@@ -170,69 +600,299 @@ void HTTP_Server::GetCurrentDateTime(std::string & buffer, tm * _tstruct) {
   else{
     tstruct = *localtime(&now);
   }
-  strftime(local_buf, sizeof(local_buf), "%a, %d %b %Y %H:%M:%S %Z\n", &tstruct);
+  std::size_t size = strftime(local_buf, sizeof(local_buf), "%a, %d %b %Y %H:%M:%S %Z\n", &tstruct);
 
-  buffer.append(local_buf);
+  dst.Append(local_buf, size);
 }
 
-void HTTP_Server::timespec2str(std::string & buffer, timespec & ts) {
+template <class Policies>
+void Basic_HTTP_Server<Policies>::timespec2str(Response_Chain & dst, timespec & ts) {
   struct tm t;
   tzset();
   if (localtime_r(&(ts.tv_sec), &t) == NULL){
     // for future handler
   }
 
-  GetCurrentDateTime(buffer, & t);
+  GetCurrentDateTime(dst, & t);
+}
+
+template <class Policies>
+void Basic_HTTP_Server<Policies>::PutString(std::string_view str, Response_Chain & dst){
+  dst.Append(str);
+}
+
+// status lines live as long as server, respond refers to them
+template <class Policies>
+void Basic_HTTP_Server<Policies>::PutStatus(uint16_t status, Response_Chain & dst){
+  dst.AddStatic(response_status[status]);
+}
+
+template <class Policies>
+void Basic_HTTP_Server<Policies>::PutErrorPage(uint16_t status, Response_Chain & dst, connection & conn){
+  char page[16];
+  snprintf(page, sizeof(page), "%u.html", static_cast<unsigned>(status));
+
+  if (bundle && !conn.host && PutBundleFile(status, page, dst, false)){
+    return;
+  }
+
+  PutStatus(status, dst);
+  PutDateTime(dst);
+
+  arena_string pathname(hosts[conn.host].root_path, conn.arena);
+  pathname.append(page);
+
+  // error pages are shared from cache like any other file
+  struct stat _stat = {0};
+  int         rc    = -1;
+  Blocking([&]{ rc = stat(pathname.c_str(), &_stat); });
+  if (rc == 0 && PutCachedFile(pathname, _stat, dst, conn)){
+    return;
+  }
+  readFile(pathname.c_str(), dst);
+}
+
+// entry is built in heap as for content cache and copied to shared memory
+template <class Policies>
+bool Basic_HTTP_Server<Policies>::LoadShared(const arena_string & pathname, const struct stat & _stat, shared_cache_hit & hit){
+  cache_entry entry;
+  entry.path     = std::string(pathname);
+  entry.mtime    = _stat.st_mtim;
+  entry.size     = _stat.st_size;
+  entry.has_body = true;
+  Content_Cache::MakeETag(entry.mtime, entry.size, entry.etag);
+
+  if (!Content_Cache::ReadBody(entry.path, entry.size, entry.body)){
+    return false;
+  }
+  BuildCachedHeaders(entry);
+
+  return shared_cache->Insert(pathname, _stat, entry.headers, entry.body, hit);
+}
+
+// headers and body are shared with cache entry, false - file is not in cache
+template <class Policies>
+bool Basic_HTTP_Server<Policies>::PutCachedFile(const arena_string & pathname, const struct stat & _stat, Response_Chain & dst, connection & conn){
+  // hit keeps its half of shared cache from reclaim until respond is sent
+  if (shared_cache && shared_cache->IsCacheable(_stat.st_size)){
+    shared_cache_hit hit;
+    bool found = shared_cache->Lookup(pathname, _stat, hit);
+    if (!found){
+      Blocking([&]{ found = LoadShared(pathname, _stat, hit); });
+    }
+    if (found){
+      dst.AddShared(hit.headers, hit.headers_size, hit.owner);
+      dst.AddShared(hit.body, hit.body_size, std::move(hit.owner));
+      if (slot) ++slot->shared_cache_hits;
+      return true;
+    }
+  }
+
+  Content_Cache * cache = CacheOf(conn);
+  if (!cache){
+    return false;
+  }
+
+  cache_entry_ptr entry = cache->Lookup(pathname, _stat);
+  if (!entry && cache->IsCacheable(_stat.st_size)){
+    Blocking([&]{ entry = cache->Load(std::string(pathname), _stat.st_mtim, _stat.st_size, true); });
+  }
+
+  if (entry && entry->has_body){
+    dst.AddShared(entry->headers.data(), entry->headers.size(), entry);
+    dst.AddShared(entry->body.data(), entry->body.size(), entry);
+    return true;
+  }
+
+  // indexed big file: headers are ready, body goes by sendfile
+  int fd = -1;
+  if (entry && conn.can_sendfile){
+    Blocking([&]{ fd = open(pathname.c_str(), O_RDONLY | O_CLOEXEC); });
+  }
+  if (fd >= 0){
+    dst.AddShared(entry->headers.data(), entry->headers.size(), entry);
+    dst.AddFile(fd, 0, entry->size);
+    return true;
+  }
+  return false;
+}
+
+// listing is shared from index of directories, it is rendered once per page and mtime
+template <class Policies>
+bool Basic_HTTP_Server<Policies>::PutListing(const arena_string & directory, const struct stat & _stat, std::string_view uri,
+                                             std::string_view query, Response_Chain & dst){
+  listing_query request = Directory_Index::ParseQuery(query);
+  listing_page  page;
+  Blocking([&]{ page = autoindex->Page(std::string(directory), _stat.st_mtim, uri, request); });
+  if (!page){
+    return false;
+  }
+
+  timespec mtime = _stat.st_mtim;
+
+  PutStatus(200, dst);
+  PutDateTime(dst);
+  PutServerName(dst);
+  PutLastModified(mtime, dst);
+  PutContentLenth(page->size(), dst);
+  PutString(request.json ? "Content-Type: application/json\n" : "Content-Type: text/html; charset=utf-8\n", dst);
+
+  dst.Append("\n"); // payload separation from the header
+  dst.AddShared(page->data(), page->size(), page);
+  return true;
+}
+
+// directory was requested without trailing slash, query is kept
+template <class Policies>
+void Basic_HTTP_Server<Policies>::PutRedirect(std::string_view target, Response_Chain & dst){
+  std::size_t query = target.find('?');
+
+  PutStatus(301, dst);
+  PutDateTime(dst);
+  PutServerName(dst);
+  PutString("Location: ", dst);
+  PutString(target.substr(0, query), dst);
+  PutString("/", dst);
+  if (query != target.npos){
+    PutString(target.substr(query), dst);
+  }
+  PutString("\n", dst);
+  PutContentLenth(0, dst);
+
+  dst.Append("\n"); // payload separation from the header
+}
+
+// headers are taken from bundle as is, body is sent straight from the mapping
+template <class Policies>
+bool Basic_HTTP_Server<Policies>::PutBundleFile(uint16_t status, std::string_view path, Response_Chain & dst, bool gzip){
+  const bundle_entry * entry = bundle->Find(path.data(), path.size());
+  if (!entry){
+    return false;
+  }
+
+  PutStatus(status, dst);
+  PutDateTime(dst);
+
+  if (entry->gzip_size && gzip){
+    dst.AddStatic(bundle->At(entry->gzip_headers_offset), entry->gzip_headers_size);
+    dst.AddStatic(bundle->At(entry->gzip_offset), entry->gzip_size);
+    return true;
+  }
+
+  dst.AddStatic(bundle->At(entry->headers_offset), entry->headers_size);
+  dst.AddStatic(bundle->At(entry->body_offset), entry->body_size);
+  return true;
+}
+
+// one pass over headers: Host selects virtual host of connection, true - client accepts gzip
+template <class Policies>
+bool Basic_HTTP_Server<Policies>::ReadHeaders(std::istream & request, connection & conn){
+  arena_string line(conn.arena);
+  std::getline(request, line); // rest of request line
+
+  static const char   encoding[]    = "accept-encoding:";
+  static const size_t encoding_size = sizeof(encoding) - 1;
+  static const char   host[]        = "host:";
+  static const size_t host_size     = sizeof(host) - 1;
+
+  bool gzip = false;
+  conn.host = 0;
+
+  while (std::getline(request, line) && line.size() && line != "\r"){
+    if (line.size() > encoding_size && strncasecmp(line.c_str(), encoding, encoding_size) == 0){
+      gzip = line.find("gzip") != line.npos;
+    }
+    else if (line.size() > host_size && strncasecmp(line.c_str(), host, host_size) == 0){
+      std::string_view name(line);
+      name.remove_prefix(std::min(name.find_first_not_of(" \t", host_size), name.size()));
+      name = name.substr(0, name.find_first_of(" \t\r"));
+
+      // port is not a part of name, [IPv6]:port keeps its brackets
+      std::size_t colon = name.rfind(':');
+      if (colon != name.npos && name.find(']', colon) == name.npos){
+        name = name.substr(0, colon);
+      }
+      if (name.size() && name.back() == '.'){
+        name.remove_suffix(1);
+      }
+
+      int index = host_table.Find(name);
+      conn.host = index < 0 ? 0 : index;
+    }
+  }
+  return gzip;
+}
+
+template <class Policies>
+void Basic_HTTP_Server<Policies>::PutDateTime(Response_Chain & dst){
+  PutString("Date: ", dst);
+  GetCurrentDateTime(dst, nullptr);
 }
 
-void HTTP_Server::PutStatus(uint16_t status, std::vector<uint8_t> & dst){
-  std::copy(response_status[status].begin(), response_status[status].end(), std::back_inserter(dst));
+template <class Policies>
+void Basic_HTTP_Server<Policies>::PutContentLenth(int32_t lenth, Response_Chain & dst){
+  char str_cl[48];
+  int  size = snprintf(str_cl, sizeof(str_cl), "Content-Length: %d\n", lenth);
+  dst.Append(str_cl, size);
 }
 
-void HTTP_Server::PutDateTime(std::vector<uint8_t> & dst){
-  std::string cur_datetime = "Date: ";
-  GetCurrentDateTime(cur_datetime, nullptr);
-  std::copy(cur_datetime.begin(), cur_datetime.end(), std::back_inserter(dst));
+template <class Policies>
+void Basic_HTTP_Server<Policies>::PutLastModified(timespec & ts, Response_Chain & dst){
+  PutString("Last-Modified: ", dst);
+  timespec2str(dst, ts);
 }
 
-void HTTP_Server::PutContentLenth(int32_t lenth, std::vector<uint8_t> & dst){
-  std::string str_cl = "Content-Length: " + std::to_string(lenth) + "\n";
-  std::copy(str_cl.begin(), str_cl.end(), std::back_inserter(dst));
+template <class Policies>
+void Basic_HTTP_Server<Policies>::PutETag(const std::string & etag, Response_Chain & dst){
+  PutString("ETag: ", dst);
+  PutString(etag, dst);
+  PutString("\n", dst);
 }
 
-void HTTP_Server::PutLastModified(timespec & ts, std::vector<uint8_t> & dst){
-  std::string cur_datetime = "Last-Modified: ";
-  timespec2str(cur_datetime, ts);
-  std::copy(cur_datetime.begin(), cur_datetime.end(), std::back_inserter(dst));
+template <class Policies>
+void Basic_HTTP_Server<Policies>::PutServerName(Response_Chain & dst){
+  PutString("Server: YP\n", dst);
 }
 
-void HTTP_Server::PutServerName(std::vector<uint8_t> & dst){
-  std::string str = "Server: YP\n";
-  std::copy(str.begin(), str.end(), std::back_inserter(dst));
+template <class Policies>
+void Basic_HTTP_Server<Policies>::PutConnection(Response_Chain & dst){
+  PutString("Connection: close\n", dst);
 }
 
-void HTTP_Server::PutConnection(std::vector<uint8_t> & dst){
-  std::string str = "Connection: close\n";
-  std::copy(str.begin(), str.end(), std::back_inserter(dst));
+// sampled timelines are built in heap: endpoint is rare and its size is not bounded by arena
+template <class Policies>
+void Basic_HTTP_Server<Policies>::PutTrace(Response_Chain & dst){
+  std::string json;
+  tracer->WriteJSON(json);
+
+  PutStatus(200, dst);
+  PutDateTime(dst);
+  PutServerName(dst);
+  PutContentLenth(json.size(), dst);
+  PutString("Content-Type: application/json\n", dst);
+
+  dst.Append("\n"); // payload separation from the header
+  dst.Append(json);
 }
 
-void HTTP_Server::PutContentType(std::string & filename, std::vector<uint8_t> & dst){
-  std::string str_ct      = "Content-Type: ";
+template <class Policies>
+void Basic_HTTP_Server<Policies>::PutContentType(const char * filename, Response_Chain & dst){
+  PutString("Content-Type: ", dst);
 
-  char *      extension   = std::strrchr(const_cast<char*>(filename.c_str()), '.');
+  const char * extension = std::strrchr(filename, '.');
 
   if(extension && *++extension){
-    auto it_type = extension_mime.find(extension);
+    auto it_type = extension_mime.find(std::string_view(extension));
     if (it_type != extension_mime.end()){
-      str_ct += it_type->second;
+      PutString(it_type->second, dst);
     }
   }
 
-  str_ct.push_back('\n');
-  std::copy(str_ct.begin(), str_ct.end(), std::back_inserter(dst));
+  PutString("\n", dst);
 }
 
-std::string HTTP_Server::UriDecode(const std::string & sSrc){
+template <class Policies>
+arena_string Basic_HTTP_Server<Policies>::UriDecode(const arena_string & sSrc){
   // Note from RFC1630: "Sequences which start with a percent
   // sign but are not followed by two hexadecimal characters
   // (0-9, A-F) are reserved for future extension"
@@ -243,7 +903,8 @@ std::string HTTP_Server::UriDecode(const std::string & sSrc){
   // last decodable '%'
   const unsigned char * const SRC_LAST_DEC = SRC_END - 2;
 
-  char * const pStart = new char[SRC_LEN];
+  arena_string sResult(SRC_LEN, '\0', sSrc.get_allocator());
+  char * const pStart = sResult.data();
   char * pEnd = pStart;
 
   while (pSrc < SRC_LAST_DEC){
@@ -264,205 +925,956 @@ std::string HTTP_Server::UriDecode(const std::string & sSrc){
   while (pSrc < SRC_END)
     *pEnd++ = *pSrc++;
 
-  std::string sResult(pStart, pEnd);
-  delete [] pStart;
+  sResult.resize(pEnd - pStart);
   return sResult;
 }
 
-void HTTP_Server::GET_POST_Header_Handler(std::istream & request, std::vector<uint8_t> & respond, bool is_get){
-  std::string protocol;
-  std::string pathname;
+template <class Policies>
+void Basic_HTTP_Server<Policies>::GET_POST_Header_Handler(std::istream & request, Response_Chain & respond, connection & conn, bool is_get){
+  arena_string protocol(conn.arena);
+  arena_string pathname(conn.arena);
 
   request >> pathname;
   request >> protocol;
 
   if (protocol != "HTTP/1.1"){
     std::cerr << "Protocol doesn't support: " << protocol << std::endl;
-    PutStatus(505, respond);
-    PutDateTime(respond);
-    readFile((info.root_path + "505.html").c_str(), respond);
+    PutErrorPage(505, respond, conn);
     return;
   }
 
+  // path as client sent it, for redirect of directory
+  arena_string target(pathname, conn.arena);
   pathname = UriDecode(pathname);
 
+  // in place: substr would allocate result out of arena
+  arena_string query(conn.arena);
   if(is_get){
     const char * get_params = std::strchr(pathname.c_str(), '?');
-    pathname                = pathname.substr(0, get_params ? (get_params - pathname.c_str()) : pathname.npos );
+    if (get_params){
+      query.assign(get_params + 1);
+      pathname.resize(get_params - pathname.c_str());
+    }
   }
 
-  pathname = info.root_path + ((pathname[0] == '/') ? pathname.substr(1, pathname.size() - 1) : pathname);
-
-  struct stat _stat = {0};
-  if (stat(pathname.c_str(), &_stat) < 0){
-    std::string path = "\nError!!! `" + pathname + "` ";
-    std::perror(path.c_str());
-    PutStatus(404, respond);
-    PutDateTime(respond);
-    readFile((info.root_path + "404.html").c_str(), respond);
+  // `..` is resolved before anything is looked up: %2e%2e is already decoded here
+  if (!NormalizePath(pathname)){
+    PutErrorPage(403, respond, conn);
     return;
   }
 
-  if(_stat.st_mode & S_IFDIR){
-    PutStatus(403, respond);
-    PutDateTime(respond);
-    readFile((info.root_path + "403.html").c_str(), respond);
-    return;
+  HTTP_PROBE(parse, conn.fd, pathname.c_str(), conn.received);
+  if (conn.trace){
+    conn.trace->SetPath(pathname);
+    conn.trace->Mark(TRACE_PARSED, conn.received);
   }
 
-  PutStatus(200, respond);
-  PutDateTime(respond);
+  arena_string uri(pathname, conn.arena);
+  if (pathname[0] == '/'){
+    pathname.erase(0, 1);
+  }
 
-  PutLastModified(_stat.st_mtim, respond);
+  bool gzip = ReadHeaders(request, conn);
 
-  readFile(pathname.c_str(), respond);
-}
+  // timelines hold paths of other clients: only local client of default host gets them,
+  // for everybody else the path is an ordinary file
+  if (tracer && !conn.host && std::string_view(uri) == info.trace_endpoint && Socket_Options::IsLoopback(conn.fd)){
+    PutTrace(respond);
+    return;
+  }
 
-void HTTP_Server::GET_Handler(std::istream & request, std::vector<uint8_t> & respond){
-  GET_POST_Header_Handler(request, respond);
-}
+  // directory of bundle is answered by its index file
+  bool is_directory = pathname.empty() || pathname.back() == '/';
+  if (bundle && !conn.host && is_directory && info.index_file.size()){
+    arena_string index(pathname, conn.arena);
+    index.append(info.index_file);
+    if (PutBundleFile(200, index, respond, gzip)){
+      HTTP_PROBE(resolve, conn.fd, index.c_str(), respond.Size());
+      if (conn.trace) conn.trace->Mark(TRACE_RESOLVED, respond.Size());
+      return;
+    }
+  }
 
-void HTTP_Server::POST_Handler(std::istream & request, std::vector<uint8_t> & respond){
-  GET_POST_Header_Handler(request, respond, false);
-}
+  if (bundle && !conn.host && !is_directory && PutBundleFile(200, pathname, respond, gzip)){
+    HTTP_PROBE(resolve, conn.fd, pathname.c_str(), respond.Size());
+    if (conn.trace) conn.trace->Mark(TRACE_RESOLVED, respond.Size());
+    return;
+  }
 
-void HTTP_Server::RequestHandler(){
-  //sigset_t signal_mask;  /* signals to block */
-  //sigemptyset (&signal_mask);
-  //sigaddset (&signal_mask, SIGINT);
-  //sigaddset (&signal_mask, SIGTERM);
-  //int rc = pthread_sigmask (SIG_BLOCK, &signal_mask, NULL);
+  const std::string & root_path = hosts[conn.host].root_path;
+  if (root_path.empty()){
+    PutErrorPage(404, respond, conn);
+    return;
+  }
 
-  //if(!rc){
-  //  return;
-  //  }
-  while(true){
-    int fd = -1;
-    std::unique_lock<std::mutex> lk(mtx);
-    cv.wait(lk, [this]{return this->tasks.size();});
-    fd = tasks.front();
-    tasks.pop();
-    lk.unlock();
-
-    if(fd == -1){
+  pathname.insert(0, root_path);
+
+  // errno is of the thread which called stat
+  struct stat _stat = {0};
+  int         rc    = -1, error = 0;
+  Blocking([&]{ rc = stat(pathname.c_str(), &_stat); error = errno; });
+  if (rc < 0){
+    errno = error;
+    std::string path = "\nError!!! `" + std::string(pathname) + "` ";
+    std::perror(path.c_str());
+    PutErrorPage(404, respond, conn);
+    return;
+  }
+
+  if(S_ISDIR(_stat.st_mode)){
+    // relative links of index page and of listing need trailing slash in URL
+    if (uri.empty() || uri.back() != '/'){
+      PutRedirect(target, respond);
       return;
     }
 
-    std::vector<uint8_t> msg;
+    std::size_t directory_size = pathname.size();
+    if (pathname.back() != '/'){
+      pathname.push_back('/');
+      ++directory_size;
+    }
+
+    struct stat index_stat = {0};
+    if (info.index_file.size()){
+      pathname.append(info.index_file);
+      Blocking([&]{ rc = stat(pathname.c_str(), &index_stat); });
+    }
+
+    if (info.index_file.empty() || rc < 0 || !S_ISREG(index_stat.st_mode)){
+      pathname.resize(directory_size);
+      if (!autoindex || !PutListing(pathname, _stat, uri, query, respond)){
+        PutErrorPage(403, respond, conn);
+      }
+      return;
+    }
+    _stat = index_stat;
+  }
+
+  HTTP_PROBE(resolve, conn.fd, pathname.c_str(), _stat.st_size);
+  if (conn.trace) conn.trace->Mark(TRACE_RESOLVED, _stat.st_size);
+
+  PutStatus(200, respond);
+  PutDateTime(respond);
+
+  if (PutCachedFile(pathname, _stat, respond, conn)){
+    return;
+  }
+
+  std::string etag;
+  Content_Cache::MakeETag(_stat.st_mtim, _stat.st_size, etag);
+
+  PutLastModified(_stat.st_mtim, respond);
+  PutETag(etag, respond);
+
+  readFile(pathname.c_str(), respond, & conn);
+}
+
+template <class Policies>
+void Basic_HTTP_Server<Policies>::GET_Handler(std::istream & request, Response_Chain & respond, connection & conn){
+  GET_POST_Header_Handler(request, respond, conn);
+}
+
+template <class Policies>
+void Basic_HTTP_Server<Policies>::POST_Handler(std::istream & request, Response_Chain & respond, connection & conn){
+  GET_POST_Header_Handler(request, respond, conn, false);
+}
+
+// client sockets are non-blocking from accept, worker waits for them by poll
+template <class Policies>
+bool Basic_HTTP_Server<Policies>::WaitSocket(connection & conn, short events){
+  pollfd pfd = {conn.fd, events, 0};
+  int    rc;
+  do{
+    rc = poll(&pfd, 1, conn.wait_ms);
+  } while (rc < 0 && errno == EINTR);
+  return rc > 0;
+}
+
+// -1 also when client is silent longer than wait_ms
+template <class Policies>
+int Basic_HTTP_Server<Policies>::RecvSome(connection & conn, char * dst, std::size_t size){
+  while (true){
     int rc;
-    do{
-      rc = recv(fd, buff, sizeof(buff) - 2, 0);
-      if (rc <= 0){
-        close(fd);
-        return;
+#ifdef HTTP_SERVER_WITH_TLS
+    if (conn.ssl){
+      rc = SSL_read(conn.ssl, dst, size);
+      if (rc > 0){
+        return rc;
       }
-      else{
-        buff[rc] = '\0';
-        std::copy(buff, buff +rc, std::back_inserter(msg));
-        if ((unsigned) rc < sizeof(buff) - 2){
-          break;
+      int error = SSL_get_error(conn.ssl, rc);
+      if ((error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE) &&
+          WaitSocket(conn, error == SSL_ERROR_WANT_READ ? POLLIN : POLLOUT)){
+        continue;
+      }
+      return rc < 0 ? rc : -1;
+    }
+#endif
+    rc = recv(conn.fd, dst, size, 0);
+    if (rc >= 0){
+      return rc;
+    }
+    if (errno == EINTR || ((errno == EAGAIN || errno == EWOULDBLOCK) && WaitSocket(conn, POLLIN))){
+      continue;
+    }
+    return -1;
+  }
+}
+
+template <class Policies>
+bool Basic_HTTP_Server<Policies>::SendAll(connection & conn, const uint8_t * src, std::size_t size){
+  while (size){
+    int rc;
+#ifdef HTTP_SERVER_WITH_TLS
+    if (conn.ssl){
+      rc = SSL_write(conn.ssl, src, size);
+      if (rc <= 0){
+        int error = SSL_get_error(conn.ssl, rc);
+        if ((error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE) &&
+            WaitSocket(conn, error == SSL_ERROR_WANT_READ ? POLLIN : POLLOUT)){
+          continue;
         }
+        return false;
+      }
+    }
+    else
+#endif
+    {
+      rc = send(conn.fd, src, size, MSG_NOSIGNAL);
+      if (rc < 0){
+        if (errno == EINTR || ((errno == EAGAIN || errno == EWOULDBLOCK) && WaitSocket(conn, POLLOUT))) continue;
+        return false;
       }
-    } while(true);
+    }
+    src  += rc;
+    size -= rc;
+  }
+  return true;
+}
+
+template <class Policies>
+bool Basic_HTTP_Server<Policies>::IsReadable(connection & conn){
+#ifdef HTTP_SERVER_WITH_TLS
+  if (conn.ssl && SSL_pending(conn.ssl)){
+    return true;
+  }
+#endif
+  return Policies::events::Readable(conn.fd);
+}
+
+template <class Policies>
+void Basic_HTTP_Server<Policies>::CloseConnection(connection & conn){
+#ifdef HTTP_SERVER_WITH_TLS
+  if (conn.ssl){
+    SSL_shutdown(conn.ssl);
+    SSL_free(conn.ssl);
+    conn.ssl = nullptr;
+  }
+#endif
+  conn.pending.reset();
+  close(conn.fd);
+}
 
-    membuf sbuf(reinterpret_cast<char*>(msg.data()), reinterpret_cast<char*>(msg.data() + msg.size()));
-    std::istream in(&sbuf);
+template <class Policies>
+void Basic_HTTP_Server<Policies>::BuildResponse(std::istream & in, Response_Chain & respond, connection & conn){
+  arena_string method(conn.arena);
+  in >> method;
 
-    std::string method;
-    in >> method;
+  conn.host = 0; // until Host header is read
 
-    std::vector<uint8_t> respond;
-    std::string str = "HTTP/1.1 ";
-    std::copy(str.begin(), str.end(), std::back_inserter(respond));
+  PutString("HTTP/1.1 ", respond);
 
-    auto it_request = requests.find(method);
-    if(it_request == requests.end()){
-      std::cerr << "Error!!! Unknown method!\n";
-      PutStatus(400, respond);
-      PutDateTime(respond);
-      readFile((info.root_path + "400.html").c_str(), respond);
+  auto it_request = requests.find(std::string_view(method));
+  if(it_request == requests.end()){
+    std::cerr << "Error!!! Unknown method!\n";
+    PutErrorPage(400, respond, conn);
+  }
+  else{
+    MFP function = it_request->second;
+    if (function){
+      (this->*function)(in, respond, conn);
     }
     else{
-      MFP function = it_request->second;
-      if (function){
-        (this->*function)(in, respond);
+      std::cerr << "\nError!!! Defined method: " << method << ", but not defined him handler!\n";
+      PutErrorPage(405, respond, conn);
+    }
+  }
+}
+
+template <class Policies>
+void Basic_HTTP_Server<Policies>::ServeHTTP2(connection & conn, byte_buffer & received){
+  // worker owns connection while it is alive, idle client must not hold worker forever
+  // timeout of host is applied once its first stream is served
+  std::uint32_t idle_timeout = info.http2_idle_timeout;
+  conn.wait_ms = idle_timeout ? idle_timeout * 1000 : -1;
+
+  conn.can_sendfile = false; // body is framed into DATA frames
+
+  HTTP2_Transport transport;
+  transport.recv     = [this, &conn](uint8_t * dst, std::size_t size){ return RecvSome(conn, reinterpret_cast<char *>(dst), size); };
+  transport.send     = [this, &conn](const uint8_t * src, std::size_t size){ return SendAll(conn, src, size); };
+  transport.readable = [this, &conn](){ return IsReadable(conn); };
+
+  HTTP2_Handler handler = [this, &conn, &idle_timeout](const header_list & request, HTTP2_Respond & respond){
+    {
+      arena_string method(conn.arena), path(conn.arena), authority(conn.arena), accept_encoding(conn.arena);
+      for (auto it = request.begin(); it != request.end(); ++it){
+        if (it->first == ":method") method = it->second;
+        else if (it->first == ":path") path = it->second;
+        else if (it->first == ":authority" || (it->first == "host" && authority.empty())) authority = it->second;
+        else if (it->first == "accept-encoding") accept_encoding = it->second;
+      }
+
+      // the same pipeline as HTTP/1.1 request
+      arena_string line(conn.arena);
+      line.append(method).append(" ").append(path).append(" HTTP/1.1\n");
+      if (authority.size()){
+        line.append("Host: ").append(authority).append("\n");
+      }
+      if (accept_encoding.size()){
+        line.append("Accept-Encoding: ").append(accept_encoding).append("\n");
+      }
+      membuf      sbuf(line.data(), line.data() + line.size());
+      std::istream in(&sbuf);
+
+      Response_Chain out(conn.arena);
+      BuildResponse(in, out, conn);
+
+      if (hosts[conn.host].http2_idle_timeout != idle_timeout){
+        idle_timeout = hosts[conn.host].http2_idle_timeout;
+        conn.wait_ms = idle_timeout ? idle_timeout * 1000 : -1;
+      }
+
+      // status line and headers are in memory, file segments start after them
+      respond.head.resize(MAX_BUFFER_SIZE);
+      respond.head.resize(out.Peek(respond.head.data(), respond.head.size()));
+
+      const char * begin = reinterpret_cast<const char *>(respond.head.data());
+      const char * end   = begin + respond.head.size();
+      const char * blank = std::search(begin, end, "\n\n", "\n\n" + 2);
+      std::size_t  head_size;
+      if (blank != end){
+        head_size = blank - begin + 2;
       }
       else{
-        std::cerr << "\nError!!! Defined method: " << method << ", but not defined him handler!\n";
-        PutStatus(405, respond);
-        PutDateTime(respond);
-        readFile((info.root_path + "405.html").c_str(), respond);
+        blank     = std::search(begin, end, "\n\r\n", "\n\r\n" + 3);
+        head_size = blank != end ? blank - begin + 3 : respond.head.size();
+      }
+      respond.head.resize(head_size);
+      out.Skip(head_size);
+
+      // stream keeps body until it is sent, so the chain is moved out of arena, files are read by DATA frames
+      respond.body_size = out.Size();
+      if (respond.body_size){
+        std::shared_ptr<Response_Chain> body = std::make_shared<Response_Chain>(out, std::pmr::new_delete_resource());
+        respond.read_body = [body](uint8_t * dst, std::size_t size){ return body->Read(dst, size); };
       }
     }
 
-    rc = send(fd, respond.data(), respond.size(), 0);
-    close(fd);
+    // session has copied received bytes, so every stream may drop memory of the previous one
+    workers[conn.worker].arena->Reset();
+  };
+
+  HTTP2_Session session(transport, handler, info.http2_max_streams);
+
+  // pool worker is held by connection until it is closed, the rest of workers stay for HTTP/1.1
+  // (worker process serves its connections one by one, there is nothing to cap)
+  bool          is_pooled = !slot;
+  std::uint32_t cap       = info.http2_max_connections ? info.http2_max_connections : std::max<std::uint32_t>(1, number_workers / 2);
+  if (is_pooled && ++http2_connections > cap){
+    --http2_connections;
+    session.Refuse(received.data(), received.size());
+    return;
+  }
+
+  session.Serve(received.data(), received.size());
+
+  if (is_pooled){
+    --http2_connections;
   }
 }
 
-void HTTP_Server::join_all_workers(){
-  for(std::size_t i = 0; i < info.number_workers; ++i){
-    if(workers[i].joinable()){
-      workers[i].join();
+template <class Policies>
+void Basic_HTTP_Server<Policies>::RequestHandler(std::size_t index){
+  worker_ctx & self  = workers[index];
+  task_queue & queue = queues[self.queue];
+
+  // pinned before the first allocation: buffer is placed on the node of worker
+  NUMA_Topology::PinThread(pthread_self(), self.cpus);
+  PrepareWorker(self);
+
+  //sigset_t signal_mask;  /* signals to block */
+  //sigemptyset (&signal_mask);
+  //sigaddset (&signal_mask, SIGINT);
+  //sigaddset (&signal_mask, SIGTERM);
+  //int rc = pthread_sigmask (SIG_BLOCK, &signal_mask, NULL);
+
+  //if(!rc){
+  //  return;
+  //  }
+  while(true){
+    connection conn = queue.Pop();
+
+    if(conn.fd == -1){
+      return;
+    }
+
+    // governor shrinks pool: memory of worker is dropped with it
+    if(conn.fd == -2){
+      self.arena.reset();
+      std::vector<char>().swap(self.buff);
+      self.running = false;
+      return;
+    }
+
+    std::uint64_t start = governor ? Pool_Governor::Now() : 0;
+    if (conn.queued_ns && start > conn.queued_ns){
+      queue_wait_ns += start - conn.queued_ns;
+      ++dequeued;
+    }
+
+    self.busy_since = start;
+    ServeConnection(index, conn);
+    if (start){
+      self.busy_since = 0;
+      self.busy_ns   += Pool_Governor::Now() - start;
     }
   }
 }
 
-void HTTP_Server::clear_tasks(){
-  std::unique_lock<std::mutex> lk(mtx);
-  std::queue<int> empty;
-  std::swap(tasks, empty);
+template <class Policies>
+void Basic_HTTP_Server<Policies>::ServeConnection(std::size_t index, connection conn){
+  worker_ctx &      self  = workers[index];
+  allocator &       arena = *self.arena;
+  std::vector<char> & buff = self.buff;
+
+  // socket became writable for respond which was not sent at once
+  if (conn.pending){
+    FinishResponse(conn, *conn.pending);
+    return;
+  }
+  auto start  = std::chrono::steady_clock::now();
+  conn.worker = index;
+  conn.arena  = &arena;
+
+  HTTP_PROBE(dequeue, conn.fd, index);
+  if (conn.trace){
+    conn.trace->worker = index;
+    conn.trace->Mark(TRACE_DEQUEUE);
+  }
+
+  // memory of previous request is dropped at once
+  arena.Reset();
+#ifdef HTTP_SERVER_ALLOC_STATS
+  std::uint64_t heap_allocations = Request_Arena::HeapAllocations();
+  std::uint64_t arena_overflows  = arena.Overflows();
+#endif
+
+#ifdef HTTP_SERVER_WITH_TLS
+  conn.can_sendfile = conn.ssl ? TLS_Context::IsKernelSend(conn.ssl) : true;
+#else
+  conn.can_sendfile = true;
+#endif
+
+  byte_buffer   msg(&arena);
+  std::uint64_t received_ns = 0;
+  int rc;
+  do{
+    rc = RecvSome(conn, buff.data(), buff.size() - 2);
+    if (rc <= 0){
+      CloseConnection(conn);
+      break;
+    }
+    else{
+      buff[rc] = '\0';
+      msg.insert(msg.end(), buff.data(), buff.data() + rc);
+      if ((unsigned) rc < buff.size() - 2){
+        break;
+      }
+    }
+  } while(true);
+
+  if (rc <= 0){
+    return;
+  }
+  conn.received = msg.size();
+  if (capture){
+    received_ns = Traffic_Capture::Now();
+  }
+
+  bool is_http2 = info.http2 && msg.size() >= HTTP2_Session::PREFACE_SIZE &&
+                  std::equal(msg.begin(), msg.begin() + HTTP2_Session::PREFACE_SIZE, HTTP2_Session::PREFACE);
+#ifdef HTTP_SERVER_WITH_TLS
+  is_http2 |= conn.ssl && TLS_Context::IsHTTP2(conn.ssl);
+#endif
+  if (slot){
+    ++slot->requests;
+    slot->http2_connections += is_http2;
+  }
+
+  // timeline is kept for HTTP/1.1 requests, probes fire for every stream
+  if (is_http2){
+    conn.trace.reset();
+    ServeHTTP2(conn, msg);
+    CloseConnection(conn);
+    RecordRequest(self, conn, start);
+    return;
+  }
+
+  membuf sbuf(reinterpret_cast<char*>(msg.data()), reinterpret_cast<char*>(msg.data() + msg.size()));
+  std::istream in(&sbuf);
+
+  Response_Chain respond(&arena, info.zerocopy_threshold);
+  respond.Coalesce(info.tcp_cork);
+  BuildResponse(in, respond, conn);
+
+  HTTP_PROBE(build, conn.fd, respond.Size());
+  if (conn.trace) conn.trace->Mark(TRACE_BUILT, respond.Size());
+
+  if (capture){
+    CaptureRequest(conn, received_ns, msg, respond);
+  }
+
+  FinishResponse(conn, respond);
+  RecordRequest(self, conn, start);
+
+#ifdef HTTP_SERVER_ALLOC_STATS
+  heap_allocations = Request_Arena::HeapAllocations() - heap_allocations;
+  ++self.requests;
+  self.heap_allocations += heap_allocations;
+  self.zero_allocation_requests += heap_allocations == 0;
+  self.arena_overflows += arena.Overflows() - arena_overflows;
+#endif
+}
+
+// status is read back from the beginning of respond: "HTTP/1.1 200 OK"
+template <class Policies>
+void Basic_HTTP_Server<Policies>::CaptureRequest(connection & conn, std::uint64_t time_ns, const byte_buffer & msg, const Response_Chain & respond){
+  char        head[16] = {0};
+  std::size_t size     = respond.Peek(head, sizeof(head) - 1);
+  std::uint16_t status = size > 9 ? std::strtoul(head + 9, nullptr, 10) : 0;
+
+  capture->Append(time_ns, msg.data(), msg.size(), status, respond.Size(), conn.ssl ? CAPTURE_TLS : 0);
+}
+
+// respond goes from non-blocking socket, the rest waits for event loop
+template <class Policies>
+void Basic_HTTP_Server<Policies>::FinishResponse(connection & conn, Response_Chain & respond){
+  Response_Chain::flush_result result = respond.Flush(conn.fd, conn.ssl);
+  if (result == Response_Chain::FLUSH_AGAIN){
+    ParkConnection(conn, respond);
+    return;
+  }
+
+  bool failed = result == Response_Chain::FLUSH_ERROR;
+  if (failed && slot){
+    ++slot->send_errors;
+  }
+
+  HTTP_PROBE(send, conn.fd, respond.Sent(), failed);
+  if (conn.trace){
+    conn.trace->failed = failed;
+    conn.trace->Mark(TRACE_SENT, respond.Sent());
+    tracer->Commit(*conn.trace);
+  }
+  CloseConnection(conn);
+}
+
+template <class Policies>
+void Basic_HTTP_Server<Policies>::ParkConnection(connection & conn, Response_Chain & respond){
+  // arena is reset by the next request, so the rest of respond is moved to heap
+  if (!conn.pending){
+    conn.pending = std::make_shared<Response_Chain>(respond, std::pmr::new_delete_resource());
+  }
+
+  std::unique_lock<std::mutex> lk(parked_mtx);
+  parked.push_back(conn);
   lk.unlock();
+
+  std::uint64_t one = 1;
+  if (write(wake_fd, &one, sizeof(one)) < 0){
+    // counter is already non-zero, event loop is woken up anyway
+  }
+}
+
+// parked connections are polled until socket is writable (or zero-copy completion arrives)
+template <class Policies>
+void Basic_HTTP_Server<Policies>::TakeParked(){
+  std::uint64_t value;
+  if (read(wake_fd, &value, sizeof(value)) < 0){
+    // spurious wake up
+  }
+
+  std::unique_lock<std::mutex> lk(parked_mtx);
+  std::vector<connection> taken;
+  taken.swap(parked);
+  lk.unlock();
+
+  for (auto it = taken.begin(); it != taken.end(); ++it){
+    poller.Add(it->fd, it->pending->WaitsCompletion() ? 0 : POLLOUT);
+    writers[it->fd] = *it;
+  }
+}
+
+template <class Policies>
+void Basic_HTTP_Server<Policies>::DropWriters(){
+  std::unique_lock<std::mutex> lk(parked_mtx);
+  for (auto it = parked.begin(); it != parked.end(); ++it){
+    CloseConnection(*it);
+  }
+  parked.clear();
+  lk.unlock();
+
+  for (auto it = writers.begin(); it != writers.end(); ++it){
+    poller.Remove(it->first);
+    CloseConnection(it->second);
+  }
+  writers.clear();
+}
+
+template <class Policies>
+void Basic_HTTP_Server<Policies>::RecordRequest(worker_ctx & self, connection & conn, std::chrono::steady_clock::time_point start){
+  if (!info.numa_report || conn.incoming_node < 0){
+    return;
+  }
+
+  std::uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+  if (static_cast<std::size_t>(conn.incoming_node) == self.node){
+    ++self.local_requests;
+    self.local_ns += ns;
+  }
+  else{
+    ++self.remote_requests;
+    self.remote_ns += ns;
+  }
+}
+
+template <class Policies>
+connection Basic_HTTP_Server<Policies>::MakeConnection(int fd, ssl_st * ssl){
+  connection conn = {fd, ssl, false, -1, 0};
+
+  auto it_sampled = sampled.find(fd);
+  if (it_sampled != sampled.end()){
+    conn.trace = it_sampled->second;
+    sampled.erase(it_sampled);
+  }
+
+  if (info.incoming_cpu || info.numa_report){
+    int cpu = NUMA_Topology::IncomingCPU(fd);
+    if (cpu >= 0){
+      conn.incoming_node = topology.NodeOf(cpu);
+    }
+  }
+  return conn;
+}
+
+template <class Policies>
+void Basic_HTTP_Server<Policies>::Dispatch(const connection & conn){
+  // worker process has no threads: connection is served by event loop itself
+  if (slot){
+    ServeConnection(0, conn);
+    return;
+  }
+
+  std::size_t q = 0;
+  if (queues.size() > 1 && conn.incoming_node >= 0){
+    q = node_index[conn.incoming_node];
+  }
+
+  connection task = conn;
+  task.queued_ns  = governor ? Pool_Governor::Now() : 0;
+  queues[q].Push(task);
+}
+
+template <class Policies>
+void Basic_HTTP_Server<Policies>::ReportNUMA(){
+  std::uint64_t total_local = 0, total_remote = 0, total_local_ns = 0, total_remote_ns = 0;
+
+  std::cout << "\n\033[1;37mNUMA report (" << topology.Nodes() << " nodes):\033[0m\n"
+            << "worker\tcpu\tnode\tlocal\tremote\tlocal avg us\tremote avg us\n";
+
+  for (std::size_t i = 0; i < number_workers; ++i){
+    worker_ctx &  w  = workers[i];
+    std::uint64_t l  = w.local_requests, r = w.remote_requests;
+
+    std::cout << i << '\t' << (w.cpus.size() ? std::to_string(w.cpus[0]) : "-") << '\t' << w.node << '\t'
+              << l << '\t' << r << '\t' << (l ? w.local_ns / l / 1000.0 : 0) << "\t\t" << (r ? w.remote_ns / r / 1000.0 : 0) << '\n';
+
+    total_local     += l;
+    total_remote    += r;
+    total_local_ns  += w.local_ns;
+    total_remote_ns += w.remote_ns;
+  }
+
+  std::uint64_t total = total_local + total_remote;
+  std::cout << "cross-node requests: " << total_remote << " of " << total
+            << " (" << (total ? 100.0 * total_remote / total : 0) << "%), avg us local/remote: "
+            << (total_local ? total_local_ns / total_local / 1000.0 : 0) << " / "
+            << (total_remote ? total_remote_ns / total_remote / 1000.0 : 0) << std::endl;
+}
+
+template <class Policies>
+void Basic_HTTP_Server<Policies>::join_all_workers(){
+  for(std::size_t i = 0; i < number_workers; ++i){
+    if(workers[i].thread.joinable()){
+      workers[i].thread.join();
+    }
+  }
+}
+
+template <class Policies>
+void Basic_HTTP_Server<Policies>::clear_tasks(){
+  for (auto it = queues.begin(); it != queues.end(); ++it){
+    it->Drain([this](connection & conn){ if (conn.fd >= 0) CloseConnection(conn); });
+  }
+}
+
+template <class Policies>
+void Basic_HTTP_Server<Policies>::FreeTLS(){
+#ifdef HTTP_SERVER_WITH_TLS
+  for (auto it = tls_handshakes.begin(); it != tls_handshakes.end(); ++it){
+    SSL_free(it->second);
+  }
+  for (auto it = tls_clients.begin(); it != tls_clients.end(); ++it){
+    SSL_free(it->second);
+  }
+  delete tls;
+#endif
+  tls_handshakes.clear();
+  tls_clients.clear();
+  tls = nullptr;
 }
 
-void HTTP_Server::RequestKillWorkers(){
+template <class Policies>
+void Basic_HTTP_Server<Policies>::RequestKillWorkers(){
 
   if(!workers) return;
 
-  for(std::size_t i = 0; i < info.number_workers; ++i){
-    std::unique_lock<std::mutex> lk(mtx);
-    tasks.push(-1);
-    lk.unlock();
-    cv.notify_one();
-   }
+  // pool is not resized while workers are stopped
+  StopGovernor();
+
+  for(std::size_t i = 0; i < number_workers; ++i){
+    if (workers[i].running){
+      queues[workers[i].queue].Push(connection{-1, nullptr, false, -1, 0});
+    }
+  }
 
   join_all_workers();
 }
 
-void HTTP_Server::SIGUSR1_Handler(int signum){
-  server->RequestKillWorkers();
-  delete [] server->workers;
+template <class Policies>
+void Basic_HTTP_Server<Policies>::SIGUSR1_Handler(int signum){
+  // master of worker processes reloads in its waitpid loop
+  if (instance->prefork){
+    instance->reload_requested = 1;
+    return;
+  }
+
+  instance->RequestKillWorkers();
+  instance->FreePool();
+  delete [] instance->workers;
+  instance->DropWriters();
+  instance->poller.Close();
+
+  instance->clear_tasks();
+  instance->FreeTLS();
+  instance->FreeCache();
+  instance->FreeBundle();
+  instance->FreeAutoindex();
+  instance->FreeTracer();
+  instance->FreeCapture();
+
+  instance->init(instance->info.config_path.c_str());
+  instance->StartWarmup();
+
+  std::cout << "\033[1;37mStart listening at: \033[0m\033[1;33m" << instance->info.ip
+            << ":" << instance->info.port << "\033[0m\n";
+  if (instance->tls){
+    std::cout << "\033[1;37mStart TLS listening at: \033[0m\033[1;33m" << instance->info.ip
+              << ":" << instance->info.tls_port << "\033[0m\n";
+  }
+}
+
+template <class Policies>
+void Basic_HTTP_Server<Policies>::AcceptClients(int listen_fd){
+  // the rest of a burst waits for the next round of poll, so clients already accepted are not starved
+  for (std::uint32_t accepted = 0; accepted < info.accept_batch; ++accepted){
+    // non-blocking for good: handshake is driven by poll, respond is flushed without fcntl
+    int new_sd = Socket_Options::Accept(listen_fd);
+    if (new_sd < 0){
+      if (errno != EWOULDBLOCK && errno != EAGAIN){
+        Policies::logger::Error("Function accept failed!", strerror(errno));
+      }
+      break;
+    }
+
+#ifdef HTTP_SERVER_WITH_TLS
+    if (listen_fd == tls_socket_fd){
+      SSL * ssl = tls->NewSession(new_sd);
+      if (!ssl){
+        close(new_sd);
+        continue;
+      }
+      tls_handshakes[new_sd] = ssl;
+    }
+#endif
+
+    HTTP_PROBE(accept, new_sd, listen_fd == tls_socket_fd);
+    if (tracer){
+      std::shared_ptr<request_trace> trace = tracer->Start(new_sd);
+      if (trace) sampled[new_sd] = trace;
+    }
+
+    poller.Add(new_sd, POLLIN);
+  }
+}
+
+// returns true if client still must be polled
+template <class Policies>
+bool Basic_HTTP_Server<Policies>::ContinueHandshake(int fd){
+#ifdef HTTP_SERVER_WITH_TLS
+  auto  it_ssl = tls_handshakes.find(fd);
+  SSL * ssl    = it_ssl->second;
+  short events = POLLIN;
+
+  int rc = tls->Handshake(ssl, events);
+  if (rc < 0){
+    DropClient(fd);
+    return false;
+  }
+
+  if (rc == 0){
+    poller.Modify(fd, events);
+    return true;
+  }
+
+  tls_handshakes.erase(it_ssl);
+
+  if (SSL_has_pending(ssl)){
+    // request came along with the end of handshake and is already read from socket
+    poller.Remove(fd);
+    Dispatch(MakeConnection(fd, ssl));
+    return false;
+  }
+
+  tls_clients[fd] = ssl;
+  poller.Modify(fd, POLLIN);
+#endif
+  return true;
+}
+
+template <class Policies>
+void Basic_HTTP_Server<Policies>::DropClient(int fd){
+#ifdef HTTP_SERVER_WITH_TLS
+  auto it_ssl = tls_handshakes.find(fd);
+  if (it_ssl != tls_handshakes.end()){
+    SSL_free(it_ssl->second);
+    tls_handshakes.erase(it_ssl);
+  }
+  it_ssl = tls_clients.find(fd);
+  if (it_ssl != tls_clients.end()){
+    SSL_free(it_ssl->second);
+    tls_clients.erase(it_ssl);
+  }
+#endif
+
+  sampled.erase(fd);
+  poller.Remove(fd);
+  close(fd);
+}
 
-  for (auto it_poll = server->cli_poll.begin(); it_poll != server->cli_poll.end(); ++it_poll){
-   if(it_poll->fd != -1) close(it_poll->fd);
+#ifdef HTTP_SERVER_ALLOC_STATS
+// HTTP/1.1 requests only, HTTP/2 connection is counted by its own streams
+template <class Policies>
+void Basic_HTTP_Server<Policies>::ReportAllocations(){
+  std::uint64_t requests = 0, heap_allocations = 0, zero_allocation_requests = 0, arena_overflows = 0;
+
+  for (std::size_t i = 0; i < number_workers; ++i){
+    requests                 += workers[i].requests;
+    heap_allocations         += workers[i].heap_allocations;
+    zero_allocation_requests += workers[i].zero_allocation_requests;
+    arena_overflows          += workers[i].arena_overflows;
   }
 
-  server->clear_tasks();
-  server->cli_poll.clear();
+  std::cout << "\n\033[1;37mAllocations report:\033[0m\n"
+            << "requests: " << requests << ", heap allocations per request: " << (requests ? double(heap_allocations) / requests : 0)
+            << ", requests without heap allocations: " << zero_allocation_requests
+            << ", arena overflows: " << arena_overflows << std::endl;
+}
+#endif
 
-  server->init(server->info.config_path.c_str());
+template <class Policies>
+void Basic_HTTP_Server<Policies>::SIGUSR2_Handler(int signum){
+  if (instance->prefork && !instance->slot){
+    instance->report_requested = 1;
+    return;
+  }
+  if (!instance->slot){
+    instance->ReportPool();
+  }
+  if (instance->info.numa_report){
+    instance->ReportNUMA();
+  }
+#ifdef HTTP_SERVER_ALLOC_STATS
+  instance->ReportAllocations();
+#endif
+}
 
-  std::cout << "\033[1;37mStart listening at: \033[0m\033[1;33m" << server->info.ip
-            << ":" << server->info.port << "\033[0m\n";
+// server (or worker process stopped by master) leaves event loop; any thread
+// may take the signal, so event loop is woken up through eventfd. The second
+// signal is not caught and ends the process at once.
+template <class Policies>
+void Basic_HTTP_Server<Policies>::SIGTERM_Handler(int signum){
+  instance->stop_requested = 1;
+  signal(signum, SIG_DFL);
+
+  std::uint64_t one = 1;
+  if (instance->wake_fd >= 0 && write(instance->wake_fd, &one, sizeof(one)) < 0){
+    // counter is already non-zero, event loop is woken up anyway
+  }
 }
 
-void HTTP_Server::Run(){
+template <class Policies>
+void Basic_HTTP_Server<Policies>::Run(){
   std::cout << "\033[1;37mStart listening at: \033[0m\033[1;33m" << info.ip << ":" << info.port << "\033[0m\n";
+  if (tls){
+    std::cout << "\033[1;37mStart TLS listening at: \033[0m\033[1;33m" << info.ip << ":" << info.tls_port << "\033[0m\n";
+  }
 
+  RunEventLoop();
+}
+
+template <class Policies>
+void Basic_HTTP_Server<Policies>::RunEventLoop(){
   int rc;
   bool end_server     = false;
   do{
-    rc = poll(& cli_poll[0], cli_poll.size(), MAX_TIMEOUT_POLL);
+    // master of worker processes, also when reload has switched threaded server to them
+    if (prefork && !slot){
+      RunMaster();
+    }
+    if (stop_requested){
+      break;
+    }
+
+    // with capture the loop wakes up at least once per CAPTURE_FLUSH_NS, so tail of idle server is written
+    rc = poller.Wait(capture ? static_cast<int>(CAPTURE_FLUSH_NS / 1000000) : MAX_TIMEOUT_POLL);
 
     if (rc < 0){
+      if (stop_requested)
+        break;
       if(errno == EINTR)
         continue;
-      std::cerr << "\n\033[1;31mError!!! Function poll failed! \033[0m\033[1;35m" << strerror(errno) << "\033[0m\n";
+      Policies::logger::Error("Function poll failed!", strerror(errno));
       close(socket_fd);
       RequestKillWorkers();
       exit(EXIT_FAILURE);
     }
 
+    if (rc == 0 && capture){
+      capture->Flush();
+      continue;
+    }
+
     if (rc == 0){
       std::cerr << "\n\033[1;35mpoll() timed out. End program.\033[0m\n\n";
       close(socket_fd);
@@ -470,72 +1882,282 @@ void HTTP_Server::Run(){
       exit(EXIT_FAILURE);
     }
 
-    bool was_new_connect = false;
-
-    for (std::size_t i = 0; i < cli_poll.size(); ++i){
+    // descriptor leaves the set before it is handed to worker
+    poller.Ready([&](int fd, short revents){
+      if (fd == wake_fd){
+        TakeParked();
+        return true;
+      }
 
-      if(cli_poll[i].revents == 0 || cli_poll[i].revents == POLLNVAL)
-        continue;
+      // errors of parked connection (and zero-copy completions) are handled by worker
+      auto it_writer = writers.find(fd);
+      if (it_writer != writers.end()){
+        poller.Remove(fd);
+        Dispatch(it_writer->second);
+        writers.erase(it_writer);
+        return true;
+      }
 
-      if(cli_poll[i].revents & (POLLERR|POLLHUP)){
-        std::cerr << "\n\033[1;35mWarning!!! Field revents not equal POLLIN! revents = " << cli_poll[i].revents <<" "<< strerror(errno) <<" \033[0m\n\n";
-        close(cli_poll[i].fd);
-        cli_poll.erase(cli_poll.begin() + i);
-        i -= 2;
-        continue;
+      if(revents & (POLLERR|POLLHUP)){
+        if (fd == socket_fd || fd == tls_socket_fd){
+          Policies::logger::Error(("Listening socket failed! revents = " + std::to_string(revents)).c_str());
+          end_server = true;
+          return false;
+        }
+        Policies::logger::Warning(("Field revents not equal POLLIN! revents = " + std::to_string(revents) + " " + strerror(errno)).c_str());
+        DropClient(fd);
+        return true;
       }
 
-      if(cli_poll[i].revents != POLLIN)
-        continue;
+      if(!(revents & (POLLIN | POLLOUT)))
+        return true;
 
-      if (cli_poll[i].fd == socket_fd){
-        int new_sd = -1;
-        do{
-          sockaddr_in client_addr;
-          socklen_t     len = sizeof(client_addr);
-
-          new_sd = accept(socket_fd, (sockaddr * )& client_addr, &len);
-          if (new_sd < 0){
-            if (errno != EWOULDBLOCK){
-              std::cerr << "\n\033[1;31mError!!! Function accept failed! \033[0m\033[1;35m" << strerror(errno) << "\033[0m\n\n";
-              end_server = true;
-            }
-            break;
-          }
-          {
-            pollfd tmp;
-            tmp.fd          = new_sd;
-            tmp.events      = POLLIN;
-            was_new_connect = true;
-            cli_poll.push_back(tmp);
-          }
-        } while (new_sd != -1);
+      if (fd == socket_fd || fd == tls_socket_fd){
+        AcceptClients(fd);
+      }
+      else if (tls_handshakes.count(fd)){
+        ContinueHandshake(fd);
       }
       else{
-        std::unique_lock<std::mutex> lk(mtx);
-        tasks.push(cli_poll[i].fd);
-        cli_poll.erase(cli_poll.begin() + i);
-        lk.unlock();
-        cv.notify_one();
+        ssl_st * ssl    = nullptr;
+        auto     it_ssl = tls_clients.find(fd);
+        if (it_ssl != tls_clients.end()){
+          ssl = it_ssl->second;
+          tls_clients.erase(it_ssl);
+        }
+
+        poller.Remove(fd);
+        Dispatch(MakeConnection(fd, ssl));
       }
+      return true;
+    });
+  } while (!end_server && !stop_requested);
+}
 
-      if(was_new_connect){
-        break;
+// master only keeps worker processes alive: every worker process has its own
+// event loop over inherited listeners, kernel spreads connections between them
+template <class Policies>
+void Basic_HTTP_Server<Policies>::RunMaster(){
+  // waitpid must be interrupted by reload and report requests
+  struct sigaction action;
+  std::memset(&action, 0, sizeof(action));
+  sigemptyset(&action.sa_mask);
+  action.sa_handler = SIGUSR1_Handler;
+  sigaction(SIGUSR1, &action, nullptr);
+  action.sa_handler = SIGUSR2_Handler;
+  sigaction(SIGUSR2, &action, nullptr);
+  action.sa_handler = SIGTERM_Handler;
+  sigaction(SIGTERM, &action, nullptr);
+  sigaction(SIGINT, &action, nullptr);
+
+  children.assign(prefork->Count(), -1);
+  started.assign(prefork->Count(), std::chrono::steady_clock::now());
+  for (std::size_t i = 0; i < children.size(); ++i){
+    SpawnChild(i);
+  }
+
+  std::cout << "\033[1;37mStarted worker processes: \033[0m\033[1;33m" << children.size() << "\033[0m\n";
+
+  while (true){
+    int   status;
+    pid_t pid = waitpid(-1, &status, 0);
+
+    if (pid < 0){
+      if (errno != EINTR){
+        Policies::logger::Error("Function waitpid failed!", strerror(errno));
+        exit(EXIT_FAILURE);
+      }
+      // destructor stops worker processes
+      if (stop_requested){
+        return;
+      }
+      if (report_requested){
+        report_requested = 0;
+        ReportPrefork();
+      }
+      if (reload_requested){
+        reload_requested = 0;
+        ReloadMaster();
+        if (!prefork){
+          return;
+        }
       }
+      continue;
     }
-  } while (!end_server);
+
+    auto it = std::find(children.begin(), children.end(), pid);
+    if (it == children.end()){
+      continue;
+    }
+    std::size_t i = it - children.begin();
+
+    std::string why = WIFSIGNALED(status) ? "was killed by signal " + std::to_string(WTERMSIG(status))
+                                          : "exited with status " + std::to_string(WEXITSTATUS(status));
+    Policies::logger::Warning(("Worker process " + std::to_string(pid) + " " + why + ", it is restarted.").c_str());
+
+    ++prefork->Slot(i).restarts;
+
+    // process which dies at once is not restarted in a busy loop
+    if (std::chrono::steady_clock::now() - started[i] < std::chrono::seconds(1)){
+      sleep(1);
+    }
+    SpawnChild(i);
+  }
 }
 
-HTTP_Server::~HTTP_Server(){
-  std::cout << "Closing all conections...\n";
+template <class Policies>
+void Basic_HTTP_Server<Policies>::SpawnChild(std::size_t i){
+  started[i] = std::chrono::steady_clock::now();
 
-  for (auto it_poll = cli_poll.begin(); it_poll != cli_poll.end(); ++it_poll){
-    if(it_poll->fd != -1) close(it_poll->fd);
+  pid_t pid = fork();
+  if (pid < 0){
+    Policies::logger::Error("Function fork failed!", strerror(errno));
+    children[i] = -1;
+    return;
   }
+  if (pid > 0){
+    children[i] = pid;
+    return;
+  }
+
+  // worker process dies with master
+  prctl(PR_SET_PDEATHSIG, SIGTERM);
+  if (getppid() == 1){
+    _exit(EXIT_FAILURE);
+  }
+  signal(SIGUSR1, SIG_IGN);
+  signal(SIGUSR2, SIGUSR2_Handler);
+  signal(SIGTERM, SIGTERM_Handler);
+  signal(SIGINT, SIG_IGN);  // Ctrl-C of terminal reaches master, it stops workers
+
+  slot      = &prefork->Slot(i);
+  slot->pid = getpid();
+  if (shared_cache){
+    shared_cache->Attach(i);
+  }
+
+  // every process takes its own cpu of worker-cpus
+  if (info.worker_cpus.size()){
+    std::rotate(info.worker_cpus.begin(), info.worker_cpus.begin() + i % info.worker_cpus.size(), info.worker_cpus.end());
+  }
+  info.number_workers = info.min_workers = info.max_workers = 1;
+
+  StartServing();
+  StartWarmup();
+  RunEventLoop();
+
+  // buffered records of capture are written before exit, the first process records hot list
+  FreeCapture();
+  if (i == 0){
+    FreeCache();
+  }
+  _exit(EXIT_SUCCESS);
+}
 
-  server->cli_poll.clear();
+template <class Policies>
+void Basic_HTTP_Server<Policies>::StopChildren(){
+  for (auto it = children.begin(); it != children.end(); ++it){
+    if (*it > 0) kill(*it, SIGTERM);
+  }
+  for (auto it = children.begin(); it != children.end(); ++it){
+    while (*it > 0 && waitpid(*it, nullptr, 0) < 0 && errno == EINTR);
+  }
+  children.clear();
+}
+
+// listeners, TLS and shared memory are created again, so worker processes are restarted
+template <class Policies>
+void Basic_HTTP_Server<Policies>::ReloadMaster(){
+  StopChildren();
+
+  poller.Close();
+  FreeTLS();
+  FreeBundle();
+  FreeAutoindex();
+  FreePrefork();
+  FreeCapture();
+
+  init(info.config_path.c_str());
+
+  std::cout << "\033[1;37mStart listening at: \033[0m\033[1;33m" << info.ip << ":" << info.port << "\033[0m\n";
+  if (tls){
+    std::cout << "\033[1;37mStart TLS listening at: \033[0m\033[1;33m" << info.ip << ":" << info.tls_port << "\033[0m\n";
+  }
+
+  // prefork-processes was removed: this process serves with threads again
+  if (!prefork){
+    signal(SIGUSR1, SIGUSR1_Handler);
+    signal(SIGUSR2, SIGUSR2_Handler);
+    StartWarmup();
+    return;
+  }
+
+  children.assign(prefork->Count(), -1);
+  started.assign(prefork->Count(), std::chrono::steady_clock::now());
+  for (std::size_t i = 0; i < children.size(); ++i){
+    SpawnChild(i);
+  }
+}
+
+template <class Policies>
+void Basic_HTTP_Server<Policies>::ReportPrefork(){
+  prefork->Print(std::cout);
+
+  if (shared_cache){
+    std::cout << "shared cache: " << shared_cache->Count() << " files, " << shared_cache->Used() << " of "
+              << shared_cache->DataSize() << " bytes, hits: " << shared_cache->Hits()
+              << ", misses: " << shared_cache->Misses() << ", reclaims: " << shared_cache->Reclaims() << std::endl;
+  }
+}
+
+template <class Policies>
+void Basic_HTTP_Server<Policies>::FreeCapture(){
+  delete capture;
+  capture = nullptr;
+}
+
+template <class Policies>
+void Basic_HTTP_Server<Policies>::FreeTracer(){
+  delete tracer;
+  tracer = nullptr;
+}
+
+template <class Policies>
+void Basic_HTTP_Server<Policies>::FreePrefork(){
+  delete shared_cache;
+  delete prefork;
+  shared_cache = nullptr;
+  prefork      = nullptr;
+}
+
+template <class Policies>
+Basic_HTTP_Server<Policies>::~Basic_HTTP_Server(){
+  std::cout << "Closing all conections...\n";
 
   RequestKillWorkers();
+  FreePool();
+  DropWriters();
+  poller.Close();
+
+  clear_tasks();
+  FreeTLS();
+  FreeCache();
+  FreeBundle();
+  FreeAutoindex();
+  FreeTracer();
+  FreeCapture();
+
+  // only master stops worker processes
+  if (prefork && !slot){
+    StopChildren();
+  }
+  FreePrefork();
 
   delete [] workers;
 }
+
+// the default variant; other policy sets are instantiated next to it
+template class Basic_HTTP_Server<Default_Policies>;
+#ifdef HTTP_SERVER_WITH_EPOLL
+template class Basic_HTTP_Server<Epoll_Policies>;
+#endif
@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <vector>
 #include <map>
+#include <string_view>
 
 #include <condition_variable>
 #include <mutex>
@@ -13,12 +14,22 @@
 #include <regex>
 
 #include <thread>
+#include <atomic>
+#include <chrono>
+#include <deque>
 
 #include <unistd.h>
 #include <cstring>
+#include <fcntl.h>
 #include <termios.h>
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/sendfile.h>
+#include <sys/eventfd.h>
+#include <sys/wait.h>
+#include <sys/prctl.h>
 #include <sys/ioctl.h>
 #include <sys/poll.h>
 #include <netinet/in.h>
@@ -28,6 +39,31 @@
 
 #include <config.h>
 #include <parse_xml.h>
+#include <http2.h>
+#include <content_cache.h>
+#include <warmup.h>
+#include <bundle.h>
+#include <numa_topology.h>
+#include <request_arena.h>
+#include <response_chain.h>
+#include <shared_cache.h>
+#include <prefork.h>
+#include <request_trace.h>
+#include <capture.h>
+#include <server_policies.h>
+#include <host_table.h>
+#include <worker_pool.h>
+#include <autoindex.h>
+#include <socket_options.h>
+#include <request_path.h>
+
+#ifdef HTTP_SERVER_WITH_TLS
+#include <tls.h>
+#else
+class TLS_Context;
+#endif
+
+struct ssl_st;
 
 
 struct membuf : std::streambuf{
@@ -36,39 +72,126 @@ struct membuf : std::streambuf{
     }
 };
 
-class HTTP_Server{
+struct connection{
+    int       fd;
+    ssl_st *  ssl;          // nullptr - plain TCP connection
+    bool      can_sendfile; // body of static file may be sent by sendfile/SSL_sendfile
+    int       incoming_node;  // NUMA node of cpu which received connection, -1 - unknown
+    std::size_t worker;       // index of worker which serves connection
+    std::pmr::memory_resource * arena;  // memory of worker for request and respond
+    std::shared_ptr<Response_Chain> pending;  // rest of respond which waits for writable socket
+    std::shared_ptr<request_trace>  trace;    // timeline of sampled request, nullptr - not sampled
+    std::size_t received;     // bytes of request
+    std::uint32_t host;       // index of virtual host from Host header, 0 - default host
+    std::uint64_t queued_ns;  // when it was pushed to task queue, 0 - pool is not sampled
+    int       wait_ms = -1;   // how long worker waits for slow client, -1 - forever
+};
+
+// Server core over compile-time policies (see server_policies.h): every
+// variant is a separate instantiation, nothing is dispatched virtually.
+template <class Policies>
+class Basic_HTTP_Server{
+
+  typedef void (Basic_HTTP_Server::*MFP)(std::istream & , Response_Chain &, connection &);
 
-  typedef void (HTTP_Server::*MFP)(std::istream & , std::vector<uint8_t> &);
+  typedef typename Policies::allocator                      allocator;
+  typedef typename Policies::template scheduler<connection> task_queue;
 
   public:
 
-    HTTP_Server() = delete;
-    HTTP_Server(const char  *  pathname_config);
-    HTTP_Server(std::string &  pathname_config);
+    Basic_HTTP_Server() = delete;
+    Basic_HTTP_Server(const char  *  pathname_config);
+    Basic_HTTP_Server(std::string &  pathname_config);
 
     void Run();
 
-    ~HTTP_Server();
+    ~Basic_HTTP_Server();
 
   private:
 
-    parse_info                  info;
+  struct worker_ctx{
+      std::thread                 thread;
+      std::vector<int>            cpus;       // affinity, empty - worker is not pinned
+      std::size_t                 node;       // NUMA node of `cpus`
+      std::size_t                 queue;      // index of task_queue it takes connections from
+      std::size_t                 shard;      // index of content cache shard
+
+      std::unique_ptr<allocator>  arena;        // allocated by worker itself: first touch on its node
+      std::vector<char>           buff;
 
-    std::condition_variable     cv;
-    std::mutex                  mtx;
-    std::queue<int>             tasks;
-    std::uint32_t               number_workers;
-    std::thread *               workers;
+      std::atomic<bool>           running;      // slot has thread, retired threads wait for join
+      std::atomic<std::uint64_t>  busy_ns;      // time spent serving connections
+      std::atomic<std::uint64_t>  busy_since;   // start of current connection, 0 - waiting for one
+
+      // numa-report: requests received on the node of worker and on another node
+      std::atomic<std::uint64_t>  local_requests;
+      std::atomic<std::uint64_t>  remote_requests;
+      std::atomic<std::uint64_t>  local_ns;
+      std::atomic<std::uint64_t>  remote_ns;
+
+  #ifdef HTTP_SERVER_ALLOC_STATS
+      std::atomic<std::uint64_t>  requests;
+      std::atomic<std::uint64_t>  heap_allocations;
+      std::atomic<std::uint64_t>  zero_allocation_requests;
+      std::atomic<std::uint64_t>  arena_overflows;
+  #endif
+  };
+
+    static Basic_HTTP_Server *  instance;         // for signal handlers
+
+    parse_info                  info;
 
-    union{
-        sockaddr_in                 v4;
-        sockaddr_in6                v6;
-    } socket_addr;
+    NUMA_Topology               topology;
+    std::deque<task_queue>      queues;           // one per NUMA node if connections are steered by incoming cpu
+    std::vector<std::size_t>    node_index;       // NUMA node -> index of queue/shard of this node
+    std::uint32_t               number_workers;   // slots of pool: max-workers
+    worker_ctx *                workers;
+
+    Pool_Governor *             governor;         // nullptr - size of pool is fixed
+    std::thread                 governor_thread;
+    std::mutex                  governor_mtx;
+    std::condition_variable     governor_cv;
+    bool                        governor_stopped;
+    std::atomic<std::size_t>    active_workers;   // changed by governor only
+    std::vector<std::size_t>    queue_workers;    // running workers of every task queue
+    std::atomic<std::uint64_t>  dequeued;
+    std::atomic<std::uint64_t>  queue_wait_ns;
+    std::atomic<std::uint64_t>  disk_wait_ns;     // time workers spent in filesystem calls
+    std::atomic<std::uint32_t>  http2_connections; // h2 connections which hold pool workers
 
     int                         socket_fd;
-    std::vector<struct pollfd>  cli_poll;
+    int                         tls_socket_fd;
+    typename Policies::events   poller;           // listeners, clients waiting for request, parked connections
 
-    char                        buff[MAX_BUFFER_SIZE];
+    int                         wake_fd;          // eventfd: workers have parked connections
+    std::mutex                  parked_mtx;
+    std::vector<connection>     parked;           // handed by workers, not polled yet
+    std::map<int, connection>   writers;          // polled until socket is writable
+
+    TLS_Context *               tls;
+    std::map<int, ssl_st *>     tls_handshakes;   // accepted TLS clients, handshake is in progress
+    std::map<int, ssl_st *>     tls_clients;      // handshake is done, waiting for request
+
+    std::vector<virtual_host_info>  hosts;        // 0 - default host of root-path, then <virtual-host> ones
+    Host_Table                  host_table;       // lowercased name -> index in `hosts`
+    std::vector<std::vector<Content_Cache *>> caches;  // of every host: one shard per NUMA node with numa-local
+    std::vector<Webroot_Warmup *> warmups;
+    Static_Bundle *             bundle;           // files of default host
+    Directory_Index *           autoindex;        // listings of directories without index file, nullptr - 403
+
+    Prefork_Stats *             prefork;          // counters of worker processes, nullptr - threaded mode
+    Shared_Cache *              shared_cache;     // content cache in memory shared by worker processes
+    prefork_slot *              slot;             // counters of this worker process, nullptr - master or threaded mode
+    std::vector<pid_t>          children;         // master: worker process of every slot
+    std::vector<std::chrono::steady_clock::time_point> started;
+    volatile sig_atomic_t       reload_requested;
+    volatile sig_atomic_t       report_requested;
+    volatile sig_atomic_t       stop_requested;   // worker process leaves event loop
+
+    Request_Tracer *            tracer;           // nullptr - sampling is disabled
+    std::map<int, std::shared_ptr<request_trace>> sampled;  // accepted sampled clients, waiting for request
+
+    Traffic_Capture *           capture;          // opened by master, worker processes append to the same file
 
 
     const wchar_t HEX2DEC[256] =
@@ -95,13 +218,13 @@ class HTTP_Server{
         /* F */ -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1
       };
 
-    std::map<std::string, std::string> extension_mime;
+    std::map<std::string, std::string, std::less<>> extension_mime;
 
-    const std::map<std::string, MFP> requests =
+    const std::map<std::string, MFP, std::less<>> requests =
       {
-        {"GET",       & HTTP_Server::GET_Handler    }, /* The GET method is used to retrieve information from the given server using a given URI. Requests using GET should only retrieve data and should have no other effect on the data.*/
+        {"GET",       & Basic_HTTP_Server::GET_Handler    }, /* The GET method is used to retrieve information from the given server using a given URI. Requests using GET should only retrieve data and should have no other effect on the data.*/
         {"HEAD",      nullptr                       }, /* Same as GET, but it transfers the status line and the header section only.*/
-        {"POST",      & HTTP_Server::POST_Handler   }, /* A POST request is used to send data to the server, for example, customer information, file upload, etc. using HTML forms.*/
+        {"POST",      & Basic_HTTP_Server::POST_Handler   }, /* A POST request is used to send data to the server, for example, customer information, file upload, etc. using HTML forms.*/
         {"PUT",       nullptr                       }, /* Replaces all the current representations of the target resource with the uploaded content.*/
         {"DELETE",    nullptr                       }, /* Removes all the current representations of the target resource given by URI.*/
         {"CONNECT",   nullptr                       }, /* Establishes a tunnel to the server identified by a given URI.*/
@@ -113,6 +236,8 @@ class HTTP_Server{
       {
         {200, "200 OK\n"                          },
 
+        {301, "301 Moved Permanently\n"           },
+
         {400, "400 Bad Request\n"                 },
         {403, "403 Forbidden\n"                   },
         {404, "404 Not Found\n"                   },
@@ -124,30 +249,101 @@ class HTTP_Server{
 
     std::string mime_types;
 
-    std::string   UriDecode               (const std::string & sSrc);
+    arena_string  UriDecode               (const arena_string & sSrc);
 
-    void          RequestHandler          ();
+    void          RequestHandler          (std::size_t index);
+    void          ServeConnection         (std::size_t index, connection conn);
+    void          BuildResponse           (std::istream & request, Response_Chain & respond, connection & conn);
+    void          ServeHTTP2              (connection & conn, byte_buffer & received);
 
-    void          GET_POST_Header_Handler (std::istream & request, std::vector<uint8_t> & respond, bool is_get = true);
-    void          GET_Handler             (std::istream & request, std::vector<uint8_t> & respond);
-    void          POST_Handler            (std::istream & request, std::vector<uint8_t> & respond);
+    void          GET_POST_Header_Handler (std::istream & request, Response_Chain & respond, connection & conn, bool is_get = true);
+    void          GET_Handler             (std::istream & request, Response_Chain & respond, connection & conn);
+    void          POST_Handler            (std::istream & request, Response_Chain & respond, connection & conn);
 
     inline void   init                    (const char * pathname_congig);
-
-    inline void   readFile                (const char* filename,      std::vector<uint8_t> & dst);
-
-    inline void   PutStatus               (uint16_t status,           std::vector<uint8_t> & dst);
-    inline void   PutDateTime             (                           std::vector<uint8_t> & dst);
-    inline void   PutLastModified         (timespec &ts,              std::vector<uint8_t> & dst);
-    inline void   PutContentLenth         (int32_t lenth,             std::vector<uint8_t> & dst);
-    inline void   PutServerName           (                           std::vector<uint8_t> & dst);
-    inline void   PutContentType          (std::string & filename,    std::vector<uint8_t> & dst);
-    inline void   PutConnection           (                           std::vector<uint8_t> & dst);
-
-    inline void   GetCurrentDateTime      (std::string & buffer, tm * _tstruct);
-    inline void   timespec2str            (std::string & buffer, timespec & ts);
+    inline void   StartServing            ();
+    inline void   StartWorkers            ();
+    inline void   PrepareWorker           (worker_ctx & self);
+    inline void   StartWorker             (std::size_t index);
+    inline void   RunGovernor             ();
+    inline void   ResizePool              (std::size_t target);
+    inline void   StopGovernor            ();
+    inline void   FreePool                ();
+    inline void   ReportPool              ();
+    template <class F>
+    inline void   Blocking                (F && operation);
+    inline int    CreateListener          (std::uint16_t port);
+
+    inline void   readFile                (const char* filename,      Response_Chain & dst, connection * conn = nullptr);
+
+    inline void   PutString               (std::string_view str,      Response_Chain & dst);
+    inline void   PutStatus               (uint16_t status,           Response_Chain & dst);
+    inline void   PutErrorPage            (uint16_t status,           Response_Chain & dst, connection & conn);
+    inline bool   LoadShared              (const arena_string & pathname, const struct stat & _stat, shared_cache_hit & hit);
+    inline bool   PutCachedFile           (const arena_string & pathname, const struct stat & _stat, Response_Chain & dst, connection & conn);
+    inline bool   PutBundleFile           (uint16_t status, std::string_view path, Response_Chain & dst, bool gzip);
+    inline bool   PutListing              (const arena_string & directory, const struct stat & _stat, std::string_view uri,
+                                           std::string_view query, Response_Chain & dst);
+    inline void   PutRedirect             (std::string_view target,   Response_Chain & dst);
+    inline void   PutDateTime             (                           Response_Chain & dst);
+    inline void   PutLastModified         (timespec &ts,              Response_Chain & dst);
+    inline void   PutETag                 (const std::string & etag,  Response_Chain & dst);
+    inline void   PutContentLenth         (int32_t lenth,             Response_Chain & dst);
+    inline void   PutServerName           (                           Response_Chain & dst);
+    inline void   PutContentType          (const char * filename,     Response_Chain & dst);
+    inline void   PutConnection           (                           Response_Chain & dst);
+    inline void   PutTrace                (                           Response_Chain & dst);
+
+    inline void   GetCurrentDateTime      (Response_Chain & dst, tm * _tstruct);
+    inline void   timespec2str            (Response_Chain & dst, timespec & ts);
+
+    inline int    RecvSome                (connection & conn, char * dst, std::size_t size);
+    inline bool   SendAll                 (connection & conn, const uint8_t * src, std::size_t size);
+    inline void   FinishResponse          (connection & conn, Response_Chain & respond);
+    inline void   ParkConnection          (connection & conn, Response_Chain & respond);
+    inline void   TakeParked              ();
+    inline void   DropWriters             ();
+
+    inline void   RunEventLoop            ();
+    inline void   RunMaster               ();
+    inline void   SpawnChild              (std::size_t i);
+    inline void   StopChildren            ();
+    inline void   ReloadMaster            ();
+    inline void   ReportPrefork           ();
+    inline void   FreePrefork             ();
+    inline void   FreeTracer              ();
+    inline void   FreeCapture             ();
+    inline void   CaptureRequest          (connection & conn, std::uint64_t time_ns, const byte_buffer & msg, const Response_Chain & respond);
+    inline bool   IsReadable              (connection & conn);
+    inline bool   WaitSocket              (connection & conn, short events);
+    inline void   CloseConnection         (connection & conn);
+
+    inline void   AcceptClients           (int listen_fd);
+    inline bool   ContinueHandshake       (int fd);
+    inline void   DropClient              (int fd);
+    inline void   FreeTLS                 ();
+
+    inline void   BuildCachedHeaders      (cache_entry & entry);
+    inline void   InitHosts               ();
+    inline void   StartWarmup             ();
+    inline void   FreeCache               ();
+    inline void   FreeBundle              ();
+    inline void   FreeAutoindex           ();
+
+    inline connection MakeConnection      (int fd, ssl_st * ssl);
+    inline void   Dispatch                (const connection & conn);
+    inline Content_Cache * CacheOf        (connection & conn);
+    inline void   RecordRequest           (worker_ctx & self, connection & conn, std::chrono::steady_clock::time_point start);
+    inline void   ReportNUMA              ();
+#ifdef HTTP_SERVER_ALLOC_STATS
+    inline void   ReportAllocations       ();
+#endif
+
+    inline bool   ReadHeaders             (std::istream & request, connection & conn);
 
     static void   SIGUSR1_Handler         (int signum);
+    static void   SIGUSR2_Handler         (int signum);
+    static void   SIGTERM_Handler         (int signum);
 
     inline void   RequestKillWorkers      ();
     inline void   join_all_workers        ();
@@ -155,4 +351,11 @@ class HTTP_Server{
     inline void   additional_tools        ();
 };
 
-extern HTTP_Server * server;
+#ifdef HTTP_SERVER_WITH_EPOLL
+typedef Basic_HTTP_Server<Epoll_Policies>   HTTP_Server;
+#else
+typedef Basic_HTTP_Server<Default_Policies> HTTP_Server;
+#endif
+
+// members are defined in http_server.cpp, the default set is instantiated there
+extern template class Basic_HTTP_Server<Default_Policies>;
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+#include <algorithm>
+
+// Decoded request path resolved without file system: empty and `.`
+// segments are dropped, `..` takes away the previous segment. Path which
+// climbs above root or holds NUL is rejected, so nothing outside of root
+// reaches stat, bundle or listing. Result starts with '/' and keeps the
+// trailing slash of directory (`/a/b/..` gives `/a/`).
+template <class String>
+bool NormalizePath(String & path){
+  if (path.empty() || path[0] != '/' || path.find('\0') != String::npos){
+    return false;
+  }
+
+  String result(path.get_allocator());
+  result.reserve(path.size());
+
+  bool is_directory = false;
+  for (std::size_t begin = 1, end; begin <= path.size(); begin = end + 1){
+    end = std::min(path.find('/', begin), path.size());
+    std::size_t size = end - begin;
+
+    if (size == 0 || (size == 1 && path[begin] == '.')){
+      is_directory = true;
+      continue;
+    }
+
+    if (size == 2 && path[begin] == '.' && path[begin + 1] == '.'){
+      if (result.empty()){
+        return false;
+      }
+      result.resize(result.rfind('/'));
+      is_directory = true;
+      continue;
+    }
+
+    result.push_back('/');
+    result.append(path, begin, size);
+    is_directory = false;
+  }
+
+  if (is_directory || result.empty()){
+    result.push_back('/');
+  }
+  path.swap(result);
+  return true;
+}
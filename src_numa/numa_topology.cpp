@@ -0,0 +1,123 @@
+#include <numa_topology.h>
+
+#include <fstream>
+#include <cstring>
+#include <cstdlib>
+
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+NUMA_Topology::NUMA_Topology(){
+  std::map<int, std::vector<int>> nodes; // sysfs node id -> cpus, node ids may have gaps
+
+  if (DIR * dir = opendir("/sys/devices/system/node")){
+    while (dirent * entry = readdir(dir)){
+      if (std::strncmp(entry->d_name, "node", 4) || !isdigit(entry->d_name[4])){
+        continue;
+      }
+
+      std::ifstream    file(std::string("/sys/devices/system/node/") + entry->d_name + "/cpulist");
+      std::string      list;
+      std::vector<int> cpus;
+
+      if (std::getline(file, list) && ParseCPUList(list, cpus) && cpus.size()){
+        nodes[atoi(entry->d_name + 4)] = cpus;
+      }
+    }
+    closedir(dir);
+  }
+
+  if (nodes.empty()){ // no NUMA in kernel: one node with every online cpu
+    std::ifstream file("/sys/devices/system/cpu/online");
+    std::string   list;
+    if (!std::getline(file, list) || !ParseCPUList(list, nodes[0])){
+      nodes[0].push_back(0);
+    }
+  }
+
+  for (auto it = nodes.begin(); it != nodes.end(); ++it){
+    for (auto it_cpu = it->second.begin(); it_cpu != it->second.end(); ++it_cpu){
+      cpu_node[*it_cpu] = node_cpus.size();
+    }
+    node_cpus.push_back(it->second);
+  }
+}
+
+std::size_t NUMA_Topology::NodeOf(int cpu) const{
+  auto it = cpu_node.find(cpu);
+  return it == cpu_node.end() ? 0 : it->second;
+}
+
+// cpu_set_t holds CPU_SETSIZE cpus, and numbers above the configured cpus are typos
+bool NUMA_Topology::ParseCPUList(const std::string & list, std::vector<int> & cpus){
+  const char * pos = list.c_str();
+  long         end_cpu = sysconf(_SC_NPROCESSORS_CONF);
+  if (end_cpu <= 0 || end_cpu > CPU_SETSIZE){
+    end_cpu = CPU_SETSIZE;
+  }
+
+  while (*pos){
+    char * end;
+    long   first = strtol(pos, &end, 10);
+    long   last  = first;
+
+    if (end == pos || first < 0){
+      return false;
+    }
+    pos = end;
+
+    if (*pos == '-'){
+      last = strtol(++pos, &end, 10);
+      if (end == pos || last < first){
+        return false;
+      }
+      pos = end;
+    }
+
+    if (last >= end_cpu){
+      return false;
+    }
+
+    for (long cpu = first; cpu <= last; ++cpu){
+      cpus.push_back(cpu);
+    }
+
+    while (*pos == ',' || isspace(*pos)){
+      ++pos;
+    }
+  }
+
+  return true;
+}
+
+bool NUMA_Topology::PinThread(pthread_t thread, const std::vector<int> & cpus){
+  if (cpus.empty()){
+    return true;
+  }
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (auto it = cpus.begin(); it != cpus.end(); ++it){
+    CPU_SET(*it, &set);
+  }
+
+  int rc = pthread_setaffinity_np(thread, sizeof(set), &set);
+  if (rc){
+    std::cerr << "\n\033[1;31mError!!! Cannot set CPU affinity! \033[0m\033[1;35m" << strerror(rc) << "\033[0m\n";
+    return false;
+  }
+  return true;
+}
+
+// cpu which processed the last packet of connection, -1 if unknown
+int NUMA_Topology::IncomingCPU(int fd){
+#ifdef SO_INCOMING_CPU
+  int       cpu = -1;
+  socklen_t len = sizeof(cpu);
+  if (getsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) == 0){
+    return cpu;
+  }
+#endif
+  return -1;
+}
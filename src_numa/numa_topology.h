@@ -0,0 +1,32 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+
+#include <pthread.h>
+#include <sched.h>
+
+// CPU -> NUMA node map from sysfs and thread pinning. Memory locality is
+// reached by first touch: pinned thread allocates and touches its own
+// buffers, so the kernel places them on the node of that thread.
+class NUMA_Topology{
+
+    std::map<int, std::size_t>    cpu_node;   // cpu -> index of node
+    std::vector<std::vector<int>> node_cpus;  // index of node -> its cpus
+
+  public:
+
+    NUMA_Topology();
+
+    std::size_t                   Nodes       () const { return node_cpus.size(); }
+    std::size_t                   NodeOf      (int cpu) const;
+    const std::vector<int> &      CPUsOf      (std::size_t node) const { return node_cpus[node]; }
+
+    // "0-3,8,10-11" -> {0,1,2,3,8,10,11}, false - malformed or cpu is not configured
+    static bool                   ParseCPUList(const std::string & list, std::vector<int> & cpus);
+
+    static bool                   PinThread   (pthread_t thread, const std::vector<int> & cpus);
+    static int                    IncomingCPU (int fd);
+};
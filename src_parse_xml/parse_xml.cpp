@@ -37,11 +37,68 @@ void ParseXmlConfig::StartParsing(parse_info & _info){
 
   _info.port           = 0;
   _info.number_workers = 0;
+  _info.min_workers    = 0;
+  _info.max_workers    = 0;
+  _info.root_path.erase();
+  _info.bundle_path.erase();
+
+  _info.tls_port            = 0;
+  _info.tls_certificate.erase();
+  _info.tls_private_key.erase();
+  _info.tls_session_cache   = TLS_SESSION_CACHE;
+  _info.tls_session_timeout = TLS_SESSION_TIMEOUT;
+  _info.tls_session_tickets = true;
+  _info.tls_kernel_offload  = true;
+
+  _info.http2               = true;
+  _info.http2_max_streams   = HTTP2_MAX_STREAMS;
+  _info.http2_idle_timeout  = HTTP2_IDLE_TIMEOUT;
+  _info.http2_max_connections = 0;
+
+  _info.cache_size            = CACHE_SIZE;
+  _info.cache_max_file_size   = CACHE_MAX_FILE_SIZE;
+  _info.warmup                = false;
+  _info.warmup_threads        = 0;
+  _info.warmup_max_file_size  = WARMUP_MAX_FILE_SIZE;
+  _info.warmup_hot_list.erase();
+  _info.warmup_ready_file.erase();
+
+  _info.worker_cpus.clear();
+  _info.reactor_cpus.clear();
+  _info.numa_local            = false;
+  _info.incoming_cpu          = false;
+  _info.numa_report           = false;
+
+  _info.zerocopy_threshold    = ZEROCOPY_THRESHOLD;
+
+  _info.prefork_processes     = 0;
+  _info.prefork_shared_cache  = 0;
+
+  _info.trace_sample_rate     = 0;
+  _info.trace_ring_size       = TRACE_RING_SIZE;
+  _info.trace_endpoint        = TRACE_ENDPOINT;
+
+  _info.capture_file.erase();
+
+  _info.listen_backlog        = MAX_LISTENING_CLIENTS;
+  _info.defer_accept          = 0;
+  _info.tcp_fastopen          = 0;
+  _info.tcp_nodelay           = false;
+  _info.tcp_cork              = false;
+  _info.send_buffer           = 0;
+  _info.receive_buffer        = 0;
+  _info.accept_batch          = ACCEPT_BATCH;
+
+  _info.index_file            = INDEX_FILE;
+  _info.autoindex             = false;
+  _info.autoindex_page_size   = AUTOINDEX_PAGE_SIZE;
+
+  _info.virtual_hosts.clear();
 
   while (cur != NULL) {
     std::string name_branch(reinterpret_cast <const char *> (cur->name));
 
-    if (name_branch == "text"){
+    if (name_branch == "text" || name_branch == "comment"){
       cur = cur->next;
       continue;
     }
@@ -145,6 +202,27 @@ void ParseXmlConfig::ParseRootPath  (parse_info & info){
   xmlFree(str_value);
 }
 
+void ParseXmlConfig::ParseBundlePath(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if(!str_value){
+    std::cerr << "\nBundle was not type in configuration file!\n";
+    return;
+  }
+
+  info.bundle_path = reinterpret_cast< char * > (str_value);
+  xmlFree(str_value);
+
+  if (!is_readable(info.bundle_path.c_str())){
+    std::string path = "\nError!!! Field bundle path!\n`" + info.bundle_path + '`';
+    std::perror(path.c_str());
+    info.bundle_path.erase();
+    return;
+  }
+
+  std::cout << "Bundle set to: " << info.bundle_path << std::endl;
+}
+
 void ParseXmlConfig::ParseNumWorker (parse_info & info){
   xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
 
@@ -169,33 +247,1009 @@ void ParseXmlConfig::ParseNumWorker (parse_info & info){
   std::cout << "Number workers set to: " << info.number_workers << std::endl;
 }
 
-bool ParseXmlConfig::is_ipv4_address(const char * address){
-  struct sockaddr_in sa;
-  return inet_pton(AF_INET, address, &(sa.sin_addr))!=0;
+void ParseXmlConfig::ParseMinWorkers(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nMin workers was not type in configuration file!\n";
+    return;
+  }
+
+  int workers = atoi(reinterpret_cast<char *> (str_value));
+  xmlFree(str_value);
+
+  if (workers <= 0){
+    std::cerr << "\nError!!! Not valid data in field min workers in configuration file!\n";
+    return;
+  }
+
+  info.min_workers = workers;
+
+  std::cout << "Min workers set to: " << info.min_workers << std::endl;
 }
 
-bool ParseXmlConfig::is_ipv6_address(const char * address){
-  struct sockaddr_in6 sa;
-  return inet_pton(AF_INET6, address, &(sa.sin6_addr))!=0;
+void ParseXmlConfig::ParseMaxWorkers(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nMax workers was not type in configuration file!\n";
+    return;
+  }
+
+  int workers = atoi(reinterpret_cast<char *> (str_value));
+  xmlFree(str_value);
+
+  if (workers <= 0){
+    std::cerr << "\nError!!! Not valid data in field max workers in configuration file!\n";
+    return;
+  }
+
+  info.max_workers = workers;
+
+  std::cout << "Max workers set to: " << info.max_workers << std::endl;
 }
 
-void ParseXmlConfig::check_info(parse_info & info){
+void ParseXmlConfig::ParseTLSPort   (parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
 
-  bool must_exit = false;
+  if (!str_value){
+    std::cerr << "\nTLS port number was not type in configuration file!\n";
+    return;
+  }
 
-  if (info.ip.empty()){
-    std::cerr << "\nIP address was not parsed!\n";
-    must_exit = true;
+  int port = atoi(reinterpret_cast<char *> (str_value));
+  xmlFree(str_value);
+
+  if (port <= 0 || port > 65535){
+    std::cerr << "\nError!!! Not valid data in field with TLS port number in configuration file!\n";
+    return;
   }
 
-  if (info.root_path.empty()){
-    std::cerr << "\nRoot directory was not parsed!\n";
-    must_exit = true;
+  info.tls_port = static_cast<std::uint16_t>(port);
+
+  std::cout << "TLS port number set to: " << info.tls_port << std::endl;
+}
+
+void ParseXmlConfig::ParseTLSCertificate(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nTLS certificate was not type in configuration file!\n";
+    return;
   }
 
-  if (!info.port){
-    std::cerr << "\nPort was not parsed\n";
-    must_exit = true;
+  info.tls_certificate = reinterpret_cast< char * > (str_value);
+  xmlFree(str_value);
+
+  if (!is_readable(info.tls_certificate.c_str())){
+    std::string path = "\nError!!! Field TLS certificate!\n`" + info.tls_certificate + '`';
+    std::perror(path.c_str());
+    info.tls_certificate.erase();
+    return;
+  }
+
+  std::cout << "TLS certificate set to: " << info.tls_certificate << std::endl;
+}
+
+void ParseXmlConfig::ParseTLSPrivateKey(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nTLS private key was not type in configuration file!\n";
+    return;
+  }
+
+  info.tls_private_key = reinterpret_cast< char * > (str_value);
+  xmlFree(str_value);
+
+  if (!is_readable(info.tls_private_key.c_str())){
+    std::string path = "\nError!!! Field TLS private key!\n`" + info.tls_private_key + '`';
+    std::perror(path.c_str());
+    info.tls_private_key.erase();
+    return;
+  }
+
+  std::cout << "TLS private key set to: " << info.tls_private_key << std::endl;
+}
+
+void ParseXmlConfig::ParseTLSSessionCache(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nTLS session cache size was not type in configuration file!\n";
+    return;
+  }
+
+  int size = atoi(reinterpret_cast<char *> (str_value));
+  xmlFree(str_value);
+
+  if (size < 0){
+    std::cerr << "\nError!!! Not valid data in field TLS session cache in configuration file!\n";
+    return;
+  }
+
+  info.tls_session_cache = size;
+
+  std::cout << "TLS session cache set to: " << info.tls_session_cache << " sessions" << std::endl;
+}
+
+void ParseXmlConfig::ParseTLSSessionTimeout(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nTLS session timeout was not type in configuration file!\n";
+    return;
+  }
+
+  int timeout = atoi(reinterpret_cast<char *> (str_value));
+  xmlFree(str_value);
+
+  if (timeout <= 0){
+    std::cerr << "\nError!!! Not valid data in field TLS session timeout in configuration file!\n";
+    return;
+  }
+
+  info.tls_session_timeout = timeout;
+
+  std::cout << "TLS session timeout set to: " << info.tls_session_timeout << "s" << std::endl;
+}
+
+void ParseXmlConfig::ParseTLSSessionTickets(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nTLS session tickets switch was not type in configuration file!\n";
+    return;
+  }
+
+  info.tls_session_tickets = is_switch_on(reinterpret_cast<char *> (str_value));
+  xmlFree(str_value);
+
+  std::cout << "TLS session tickets: " << (info.tls_session_tickets ? "on" : "off") << std::endl;
+}
+
+void ParseXmlConfig::ParseTLSKernelOffload(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nTLS kernel offload switch was not type in configuration file!\n";
+    return;
+  }
+
+  info.tls_kernel_offload = is_switch_on(reinterpret_cast<char *> (str_value));
+  xmlFree(str_value);
+
+  std::cout << "TLS kernel offload: " << (info.tls_kernel_offload ? "on" : "off") << std::endl;
+}
+
+void ParseXmlConfig::ParseHTTP2(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nHTTP/2 switch was not type in configuration file!\n";
+    return;
+  }
+
+  info.http2 = is_switch_on(reinterpret_cast<char *> (str_value));
+  xmlFree(str_value);
+
+  std::cout << "HTTP/2: " << (info.http2 ? "on" : "off") << std::endl;
+}
+
+void ParseXmlConfig::ParseHTTP2MaxStreams(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nHTTP/2 max streams was not type in configuration file!\n";
+    return;
+  }
+
+  int streams = atoi(reinterpret_cast<char *> (str_value));
+  xmlFree(str_value);
+
+  if (streams <= 0){
+    std::cerr << "\nError!!! Not valid data in field HTTP/2 max streams in configuration file!\n";
+    return;
+  }
+
+  info.http2_max_streams = streams;
+
+  std::cout << "HTTP/2 max streams set to: " << info.http2_max_streams << std::endl;
+}
+
+void ParseXmlConfig::ParseHTTP2IdleTimeout(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nHTTP/2 idle timeout was not type in configuration file!\n";
+    return;
+  }
+
+  int timeout = atoi(reinterpret_cast<char *> (str_value));
+  xmlFree(str_value);
+
+  if (timeout <= 0){
+    std::cerr << "\nError!!! Not valid data in field HTTP/2 idle timeout in configuration file!\n";
+    return;
+  }
+
+  info.http2_idle_timeout = timeout;
+
+  std::cout << "HTTP/2 idle timeout set to: " << info.http2_idle_timeout << " s" << std::endl;
+}
+
+void ParseXmlConfig::ParseHTTP2MaxConnections(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nHTTP/2 max connections was not type in configuration file!\n";
+    return;
+  }
+
+  int connections = atoi(reinterpret_cast<char *> (str_value));
+  xmlFree(str_value);
+
+  if (connections <= 0){
+    std::cerr << "\nError!!! Not valid data in field HTTP/2 max connections in configuration file!\n";
+    return;
+  }
+
+  info.http2_max_connections = connections;
+
+  std::cout << "HTTP/2 max connections set to: " << info.http2_max_connections << std::endl;
+}
+
+void ParseXmlConfig::ParseCacheSize(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nCache size was not type in configuration file!\n";
+    return;
+  }
+
+  if (!parse_size(reinterpret_cast<char *> (str_value), info.cache_size)){
+    std::cerr << "\nError!!! Not valid data in field cache size in configuration file!\n";
+    info.cache_size = CACHE_SIZE;
+  }
+  xmlFree(str_value);
+
+  std::cout << "Cache size set to: " << info.cache_size << " bytes" << std::endl;
+}
+
+void ParseXmlConfig::ParseCacheMaxFileSize(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nCache max file size was not type in configuration file!\n";
+    return;
+  }
+
+  if (!parse_size(reinterpret_cast<char *> (str_value), info.cache_max_file_size)){
+    std::cerr << "\nError!!! Not valid data in field cache max file size in configuration file!\n";
+    info.cache_max_file_size = CACHE_MAX_FILE_SIZE;
+  }
+  xmlFree(str_value);
+
+  std::cout << "Cache max file size set to: " << info.cache_max_file_size << " bytes" << std::endl;
+}
+
+void ParseXmlConfig::ParseWarmup(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nWarmup switch was not type in configuration file!\n";
+    return;
+  }
+
+  info.warmup = is_switch_on(reinterpret_cast<char *> (str_value));
+  xmlFree(str_value);
+
+  std::cout << "Warmup: " << (info.warmup ? "on" : "off") << std::endl;
+}
+
+void ParseXmlConfig::ParseWarmupThreads(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nWarmup threads was not type in configuration file!\n";
+    return;
+  }
+
+  int threads = atoi(reinterpret_cast<char *> (str_value));
+  xmlFree(str_value);
+
+  if (threads <= 0){
+    std::cerr << "\nError!!! Not valid data in field warmup threads in configuration file!\n";
+    return;
+  }
+
+  info.warmup_threads = threads;
+
+  std::cout << "Warmup threads set to: " << info.warmup_threads << std::endl;
+}
+
+void ParseXmlConfig::ParseWarmupMaxFileSize(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nWarmup max file size was not type in configuration file!\n";
+    return;
+  }
+
+  if (!parse_size(reinterpret_cast<char *> (str_value), info.warmup_max_file_size)){
+    std::cerr << "\nError!!! Not valid data in field warmup max file size in configuration file!\n";
+    info.warmup_max_file_size = WARMUP_MAX_FILE_SIZE;
+  }
+  xmlFree(str_value);
+
+  std::cout << "Warmup max file size set to: " << info.warmup_max_file_size << " bytes" << std::endl;
+}
+
+void ParseXmlConfig::ParseWarmupHotList(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nWarmup hot list was not type in configuration file!\n";
+    return;
+  }
+
+  info.warmup_hot_list = reinterpret_cast< char * > (str_value);
+  xmlFree(str_value);
+
+  std::cout << "Warmup hot list set to: " << info.warmup_hot_list << std::endl;
+}
+
+void ParseXmlConfig::ParseWarmupReadyFile(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nWarmup ready file was not type in configuration file!\n";
+    return;
+  }
+
+  info.warmup_ready_file = reinterpret_cast< char * > (str_value);
+  xmlFree(str_value);
+
+  std::cout << "Warmup ready file set to: " << info.warmup_ready_file << std::endl;
+}
+
+void ParseXmlConfig::ParseWorkerCPUs(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nWorker CPUs was not type in configuration file!\n";
+    return;
+  }
+
+  info.worker_cpus.clear();
+  if (!NUMA_Topology::ParseCPUList(reinterpret_cast<char *> (str_value), info.worker_cpus)){
+    std::cerr << "\nError!!! Not valid CPU list in field worker CPUs in configuration file!\n";
+    info.worker_cpus.clear();
+  }
+  else{
+    std::cout << "Worker CPUs set to: " << reinterpret_cast<char *> (str_value) << std::endl;
+  }
+  xmlFree(str_value);
+}
+
+void ParseXmlConfig::ParseReactorCPUs(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nReactor CPUs was not type in configuration file!\n";
+    return;
+  }
+
+  info.reactor_cpus.clear();
+  if (!NUMA_Topology::ParseCPUList(reinterpret_cast<char *> (str_value), info.reactor_cpus)){
+    std::cerr << "\nError!!! Not valid CPU list in field reactor CPUs in configuration file!\n";
+    info.reactor_cpus.clear();
+  }
+  else{
+    std::cout << "Reactor CPUs set to: " << reinterpret_cast<char *> (str_value) << std::endl;
+  }
+  xmlFree(str_value);
+}
+
+void ParseXmlConfig::ParseNUMALocal(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nNUMA local switch was not type in configuration file!\n";
+    return;
+  }
+
+  info.numa_local = is_switch_on(reinterpret_cast<char *> (str_value));
+  xmlFree(str_value);
+
+  std::cout << "NUMA local cache shards: " << (info.numa_local ? "on" : "off") << std::endl;
+}
+
+void ParseXmlConfig::ParseIncomingCPU(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nIncoming CPU switch was not type in configuration file!\n";
+    return;
+  }
+
+  info.incoming_cpu = is_switch_on(reinterpret_cast<char *> (str_value));
+  xmlFree(str_value);
+
+  std::cout << "Steering by incoming CPU: " << (info.incoming_cpu ? "on" : "off") << std::endl;
+}
+
+void ParseXmlConfig::ParseNUMAReport(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nNUMA report switch was not type in configuration file!\n";
+    return;
+  }
+
+  info.numa_report = is_switch_on(reinterpret_cast<char *> (str_value));
+  xmlFree(str_value);
+
+  std::cout << "NUMA report: " << (info.numa_report ? "on" : "off") << std::endl;
+}
+
+void ParseXmlConfig::ParseZerocopyThreshold(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nZero-copy threshold was not type in configuration file!\n";
+    return;
+  }
+
+  if (!parse_size(reinterpret_cast<char *> (str_value), info.zerocopy_threshold)){
+    std::cerr << "\nError!!! Not valid data in field zero-copy threshold in configuration file!\n";
+    info.zerocopy_threshold = ZEROCOPY_THRESHOLD;
+  }
+  xmlFree(str_value);
+
+  std::cout << "Zero-copy threshold set to: " << info.zerocopy_threshold << " bytes" << std::endl;
+}
+
+void ParseXmlConfig::ParsePreforkProcesses(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nPrefork processes was not type in configuration file!\n";
+    return;
+  }
+
+  int processes = atoi(reinterpret_cast<char *> (str_value));
+  xmlFree(str_value);
+
+  if (processes < 0){
+    std::cerr << "\nError!!! Not valid data in field prefork processes in configuration file!\n";
+    return;
+  }
+
+  info.prefork_processes = processes;
+
+  std::cout << "Prefork processes set to: " << info.prefork_processes << std::endl;
+}
+
+void ParseXmlConfig::ParsePreforkSharedCache(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nPrefork shared cache size was not type in configuration file!\n";
+    return;
+  }
+
+  if (!parse_size(reinterpret_cast<char *> (str_value), info.prefork_shared_cache)){
+    std::cerr << "\nError!!! Not valid data in field prefork shared cache in configuration file!\n";
+    info.prefork_shared_cache = 0;
+  }
+  xmlFree(str_value);
+
+  std::cout << "Prefork shared cache size set to: " << info.prefork_shared_cache << " bytes" << std::endl;
+}
+
+void ParseXmlConfig::ParseTraceSampleRate(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nTrace sample rate was not type in configuration file!\n";
+    return;
+  }
+
+  int rate = atoi(reinterpret_cast<char *> (str_value));
+  xmlFree(str_value);
+
+  if (rate < 0){
+    std::cerr << "\nError!!! Not valid data in field trace sample rate in configuration file!\n";
+    return;
+  }
+
+  info.trace_sample_rate = rate;
+
+  std::cout << "Trace sample rate set to: 1 of " << info.trace_sample_rate << " requests" << std::endl;
+}
+
+void ParseXmlConfig::ParseTraceRingSize(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nTrace ring size was not type in configuration file!\n";
+    return;
+  }
+
+  int size = atoi(reinterpret_cast<char *> (str_value));
+  xmlFree(str_value);
+
+  if (size <= 0){
+    std::cerr << "\nError!!! Not valid data in field trace ring size in configuration file!\n";
+    return;
+  }
+
+  info.trace_ring_size = size;
+
+  std::cout << "Trace ring size set to: " << info.trace_ring_size << std::endl;
+}
+
+void ParseXmlConfig::ParseTraceEndpoint(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nTrace endpoint was not type in configuration file!\n";
+    return;
+  }
+
+  info.trace_endpoint = reinterpret_cast< char * > (str_value);
+  xmlFree(str_value);
+
+  if (info.trace_endpoint[0] != '/'){
+    info.trace_endpoint.insert(0, "/");
+  }
+
+  std::cout << "Trace endpoint set to: " << info.trace_endpoint << std::endl;
+}
+
+void ParseXmlConfig::ParseCaptureFile(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nCapture file was not type in configuration file!\n";
+    return;
+  }
+
+  info.capture_file = reinterpret_cast< char * > (str_value);
+  xmlFree(str_value);
+
+  std::cout << "Capture file set to: " << info.capture_file << std::endl;
+}
+
+void ParseXmlConfig::ParseListenBacklog(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nListen backlog was not type in configuration file!\n";
+    return;
+  }
+
+  int value = atoi(reinterpret_cast<char *> (str_value));
+  xmlFree(str_value);
+
+  if (value <= 0){
+    std::cerr << "\nError!!! Not valid data in field listen backlog in configuration file!\n";
+    return;
+  }
+
+  info.listen_backlog = value;
+
+  std::cout << "Listen backlog set to: " << info.listen_backlog << std::endl;
+}
+
+void ParseXmlConfig::ParseDeferAccept(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nDefer accept timeout was not type in configuration file!\n";
+    return;
+  }
+
+  int value = atoi(reinterpret_cast<char *> (str_value));
+  xmlFree(str_value);
+
+  if (value < 0){
+    std::cerr << "\nError!!! Not valid data in field defer accept timeout in configuration file!\n";
+    return;
+  }
+
+  info.defer_accept = value;
+
+  std::cout << "Defer accept timeout set to: " << info.defer_accept << std::endl;
+}
+
+void ParseXmlConfig::ParseTCPFastOpen(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nTCP Fast Open queue was not type in configuration file!\n";
+    return;
+  }
+
+  int value = atoi(reinterpret_cast<char *> (str_value));
+  xmlFree(str_value);
+
+  if (value < 0){
+    std::cerr << "\nError!!! Not valid data in field TCP Fast Open queue in configuration file!\n";
+    return;
+  }
+
+  info.tcp_fastopen = value;
+
+  std::cout << "TCP Fast Open queue set to: " << info.tcp_fastopen << std::endl;
+}
+
+void ParseXmlConfig::ParseTCPNoDelay(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nTCP nodelay switch was not type in configuration file!\n";
+    return;
+  }
+
+  info.tcp_nodelay = is_switch_on(reinterpret_cast<char *> (str_value));
+  xmlFree(str_value);
+
+  std::cout << "TCP nodelay: " << (info.tcp_nodelay ? "on" : "off") << std::endl;
+}
+
+void ParseXmlConfig::ParseTCPCork(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nTCP cork switch was not type in configuration file!\n";
+    return;
+  }
+
+  info.tcp_cork = is_switch_on(reinterpret_cast<char *> (str_value));
+  xmlFree(str_value);
+
+  std::cout << "TCP cork: " << (info.tcp_cork ? "on" : "off") << std::endl;
+}
+
+void ParseXmlConfig::ParseSendBuffer(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nSend buffer was not type in configuration file!\n";
+    return;
+  }
+
+  if (!parse_size(reinterpret_cast<char *> (str_value), info.send_buffer) || info.send_buffer > INT32_MAX){
+    std::cerr << "\nError!!! Not valid data in field send buffer in configuration file!\n";
+    info.send_buffer = 0;
+  }
+  xmlFree(str_value);
+
+  std::cout << "Send buffer set to: " << info.send_buffer << " bytes" << std::endl;
+}
+
+void ParseXmlConfig::ParseReceiveBuffer(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nReceive buffer was not type in configuration file!\n";
+    return;
+  }
+
+  if (!parse_size(reinterpret_cast<char *> (str_value), info.receive_buffer) || info.receive_buffer > INT32_MAX){
+    std::cerr << "\nError!!! Not valid data in field receive buffer in configuration file!\n";
+    info.receive_buffer = 0;
+  }
+  xmlFree(str_value);
+
+  std::cout << "Receive buffer set to: " << info.receive_buffer << " bytes" << std::endl;
+}
+
+void ParseXmlConfig::ParseAcceptBatch(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nAccept batch was not type in configuration file!\n";
+    return;
+  }
+
+  int value = atoi(reinterpret_cast<char *> (str_value));
+  xmlFree(str_value);
+
+  if (value <= 0){
+    std::cerr << "\nError!!! Not valid data in field accept batch in configuration file!\n";
+    return;
+  }
+
+  info.accept_batch = value;
+
+  std::cout << "Accept batch set to: " << info.accept_batch << std::endl;
+}
+
+void ParseXmlConfig::ParseIndexFile(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nIndex file was not type in configuration file!\n";
+    return;
+  }
+
+  // "off" disables index files, name with slash would leave directory
+  std::string name = reinterpret_cast< char * > (str_value);
+  xmlFree(str_value);
+
+  if (name == "off"){
+    info.index_file.erase();
+    std::cout << "Index file: off" << std::endl;
+    return;
+  }
+  if (name.find('/') != name.npos){
+    std::cerr << "\nError!!! Index file must be a name without slash: " << name << std::endl;
+    return;
+  }
+
+  info.index_file = name;
+
+  std::cout << "Index file set to: " << info.index_file << std::endl;
+}
+
+void ParseXmlConfig::ParseAutoindex(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nAutoindex switch was not type in configuration file!\n";
+    return;
+  }
+
+  info.autoindex = is_switch_on(reinterpret_cast<char *> (str_value));
+  xmlFree(str_value);
+
+  std::cout << "Autoindex: " << (info.autoindex ? "on" : "off") << std::endl;
+}
+
+void ParseXmlConfig::ParseAutoindexPageSize(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nAutoindex page size was not type in configuration file!\n";
+    return;
+  }
+
+  int size = atoi(reinterpret_cast<char *> (str_value));
+  xmlFree(str_value);
+
+  if (size <= 0){
+    std::cerr << "\nError!!! Not valid data in field autoindex page size in configuration file!\n";
+    return;
+  }
+
+  info.autoindex_page_size = size;
+
+  std::cout << "Autoindex page size set to: " << info.autoindex_page_size << std::endl;
+}
+
+bool ParseXmlConfig::is_switch_on(const char * value){
+  std::string str = value;
+  std::transform(str.begin(), str.end(), str.begin(), ::tolower);
+  return str == "on" || str == "yes" || str == "true" || str == "1";
+}
+
+// number with optional suffix: K, M, G
+bool ParseXmlConfig::parse_size(const char * value, std::size_t & size){
+  char *              end;
+  unsigned long long  number = strtoull(value, &end, 10);
+
+  if (end == value){
+    return false;
+  }
+
+  switch(toupper(*end)){
+    case 'G': number <<= 10; // fall through
+    case 'M': number <<= 10; // fall through
+    case 'K': number <<= 10; ++end; break;
+    default: break;
+  }
+
+  if (*end){
+    return false;
+  }
+
+  size = number;
+  return true;
+}
+
+void ParseXmlConfig::ParseHostName(parse_info & info){
+  xmlChar * str_value = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+
+  if (!str_value){
+    std::cerr << "\nVirtual host name was not type in configuration file!\n";
+    return;
+  }
+
+  std::string name = reinterpret_cast<char *> (str_value);
+  xmlFree(str_value);
+
+  std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c){ return std::tolower(c); });
+  if (name.size() && name.back() == '.'){
+    name.pop_back();
+  }
+  if (name.empty()){
+    std::cerr << "\nError!!! Empty virtual host name in configuration file!\n";
+    return;
+  }
+
+  host_names.push_back(name);
+}
+
+// fields of <virtual-host> are parsed by the same handlers into scratch parse_info,
+// values not set there are inherited from server-wide ones in check_info
+void ParseXmlConfig::ParseVirtualHost(parse_info & info){
+  parse_info  scope;
+  xmlNodePtr  parent = cur;
+
+  scope.cache_size          = SIZE_MAX;
+  scope.cache_max_file_size = SIZE_MAX;
+  scope.http2_idle_timeout  = 0;
+  host_names.clear();
+
+  std::cout << "Virtual host:" << std::endl;
+
+  for (cur = parent->xmlChildrenNode; cur != NULL; cur = cur->next){
+    std::string name_branch(reinterpret_cast <const char *> (cur->name));
+
+    if (name_branch == "text" || name_branch == "comment"){
+      continue;
+    }
+
+    auto it_field = host_fields.find(name_branch);
+    if (it_field == host_fields.end()){
+      std::cerr << "Warning! No handler to branch of virtual host: " << name_branch << std::endl;
+      continue;
+    }
+    (this->*(it_field->second))(scope);
+  }
+  cur = parent;
+
+  if (host_names.empty() || scope.root_path.empty()){
+    std::cerr << "\nError!!! Virtual host " << (host_names.size() ? host_names[0] : std::string("without name"))
+              << " has no name or root directory, it is dropped!\n";
+    return;
+  }
+
+  // names are lowercased, so they repeat case-insensitively; every name maps to one host,
+  // a repeated one would leave no perfect hash for Host header
+  virtual_host_info host;
+  for (auto name = host_names.begin(); name != host_names.end(); ++name){
+    if (std::find(host.names.begin(), host.names.end(), *name) != host.names.end()){
+      std::cerr << "\nError!!! Virtual host name " << *name << " is repeated in host " << host_names[0] << ", it is dropped!\n";
+      continue;
+    }
+
+    auto owner = std::find_if(info.virtual_hosts.begin(), info.virtual_hosts.end(), [&name](const virtual_host_info & other){
+      return std::find(other.names.begin(), other.names.end(), *name) != other.names.end();
+    });
+    if (owner != info.virtual_hosts.end()){
+      std::cerr << "\nError!!! Virtual host name " << *name << " of host " << host_names[0]
+                << " is already used by host " << owner->names[0] << ", it is dropped!\n";
+      continue;
+    }
+    host.names.push_back(*name);
+  }
+
+  if (host.names.empty()){
+    std::cerr << "\nError!!! Virtual host " << host_names[0] << " has no name of its own, it is dropped!\n";
+    return;
+  }
+
+  host.root_path            = scope.root_path;
+  host.cache_size           = scope.cache_size;
+  host.cache_max_file_size  = scope.cache_max_file_size;
+  host.http2_idle_timeout   = scope.http2_idle_timeout;
+  info.virtual_hosts.push_back(host);
+
+  std::cout << "Virtual host names: ";
+  for (auto it = host.names.begin(); it != host.names.end(); ++it){
+    std::cout << *it << " ";
+  }
+  std::cout << std::endl;
+}
+
+bool ParseXmlConfig::is_readable(const char * pathname){
+  return access(pathname, R_OK) == 0;
+}
+
+bool ParseXmlConfig::is_ipv4_address(const char * address){
+  struct sockaddr_in sa;
+  return inet_pton(AF_INET, address, &(sa.sin_addr))!=0;
+}
+
+bool ParseXmlConfig::is_ipv6_address(const char * address){
+  struct sockaddr_in6 sa;
+  return inet_pton(AF_INET6, address, &(sa.sin6_addr))!=0;
+}
+
+void ParseXmlConfig::check_info(parse_info & info){
+
+  bool must_exit = false;
+
+  if (info.ip.empty()){
+    std::cerr << "\nIP address was not parsed!\n";
+    must_exit = true;
+  }
+
+  if (info.root_path.empty() && info.bundle_path.empty() && info.virtual_hosts.empty()){
+    std::cerr << "\nNeither root directory nor bundle was parsed!\n";
+    must_exit = true;
+  }
+
+  if (info.root_path.empty() && info.warmup){
+    std::cerr << "\nWarning! Warmup needs root directory. Warmup is disabled.\n";
+    info.warmup = false;
+  }
+
+  if (!info.port){
+    std::cerr << "\nPort was not parsed\n";
+    must_exit = true;
+  }
+
+  // nothing is configured: one worker per core, within max-workers if it is given
+  if (!info.number_workers && !info.min_workers){
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    info.number_workers = cores > 0 ? cores : 4;
+    if (info.max_workers){
+      info.number_workers = std::min(info.number_workers, info.max_workers);
+    }
+    std::cout << "Number workers set to: " << info.number_workers << std::endl;
+  }
+
+  // without bounds pool keeps number-workers, the one given is the start size
+  if (!info.number_workers){
+    info.number_workers = info.min_workers;
+  }
+  if (!info.min_workers){
+    info.min_workers = info.number_workers;
+  }
+  if (!info.max_workers){
+    info.max_workers = std::max(info.number_workers, info.min_workers);
+  }
+  if (info.max_workers < info.min_workers){
+    std::cerr << "\nWarning! Max workers is less than min workers, pool size is fixed to " << info.min_workers << ".\n";
+    info.max_workers = info.min_workers;
+  }
+  info.number_workers = std::min(std::max(info.number_workers, info.min_workers), info.max_workers);
+
+  if (info.warmup && !info.warmup_threads){
+    info.warmup_threads = sysconf(_SC_NPROCESSORS_ONLN) > 0 ? sysconf(_SC_NPROCESSORS_ONLN) : 4;
+  }
+
+  if (info.warmup && !info.cache_size){
+    std::cerr << "\nWarning! Warmup needs content cache, but cache size is 0. Warmup is disabled.\n";
+    info.warmup = false;
+  }
+
+  if (info.prefork_shared_cache && !info.prefork_processes){
+    std::cerr << "\nWarning! Prefork shared cache needs prefork processes. It is disabled.\n";
+    info.prefork_shared_cache = 0;
+  }
+
+  // names and root directories are checked by ParseVirtualHost
+  for (auto it = info.virtual_hosts.begin(); it != info.virtual_hosts.end(); ++it){
+    if (it->cache_size          == SIZE_MAX) it->cache_size          = info.cache_size;
+    if (it->cache_max_file_size == SIZE_MAX) it->cache_max_file_size = info.cache_max_file_size;
+    if (!it->http2_idle_timeout)             it->http2_idle_timeout  = info.http2_idle_timeout;
+  }
+
+  if (info.tls_port){
+    if (info.tls_certificate.empty() || info.tls_private_key.empty()){
+      std::cerr << "\nTLS port was set, but TLS certificate or private key was not parsed!\n";
+      must_exit = true;
+    }
+    if (info.tls_port == info.port){
+      std::cerr << "\nTLS port must differ from TCP port!\n";
+      must_exit = true;
+    }
   }
 
   if(must_exit){
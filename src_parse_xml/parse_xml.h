@@ -3,6 +3,9 @@
 #include <iostream>
 #include <fstream>
 #include <map>
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
 
 #include <unistd.h>
 #include <sys/stat.h>
@@ -12,6 +15,7 @@
 #include <arpa/inet.h>
 
 #include <config.h>
+#include <numa_topology.h>
 
 class ParseXmlConfig{
 
@@ -33,19 +37,149 @@ class ParseXmlConfig{
     void ParseIP        (parse_info & info);
     void ParsePort      (parse_info & info);
     void ParseRootPath  (parse_info & info);
+    void ParseBundlePath(parse_info & info);
     void ParseNumWorker (parse_info & info);
+    void ParseMinWorkers(parse_info & info);
+    void ParseMaxWorkers(parse_info & info);
+
+    void ParseTLSPort           (parse_info & info);
+    void ParseTLSCertificate    (parse_info & info);
+    void ParseTLSPrivateKey     (parse_info & info);
+    void ParseTLSSessionCache   (parse_info & info);
+    void ParseTLSSessionTimeout (parse_info & info);
+    void ParseTLSSessionTickets (parse_info & info);
+    void ParseTLSKernelOffload  (parse_info & info);
+
+    void ParseHTTP2             (parse_info & info);
+    void ParseHTTP2MaxStreams   (parse_info & info);
+    void ParseHTTP2IdleTimeout  (parse_info & info);
+    void ParseHTTP2MaxConnections(parse_info & info);
+
+    void ParseCacheSize         (parse_info & info);
+    void ParseCacheMaxFileSize  (parse_info & info);
+    void ParseWarmup            (parse_info & info);
+    void ParseWarmupThreads     (parse_info & info);
+    void ParseWarmupMaxFileSize (parse_info & info);
+    void ParseWarmupHotList     (parse_info & info);
+    void ParseWarmupReadyFile   (parse_info & info);
+
+    void ParseWorkerCPUs        (parse_info & info);
+    void ParseReactorCPUs       (parse_info & info);
+    void ParseNUMALocal         (parse_info & info);
+    void ParseIncomingCPU       (parse_info & info);
+    void ParseNUMAReport        (parse_info & info);
+
+    void ParseZerocopyThreshold (parse_info & info);
+
+    void ParsePreforkProcesses  (parse_info & info);
+    void ParsePreforkSharedCache(parse_info & info);
+
+    void ParseTraceSampleRate   (parse_info & info);
+    void ParseTraceRingSize     (parse_info & info);
+    void ParseTraceEndpoint     (parse_info & info);
+
+    void ParseCaptureFile       (parse_info & info);
+
+    void ParseListenBacklog     (parse_info & info);
+    void ParseDeferAccept       (parse_info & info);
+    void ParseTCPFastOpen       (parse_info & info);
+    void ParseTCPNoDelay        (parse_info & info);
+    void ParseTCPCork           (parse_info & info);
+    void ParseSendBuffer        (parse_info & info);
+    void ParseReceiveBuffer     (parse_info & info);
+    void ParseAcceptBatch       (parse_info & info);
+
+    void ParseIndexFile         (parse_info & info);
+    void ParseAutoindex         (parse_info & info);
+    void ParseAutoindexPageSize (parse_info & info);
+
+    void ParseVirtualHost       (parse_info & info);
+    void ParseHostName          (parse_info & info);
+
+    std::vector<std::string>    host_names;   // of virtual host which is being parsed
 
     std::map<std::string, MFP> xml_fields =
                                         {
                                           {"IP-address",      & ParseXmlConfig::ParseIP         },
                                           {"TCP-port",        & ParseXmlConfig::ParsePort       },
                                           {"root-path",       & ParseXmlConfig::ParseRootPath   },
+                                          {"bundle-path",     & ParseXmlConfig::ParseBundlePath },
                                           {"number-workers",  & ParseXmlConfig::ParseNumWorker  },
+                                          {"min-workers",     & ParseXmlConfig::ParseMinWorkers },
+                                          {"max-workers",     & ParseXmlConfig::ParseMaxWorkers },
+
+                                          {"TLS-port",            & ParseXmlConfig::ParseTLSPort           },
+                                          {"TLS-certificate",     & ParseXmlConfig::ParseTLSCertificate    },
+                                          {"TLS-private-key",     & ParseXmlConfig::ParseTLSPrivateKey     },
+                                          {"TLS-session-cache",   & ParseXmlConfig::ParseTLSSessionCache   },
+                                          {"TLS-session-timeout", & ParseXmlConfig::ParseTLSSessionTimeout },
+                                          {"TLS-session-tickets", & ParseXmlConfig::ParseTLSSessionTickets },
+                                          {"TLS-kernel-offload",  & ParseXmlConfig::ParseTLSKernelOffload  },
+
+                                          {"HTTP2",               & ParseXmlConfig::ParseHTTP2             },
+                                          {"HTTP2-max-streams",   & ParseXmlConfig::ParseHTTP2MaxStreams   },
+                                          {"HTTP2-idle-timeout",  & ParseXmlConfig::ParseHTTP2IdleTimeout  },
+                                          {"HTTP2-max-connections", & ParseXmlConfig::ParseHTTP2MaxConnections },
+
+                                          {"cache-size",            & ParseXmlConfig::ParseCacheSize         },
+                                          {"cache-max-file-size",   & ParseXmlConfig::ParseCacheMaxFileSize  },
+                                          {"warmup",                & ParseXmlConfig::ParseWarmup            },
+                                          {"warmup-threads",        & ParseXmlConfig::ParseWarmupThreads     },
+                                          {"warmup-max-file-size",  & ParseXmlConfig::ParseWarmupMaxFileSize },
+                                          {"warmup-hot-list",       & ParseXmlConfig::ParseWarmupHotList     },
+                                          {"warmup-ready-file",     & ParseXmlConfig::ParseWarmupReadyFile   },
+
+                                          {"worker-cpus",           & ParseXmlConfig::ParseWorkerCPUs        },
+                                          {"reactor-cpus",          & ParseXmlConfig::ParseReactorCPUs       },
+                                          {"numa-local",            & ParseXmlConfig::ParseNUMALocal         },
+                                          {"incoming-cpu",          & ParseXmlConfig::ParseIncomingCPU       },
+                                          {"numa-report",           & ParseXmlConfig::ParseNUMAReport        },
+
+                                          {"zerocopy-threshold",    & ParseXmlConfig::ParseZerocopyThreshold },
+
+                                          {"prefork-processes",     & ParseXmlConfig::ParsePreforkProcesses  },
+                                          {"prefork-shared-cache",  & ParseXmlConfig::ParsePreforkSharedCache},
+
+                                          {"trace-sample-rate",     & ParseXmlConfig::ParseTraceSampleRate   },
+                                          {"trace-ring-size",       & ParseXmlConfig::ParseTraceRingSize     },
+                                          {"trace-endpoint",        & ParseXmlConfig::ParseTraceEndpoint     },
+
+                                          {"capture-file",          & ParseXmlConfig::ParseCaptureFile       },
+
+                                          {"listen-backlog",        & ParseXmlConfig::ParseListenBacklog     },
+                                          {"defer-accept",          & ParseXmlConfig::ParseDeferAccept       },
+                                          {"TCP-fastopen",          & ParseXmlConfig::ParseTCPFastOpen       },
+                                          {"TCP-nodelay",           & ParseXmlConfig::ParseTCPNoDelay        },
+                                          {"TCP-cork",              & ParseXmlConfig::ParseTCPCork           },
+                                          {"send-buffer",           & ParseXmlConfig::ParseSendBuffer        },
+                                          {"receive-buffer",        & ParseXmlConfig::ParseReceiveBuffer     },
+                                          {"accept-batch",          & ParseXmlConfig::ParseAcceptBatch       },
+
+                                          {"index-file",            & ParseXmlConfig::ParseIndexFile         },
+                                          {"autoindex",             & ParseXmlConfig::ParseAutoindex         },
+                                          {"autoindex-page-size",   & ParseXmlConfig::ParseAutoindexPageSize },
+
+                                          {"virtual-host",          & ParseXmlConfig::ParseVirtualHost       },
+                                        };
+
+    // fields of <virtual-host>, they are parsed into scope of this host
+    std::map<std::string, MFP> host_fields =
+                                        {
+                                          {"name",                  & ParseXmlConfig::ParseHostName          },
+                                          {"alias",                 & ParseXmlConfig::ParseHostName          },
+                                          {"root-path",             & ParseXmlConfig::ParseRootPath          },
+                                          {"cache-size",            & ParseXmlConfig::ParseCacheSize         },
+                                          {"cache-max-file-size",   & ParseXmlConfig::ParseCacheMaxFileSize  },
+                                          {"HTTP2-idle-timeout",    & ParseXmlConfig::ParseHTTP2IdleTimeout  },
                                         };
 
     inline bool is_ipv4_address(const char * address);
     inline bool is_ipv6_address(const char * address);
 
+    inline bool is_switch_on   (const char * value);
+    inline bool is_readable    (const char * pathname);
+    inline bool parse_size     (const char * value, std::size_t & size);
+
     inline void check_info(parse_info & info);
 
   public:
@@ -0,0 +1,189 @@
+#include <server_policies.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include <config.h>
+
+// Epoll_Events hands poll flags to epoll as they are
+static_assert(EPOLLIN == POLLIN && EPOLLOUT == POLLOUT && EPOLLERR == POLLERR && EPOLLHUP == POLLHUP,
+              "epoll flags differ from poll flags");
+
+void Poll_Events::Add(int fd, short events){
+  pollfd tmp;
+  tmp.fd      = fd;
+  tmp.events  = events;
+  tmp.revents = 0;
+  fds.push_back(tmp);
+}
+
+void Poll_Events::Modify(int fd, short events){
+  for (auto it = fds.begin(); it != fds.end(); ++it){
+    if (it->fd == fd){
+      it->events = events;
+      return;
+    }
+  }
+}
+
+// array is not shifted under Ready: entry is only marked
+void Poll_Events::Remove(int fd){
+  for (auto it = fds.begin(); it != fds.end(); ++it){
+    if (it->fd == fd){
+      it->fd      = -1;
+      it->revents = 0;
+      return;
+    }
+  }
+}
+
+int Poll_Events::Wait(int timeout){
+  fds.erase(std::remove_if(fds.begin(), fds.end(), [](const pollfd & tmp){ return tmp.fd < 0; }), fds.end());
+  return poll(fds.data(), fds.size(), timeout);
+}
+
+void Poll_Events::Close(){
+  for (auto it = fds.begin(); it != fds.end(); ++it){
+    if (it->fd != -1) close(it->fd);
+  }
+  fds.clear();
+}
+
+bool Poll_Events::Readable(int fd){
+  pollfd tmp;
+  tmp.fd      = fd;
+  tmp.events  = POLLIN;
+  tmp.revents = 0;
+  return poll(&tmp, 1, NO_BLOCKING_POLL) > 0;
+}
+
+Epoll_Events::Epoll_Events() : epoll_fd(-1), owner(0), count(0){
+}
+
+void Epoll_Events::Add(int fd, short events){
+  watched[fd] = events;
+  if (IsOwned()){
+    epoll_event event = {0};
+    event.events  = events;
+    event.data.fd = fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+  }
+}
+
+void Epoll_Events::Modify(int fd, short events){
+  auto it = watched.find(fd);
+  if (it == watched.end()){
+    return;
+  }
+  it->second = events;
+  if (IsOwned()){
+    epoll_event event = {0};
+    event.events  = events;
+    event.data.fd = fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &event);
+  }
+}
+
+// number of descriptor can be reused by accept under Ready, so its pending event goes too
+void Epoll_Events::Remove(int fd){
+  if (!watched.erase(fd)){
+    return;
+  }
+  if (IsOwned()){
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+  }
+  for (int i = 0; i < count; ++i){
+    if (ready[i].data.fd == fd) ready[i].data.fd = -1;
+  }
+}
+
+int Epoll_Events::Wait(int timeout){
+  count = 0;
+  if (!IsOwned()){
+    // descriptor of master is shared with worker processes, each of them needs its own set
+    if (epoll_fd >= 0) close(epoll_fd);
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0){
+      return -1;
+    }
+    owner = getpid();
+
+    for (auto it = watched.begin(); it != watched.end(); ++it){
+      epoll_event event = {0};
+      event.events  = it->second;
+      event.data.fd = it->first;
+      epoll_ctl(epoll_fd, EPOLL_CTL_ADD, it->first, &event);
+    }
+  }
+
+  int rc = epoll_wait(epoll_fd, ready, EPOLL_EVENTS_BATCH, timeout);
+  count  = rc > 0 ? rc : 0;
+  return rc;
+}
+
+void Epoll_Events::Close(){
+  for (auto it = watched.begin(); it != watched.end(); ++it){
+    close(it->first);
+  }
+  watched.clear();
+  count = 0;
+
+  if (epoll_fd >= 0) close(epoll_fd);
+  epoll_fd = -1;
+}
+
+Epoll_Events::~Epoll_Events(){
+  if (epoll_fd >= 0) close(epoll_fd);
+}
+
+int Sendfile_Files::Open(const char * filename, off_t & size){
+  int fd = open(filename, O_RDONLY | O_CLOEXEC);
+  if (fd < 0){
+    return -1;
+  }
+
+  struct stat _stat = {0};
+  if (fstat(fd, &_stat) < 0){
+    close(fd);
+    return -1;
+  }
+
+  size = _stat.st_size;
+  return fd;
+}
+
+void Sendfile_Files::Attach(int fd, off_t size, Response_Chain & dst, bool can_sendfile){
+  // zero-copy: body is sent by worker straight from the file
+  if (can_sendfile){
+    dst.AddFile(fd, 0, size);
+    return;
+  }
+
+  uint8_t * body = size > 0 ? dst.Extend(size) : nullptr;
+  off_t     done = 0;
+  while (done < size){
+    ssize_t rc = pread(fd, body + done, size - done, done);
+    if (rc < 0 && errno == EINTR) continue;
+    if (rc <= 0) break;
+    done += rc;
+  }
+  // file was truncated: the rest of promised length is zeros
+  if (done < size){
+    std::fill(body + done, body + size, 0);
+  }
+  close(fd);
+}
+
+void Console_Logger::Error(const char * what, const char * detail){
+  std::cerr << "\n\033[1;31mError!!! " << what << " \033[0m";
+  if (detail){
+    std::cerr << "\033[1;35m" << detail << "\033[0m";
+  }
+  std::cerr << "\n";
+}
+
+void Console_Logger::Warning(const char * what){
+  std::cerr << "\n\033[1;35mWarning!!! " << what << "\033[0m\n\n";
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <iostream>
+#include <queue>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+
+#include <unistd.h>
+#include <sys/poll.h>
+#include <sys/epoll.h>
+#include <sys/types.h>
+
+#include <request_arena.h>
+#include <response_chain.h>
+
+// Building blocks of Basic_HTTP_Server, chosen at compile time. Every policy
+// is a plain class without virtual functions, so calls are inlined into the
+// event loop and workers of the chosen variant:
+//
+//  events      set of descriptors of event loop, flags are the ones of poll:
+//              Add(fd, events), Modify(fd, events), Remove(fd), Wait(timeout),
+//              Ready(f) calls f(fd, revents) for ready ones until f returns false,
+//              Close() closes every descriptor of set; static Readable(fd) does not wait
+//  scheduler   template over task: Push(task), Pop() blocks, Drain(f) calls f for queued ones
+//  allocator   std::pmr::memory_resource with ctor(size), Reset(), Overflows()
+//  files       static int Open(filename, off_t & size), static void Attach(fd, size, dst, can_sendfile)
+//  logger      static void Error(what, detail), static void Warning(what)
+//
+// Default_Policies is the set server always had: poll, FIFO under condition
+// variable, bump arena, sendfile for bodies and colored messages to stderr.
+// Epoll_Policies differs by events only (cmake -DWITH_EPOLL=ON).
+
+#define EPOLL_EVENTS_BATCH (256)  //ready descriptors taken by one epoll_wait
+
+// event backend: pollfd array passed to poll on every Wait
+class Poll_Events{
+
+    std::vector<pollfd>         fds;      // removed ones are -1 until the next Wait
+
+  public:
+
+    void  Add     (int fd, short events);
+    void  Modify  (int fd, short events);
+    // ready event of `fd` which is not reported yet is dropped
+    void  Remove  (int fd);
+    // number of ready descriptors, -1 - errno is set
+    int   Wait    (int timeout);
+    void  Close   ();
+
+    // descriptors added by `f` are not visited: they are not polled yet
+    template <class F>
+    void Ready(F f){
+      for (std::size_t i = 0, count = fds.size(); i < count; ++i){
+        if (fds[i].fd < 0 || fds[i].revents == 0 || fds[i].revents == POLLNVAL){
+          continue;
+        }
+        if (!f(fds[i].fd, fds[i].revents)){
+          return;
+        }
+      }
+    }
+
+    static bool Readable(int fd);
+};
+
+// event backend: kernel keeps the set, Wait returns only ready descriptors.
+// Set is created by the process which waits on it, so worker processes of
+// prefork build their own from the descriptors inherited from master.
+class Epoll_Events{
+
+    std::unordered_map<int, short>  watched;
+    int                             epoll_fd;
+    pid_t                           owner;
+    epoll_event                     ready[EPOLL_EVENTS_BATCH];
+    int                             count;      // of `ready`, removed ones are -1
+
+    inline bool   IsOwned   () const { return epoll_fd >= 0 && owner == getpid(); }
+
+  public:
+
+    Epoll_Events();
+    Epoll_Events(const Epoll_Events &) = delete;
+    Epoll_Events & operator = (const Epoll_Events &) = delete;
+
+    void  Add     (int fd, short events);
+    void  Modify  (int fd, short events);
+    void  Remove  (int fd);
+    int   Wait    (int timeout);
+    void  Close   ();
+
+    template <class F>
+    void Ready(F f){
+      for (int i = 0; i < count; ++i){
+        if (ready[i].data.fd < 0){
+          continue;
+        }
+        if (!f(ready[i].data.fd, static_cast<short>(ready[i].events))){
+          return;
+        }
+      }
+    }
+
+    static bool Readable(int fd) { return Poll_Events::Readable(fd); }
+
+    ~Epoll_Events();
+};
+
+// scheduler: FIFO of tasks, workers sleep on condition variable while it is empty
+template <class Task>
+class Condvar_Queue{
+
+    std::mutex                  mtx;
+    std::condition_variable     cv;
+    std::queue<Task>            tasks;
+
+  public:
+
+    void Push(const Task & task){
+      std::unique_lock<std::mutex> lk(mtx);
+      tasks.push(task);
+      lk.unlock();
+      cv.notify_one();
+    }
+
+    Task Pop(){
+      std::unique_lock<std::mutex> lk(mtx);
+      cv.wait(lk, [this]{return tasks.size();});
+      Task task = tasks.front();
+      tasks.pop();
+      return task;
+    }
+
+    // queue is emptied under lock, `drop` is called without it
+    template <class F>
+    void Drain(F drop){
+      std::unique_lock<std::mutex> lk(mtx);
+      std::queue<Task> empty;
+      std::swap(tasks, empty);
+      lk.unlock();
+
+      while (empty.size()){
+        drop(empty.front());
+        empty.pop();
+      }
+    }
+};
+
+// file-serving: body goes by sendfile when connection allows it, otherwise it is copied into respond
+struct Sendfile_Files{
+  // descriptor of file and its size, -1 - file cannot be opened
+  static int  Open   (const char * filename, off_t & size);
+  // takes `fd`: it is closed by respond or at once if body is copied
+  static void Attach (int fd, off_t size, Response_Chain & dst, bool can_sendfile);
+};
+
+struct Console_Logger{
+  static void Error   (const char * what, const char * detail = nullptr);
+  static void Warning (const char * what);
+};
+
+struct Default_Policies{
+  typedef Poll_Events                         events;
+  template <class Task> using scheduler     = Condvar_Queue<Task>;
+  typedef Request_Arena                       allocator;
+  typedef Sendfile_Files                      files;
+  typedef Console_Logger                      logger;
+};
+
+struct Epoll_Policies : Default_Policies{
+  typedef Epoll_Events                        events;
+};
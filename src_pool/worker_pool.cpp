@@ -0,0 +1,48 @@
+#include <worker_pool.h>
+
+#include <algorithm>
+#include <time.h>
+
+Pool_Governor::Pool_Governor(std::size_t _min, std::size_t _max) :
+  min(_min), max(std::max(_min, _max)), overloaded(0), idle(0), wait_us(0), busy(0), io(0){
+}
+
+std::uint64_t Pool_Governor::Now(){
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+std::size_t Pool_Governor::Decide(const pool_sample & sample){
+  std::uint64_t capacity_ns = sample.interval_ns * std::max<std::size_t>(sample.active, 1);
+
+  wait_us = sample.dequeued ? sample.queue_wait_ns / 1000.0 / sample.dequeued : 0;
+  busy    = capacity_ns     ? 100.0 * sample.busy_ns / capacity_ns : 0;
+  io      = sample.busy_ns  ? 100.0 * sample.io_wait_ns / sample.busy_ns : 0;
+
+  bool is_overloaded = wait_us > POOL_GROW_WAIT_US || busy > POOL_GROW_BUSY;
+  bool is_idle       = wait_us < POOL_SHRINK_WAIT_US && busy < POOL_SHRINK_BUSY;
+
+  overloaded = is_overloaded ? overloaded + 1 : 0;
+  idle       = is_idle       ? idle + 1       : 0;
+
+  std::size_t active = std::min(std::max(sample.active, min), max);
+
+  // workers blocked on disk do not use cpu, so more of them are needed at once
+  if (overloaded >= POOL_GROW_INTERVALS && active < max){
+    overloaded = 0;
+    return std::min(max, active + std::max<std::size_t>(1, active / (io > POOL_IO_HEAVY ? 2 : 4)));
+  }
+
+  // one by one: load which comes back does not wait for the whole pool again
+  if (idle >= POOL_SHRINK_INTERVALS && active > min){
+    idle = 0;
+    return active - 1;
+  }
+  return active;
+}
+
+void Pool_Governor::Print(std::size_t active) const{
+  std::cout << "workers: " << active << " (" << min << ".." << max << "), queue wait us: " << wait_us
+            << ", busy: " << busy << "%, waiting for disk: " << io << "% of busy" << std::endl;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <iostream>
+#include <cstdint>
+
+#define POOL_INTERVAL_MS        (1000)  //load of workers is sampled this often
+#define POOL_GROW_WAIT_US       (2000)  //mean time in task queue above it is overload
+#define POOL_SHRINK_WAIT_US     (200)   //and below it with low utilization is idleness
+#define POOL_GROW_BUSY          (85)    //% of time workers serve connections, overload
+#define POOL_SHRINK_BUSY        (30)    //idleness
+#define POOL_GROW_INTERVALS     (2)     //pool grows after that many overloaded intervals in a row
+#define POOL_SHRINK_INTERVALS   (10)    //and shrinks after that many idle ones
+#define POOL_IO_HEAVY           (50)    //% of busy time spent on disk: pool grows twice faster
+
+// load of workers during one interval of Pool_Governor
+struct pool_sample{
+  std::size_t       active;         // running workers
+  std::uint64_t     interval_ns;
+  std::uint64_t     dequeued;       // connections taken from task queues
+  std::uint64_t     queue_wait_ns;  // time they waited there
+  std::uint64_t     busy_ns;        // time workers served connections
+  std::uint64_t     io_wait_ns;     // part of busy time spent in filesystem calls
+};
+
+// Decides number of workers between min and max. Thresholds of growth and
+// shrink differ and must hold for several intervals in a row, so pool does
+// not flap around one load level.
+class Pool_Governor{
+
+    std::size_t       min;
+    std::size_t       max;
+    std::size_t       overloaded;   // intervals in a row
+    std::size_t       idle;
+
+    double            wait_us;      // of the last interval, for report
+    double            busy;
+    double            io;
+
+  public:
+
+    Pool_Governor(std::size_t _min, std::size_t _max);
+
+    // number of workers for the next interval
+    std::size_t   Decide  (const pool_sample & sample);
+    void          Print   (std::size_t active) const;
+
+    static std::uint64_t Now ();  // monotonic, ns
+};
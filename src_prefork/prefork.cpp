@@ -0,0 +1,45 @@
+#include <prefork.h>
+
+#include <cstdio>
+#include <new>
+
+Prefork_Stats::Prefork_Stats(std::size_t _count) : slots(nullptr), count(_count){
+  void * map = mmap(nullptr, count * sizeof(prefork_slot), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (map == MAP_FAILED){
+    std::perror("\nError!!! Cannot map prefork statistics ");
+    return;
+  }
+
+  slots = static_cast<prefork_slot *>(map);
+  for (std::size_t i = 0; i < count; ++i){
+    new (slots + i) prefork_slot();
+  }
+}
+
+Prefork_Stats::~Prefork_Stats(){
+  if (slots){
+    munmap(slots, count * sizeof(prefork_slot));
+  }
+}
+
+void Prefork_Stats::Print(std::ostream & out) const{
+  std::uint64_t requests = 0, http2_connections = 0, send_errors = 0, shared_cache_hits = 0, restarts = 0;
+
+  out << "\n\033[1;37mPrefork report (" << count << " workers):\033[0m\n"
+      << "worker\tpid\trestarts\trequests\th2 conns\tsend errors\tshared cache hits\n";
+
+  for (std::size_t i = 0; i < count; ++i){
+    const prefork_slot & slot = slots[i];
+    out << i << '\t' << slot.pid << '\t' << slot.restarts << "\t\t" << slot.requests << "\t\t" << slot.http2_connections
+        << "\t\t" << slot.send_errors << "\t\t" << slot.shared_cache_hits << '\n';
+
+    requests          += slot.requests;
+    http2_connections += slot.http2_connections;
+    send_errors       += slot.send_errors;
+    shared_cache_hits += slot.shared_cache_hits;
+    restarts          += slot.restarts;
+  }
+
+  out << "total: " << requests << " requests, " << http2_connections << " h2 connections, " << send_errors
+      << " send errors, " << shared_cache_hits << " shared cache hits, " << restarts << " restarts" << std::endl;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <iostream>
+#include <atomic>
+#include <cstdint>
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+
+// counters of one worker process, written by it and read by master
+struct prefork_slot{
+    std::atomic<pid_t>          pid;
+    std::atomic<std::uint32_t>  restarts;
+    std::atomic<std::uint64_t>  requests;
+    std::atomic<std::uint64_t>  http2_connections;
+    std::atomic<std::uint64_t>  send_errors;
+    std::atomic<std::uint64_t>  shared_cache_hits;
+};
+
+// Slots of worker processes in anonymous shared mapping: master creates it
+// before fork, so every worker and restarted worker sees the same pages.
+class Prefork_Stats{
+
+    prefork_slot *  slots;
+    std::size_t     count;
+
+  public:
+
+    Prefork_Stats() = delete;
+    Prefork_Stats(const Prefork_Stats &) = delete;
+    explicit Prefork_Stats(std::size_t _count);
+
+    bool            IsOpen  () const { return slots != nullptr; }
+    std::size_t     Count   () const { return count; }
+    prefork_slot &  Slot    (std::size_t i) { return slots[i]; }
+
+    void            Print   (std::ostream & out) const;
+
+    ~Prefork_Stats();
+};
@@ -0,0 +1,336 @@
+#include <response_chain.h>
+
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <sys/sendfile.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+
+#include <socket_options.h>
+
+#ifdef HTTP_SERVER_WITH_TLS
+#include <openssl/ssl.h>
+#endif
+
+#define CHAIN_MAX_IOV (64)  //segments gathered by one sendmsg
+
+Response_Chain::Response_Chain(std::pmr::memory_resource * resource, std::size_t _zerocopy_threshold) :
+  bytes(resource), segments(resource), owners(resource), current(0), sent(0),
+  zerocopy_threshold(_zerocopy_threshold), zerocopy_sent(0), zerocopy_completed(0), coalesce(false){
+}
+
+Response_Chain::Response_Chain(Response_Chain & other, std::pmr::memory_resource * resource) :
+  Response_Chain(resource, other.zerocopy_threshold){
+  sent               = other.sent;
+  coalesce           = other.coalesce;
+  zerocopy_sent      = other.zerocopy_sent;
+  zerocopy_completed = other.zerocopy_completed;
+  owners.assign(other.owners.begin(), other.owners.end());
+
+  for (std::size_t i = other.current; i < other.segments.size(); ++i){
+    segment seg = other.segments[i];
+    if (seg.type == segment::BYTES){
+      std::size_t offset = bytes.size();
+      bytes.insert(bytes.end(), other.bytes.begin() + seg.offset, other.bytes.begin() + seg.offset + seg.size);
+      seg.offset = offset;
+    }
+    segments.push_back(seg);
+  }
+
+  // files of sent segments are closed with `other`, the rest belongs to this chain
+  for (std::size_t i = other.current; i < other.segments.size(); ++i){
+    other.segments[i].fd = -1;
+  }
+}
+
+Response_Chain::~Response_Chain(){
+  for (auto it = segments.begin(); it != segments.end(); ++it){
+    if (it->type == segment::FILE && it->fd != -1){
+      close(it->fd);
+    }
+  }
+}
+
+void Response_Chain::Append(const void * data, std::size_t size){
+  const uint8_t * src = static_cast<const uint8_t *>(data);
+  std::memcpy(Extend(size), src, size);
+}
+
+uint8_t * Response_Chain::Extend(std::size_t size){
+  std::size_t offset = bytes.size();
+  bytes.resize(offset + size);
+
+  // continuation of the last bytes is the same segment
+  if (segments.size() > current && segments.back().type == segment::BYTES &&
+      segments.back().offset + segments.back().size == offset){
+    segments.back().size += size;
+  }
+  else{
+    segments.push_back(segment{segment::BYTES, nullptr, offset, size, -1});
+  }
+  return bytes.data() + offset;
+}
+
+void Response_Chain::AddStatic(const void * data, std::size_t size){
+  if (size){
+    segments.push_back(segment{segment::MEMORY, static_cast<const uint8_t *>(data), 0, size, -1});
+  }
+}
+
+void Response_Chain::AddShared(const void * data, std::size_t size, std::shared_ptr<const void> owner){
+  owners.push_back(std::move(owner));
+  AddStatic(data, size);
+}
+
+void Response_Chain::AddFile(int fd, off_t offset, off_t size){
+  segments.push_back(segment{segment::FILE, nullptr, static_cast<std::size_t>(offset), static_cast<std::size_t>(size), fd});
+}
+
+std::size_t Response_Chain::Size() const{
+  std::size_t size = 0;
+  for (std::size_t i = current; i < segments.size(); ++i){
+    size += segments[i].size;
+  }
+  return size;
+}
+
+bool Response_Chain::HasFile() const{
+  for (std::size_t i = current; i < segments.size(); ++i){
+    if (segments[i].type == segment::FILE) return true;
+  }
+  return false;
+}
+
+const uint8_t * Response_Chain::DataOf(const segment & seg) const{
+  return seg.type == segment::BYTES ? bytes.data() + seg.offset : seg.data;
+}
+
+void Response_Chain::Advance(std::size_t size){
+  sent += size;
+  while (size && current < segments.size()){
+    segment &   seg  = segments[current];
+    std::size_t part = std::min(size, seg.size);
+
+    if (seg.type == segment::MEMORY) seg.data   += part;
+    else                             seg.offset += part;
+
+    seg.size -= part;
+    size     -= part;
+
+    if (!seg.size) ++current;
+  }
+
+  // empty segments are skipped too
+  while (current < segments.size() && !segments[current].size) ++current;
+}
+
+// only memory which is owned by refcount or outlives the chain: bytes of
+// arena may be overwritten by the next request before kernel sends them
+bool Response_Chain::IsZerocopy(const segment & seg) const{
+  return zerocopy_threshold && seg.type == segment::MEMORY && seg.size >= zerocopy_threshold;
+}
+
+bool Response_Chain::EnableZerocopy(int fd){
+  if (zerocopy_sent){
+    return true;
+  }
+  int one = 1;
+  return setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0;
+}
+
+// completions come by error queue of socket as ranges of sendmsg calls
+bool Response_Chain::ReapZerocopy(int fd){
+  while (zerocopy_completed != zerocopy_sent){
+    char    control[128];
+    msghdr  msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_control    = control;
+    msg.msg_controllen = sizeof(control);
+
+    if (recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0){
+      return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    }
+
+    for (cmsghdr * cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)){
+      if ((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) || (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)){
+        const sock_extended_err * err = reinterpret_cast<const sock_extended_err *>(CMSG_DATA(cm));
+        if (err->ee_origin == SO_EE_ORIGIN_ZEROCOPY){
+          zerocopy_completed += err->ee_data - err->ee_info + 1;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+Response_Chain::flush_result Response_Chain::Flush(int fd, ssl_st * ssl){
+#ifdef HTTP_SERVER_WITH_TLS
+  // every SSL_write is a record in its own segments, cork holds them until the chain is written
+  if (ssl){
+    if (!coalesce){
+      return FlushTLS(ssl);
+    }
+    Socket_Options::Cork(fd);
+    flush_result result = FlushTLS(ssl);
+    Socket_Options::Uncork(fd);
+    return result;
+  }
+#endif
+  return FlushPlain(fd);
+}
+
+Response_Chain::flush_result Response_Chain::FlushPlain(int fd){
+  while (current < segments.size()){
+    segment & seg = segments[current];
+
+    if (seg.type == segment::FILE){
+      off_t   offset = seg.offset;
+      ssize_t rc     = sendfile(fd, seg.fd, &offset, seg.size);
+      if (rc < 0){
+        if (errno == EINTR) continue;
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? FLUSH_AGAIN : FLUSH_ERROR;
+      }
+      if (rc == 0){
+        return FLUSH_ERROR; // file was truncated
+      }
+      Advance(rc);
+      continue;
+    }
+
+    // big shared body alone by MSG_ZEROCOPY, everything else is gathered up to it
+    bool   zerocopy = IsZerocopy(seg) && EnableZerocopy(fd);
+    iovec  iov[CHAIN_MAX_IOV];
+    int    count = 0;
+
+    for (std::size_t i = current; i < segments.size() && count < CHAIN_MAX_IOV; ++i){
+      const segment & cur = segments[i];
+      if (cur.type == segment::FILE || (count && (zerocopy || IsZerocopy(cur)))){
+        break;
+      }
+      iov[count].iov_base = const_cast<uint8_t *>(DataOf(cur));
+      iov[count].iov_len  = cur.size;
+      ++count;
+    }
+
+    msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov    = iov;
+    msg.msg_iovlen = count;
+
+    // header waits for the body which follows it, the last segment pushes everything
+    bool    more = coalesce && current + count < segments.size();
+    ssize_t rc   = sendmsg(fd, &msg, MSG_NOSIGNAL | (zerocopy ? MSG_ZEROCOPY : 0) | (more ? MSG_MORE : 0));
+    if (rc < 0){
+      if (errno == EINTR) continue;
+      if (errno == ENOBUFS && zerocopy){
+        zerocopy_threshold = 0; // optmem limit is reached, the rest is copied
+        continue;
+      }
+      return (errno == EAGAIN || errno == EWOULDBLOCK) ? FLUSH_AGAIN : FLUSH_ERROR;
+    }
+
+    if (zerocopy && rc > 0){
+      ++zerocopy_sent;
+    }
+    Advance(rc);
+  }
+
+  if (!ReapZerocopy(fd)){
+    return FLUSH_ERROR;
+  }
+  return zerocopy_completed == zerocopy_sent ? FLUSH_DONE : FLUSH_AGAIN;
+}
+
+#ifdef HTTP_SERVER_WITH_TLS
+Response_Chain::flush_result Response_Chain::FlushTLS(ssl_st * ssl){
+  while (current < segments.size()){
+    segment & seg = segments[current];
+
+    int rc;
+    if (seg.type == segment::FILE){
+      ossl_ssize_t sent = SSL_sendfile(ssl, seg.fd, seg.offset, seg.size, 0);
+      rc = sent > 0 ? static_cast<int>(sent) : -1;
+    }
+    else{
+      rc = SSL_write(ssl, DataOf(seg), seg.size);
+    }
+
+    if (rc <= 0){
+      int error = SSL_get_error(ssl, rc);
+      return (error == SSL_ERROR_WANT_WRITE || error == SSL_ERROR_WANT_READ) ? FLUSH_AGAIN : FLUSH_ERROR;
+    }
+    Advance(rc);
+  }
+  return FLUSH_DONE;
+}
+#endif
+
+void Response_Chain::CopyTo(std::vector<uint8_t> & dst) const{
+  for (std::size_t i = current; i < segments.size(); ++i){
+    const segment & seg = segments[i];
+
+    if (seg.type != segment::FILE){
+      dst.insert(dst.end(), DataOf(seg), DataOf(seg) + seg.size);
+      continue;
+    }
+
+    std::size_t begin = dst.size();
+    dst.resize(begin + seg.size);
+    ssize_t rc = pread(seg.fd, dst.data() + begin, seg.size, seg.offset);
+    dst.resize(begin + (rc > 0 ? rc : 0));
+  }
+}
+
+void Response_Chain::Skip(std::size_t size){
+  Advance(size);
+}
+
+// less than `size` - chain is over or file is shorter than its segment
+std::size_t Response_Chain::Read(void * dst, std::size_t size){
+  uint8_t *   out    = static_cast<uint8_t *>(dst);
+  std::size_t copied = 0;
+
+  while (copied < size && current < segments.size()){
+    const segment & seg  = segments[current];
+    std::size_t     part = std::min(size - copied, seg.size);
+
+    if (seg.type != segment::FILE){
+      std::memcpy(out + copied, DataOf(seg), part);
+    }
+    else{
+      ssize_t rc;
+      do{
+        rc = pread(seg.fd, out + copied, part, seg.offset);
+      } while (rc < 0 && errno == EINTR);
+      if (rc <= 0){
+        break;
+      }
+      part = rc;
+    }
+
+    copied += part;
+    Advance(part);
+  }
+  return copied;
+}
+
+std::size_t Response_Chain::Peek(void * dst, std::size_t size) const{
+  uint8_t *   out    = static_cast<uint8_t *>(dst);
+  std::size_t copied = 0;
+
+  for (std::size_t i = current; i < segments.size() && copied < size; ++i){
+    const segment & seg = segments[i];
+    if (seg.type == segment::FILE){
+      break;
+    }
+    std::size_t part = std::min(size - copied, seg.size);
+    std::memcpy(out + copied, DataOf(seg), part);
+    copied += part;
+  }
+  return copied;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <memory_resource>
+#include <cstdint>
+
+#include <unistd.h>
+#include <sys/types.h>
+
+#include <request_arena.h>
+
+struct ssl_st;
+
+// Respond as a chain of segments: bytes built for this request, static
+// slices and bodies shared by refcount (cache, bundle) and ranges of files.
+// Flush sends as much as non-blocking socket accepts by writev-like sendmsg
+// and sendfile and remembers the position, so the rest is sent when event
+// loop reports that socket is writable again. Big shared bodies go by
+// MSG_ZEROCOPY, chain keeps them alive until kernel reports completion.
+class Response_Chain{
+
+  public:
+
+    enum flush_result{
+      FLUSH_DONE,     // everything is sent and released by kernel
+      FLUSH_AGAIN,    // socket is full or zero-copy completions are pending
+      FLUSH_ERROR
+    };
+
+  private:
+
+    struct segment{
+      enum segment_type{ BYTES, MEMORY, FILE } type;
+      const uint8_t * data;     // MEMORY
+      std::size_t     offset;   // BYTES: in `bytes`, FILE: in file
+      std::size_t     size;     // not sent yet
+      int             fd;       // FILE, owned by chain
+    };
+
+    byte_buffer                                     bytes;
+    std::pmr::vector<segment>                       segments;
+    std::pmr::vector<std::shared_ptr<const void>>   owners;
+    std::size_t                                     current;    // first segment which is not sent completely
+    std::size_t                                     sent;
+
+    std::size_t                                     zerocopy_threshold;   // 0 - no zero-copy
+    std::uint32_t                                   zerocopy_sent;        // sendmsg calls with MSG_ZEROCOPY
+    std::uint32_t                                   zerocopy_completed;
+    bool                                            coalesce;             // segments are not pushed until the last one
+
+    inline const uint8_t *  DataOf      (const segment & seg) const;
+    inline void             Advance     (std::size_t size);
+    inline bool             IsZerocopy  (const segment & seg) const;
+    inline bool             EnableZerocopy(int fd);
+    inline bool             ReapZerocopy(int fd);
+
+    inline flush_result     FlushPlain  (int fd);
+#ifdef HTTP_SERVER_WITH_TLS
+    inline flush_result     FlushTLS    (ssl_st * ssl);
+#endif
+
+  public:
+
+    Response_Chain() = delete;
+    Response_Chain(const Response_Chain &) = delete;
+    Response_Chain & operator = (const Response_Chain &) = delete;
+
+    explicit Response_Chain(std::pmr::memory_resource * resource, std::size_t _zerocopy_threshold = 0);
+
+    // takes the rest of `other` (files, owners, unsent bytes) into memory of `resource`,
+    // respond survives reset of arena while it waits in event loop
+    Response_Chain(Response_Chain & other, std::pmr::memory_resource * resource);
+
+    void          Append        (const void * data, std::size_t size);
+    void          Append        (std::string_view str) { Append(str.data(), str.size()); }
+    // `size` new bytes at the end, pointer is valid until the next Append
+    uint8_t *     Extend        (std::size_t size);
+
+    // memory which outlives the chain
+    void          AddStatic     (const void * data, std::size_t size);
+    void          AddStatic     (std::string_view str) { AddStatic(str.data(), str.size()); }
+    void          AddShared     (const void * data, std::size_t size, std::shared_ptr<const void> owner);
+    // chain closes `fd`
+    void          AddFile       (int fd, off_t offset, off_t size);
+
+    // small segments are sent in full packets: MSG_MORE on plain socket, TCP_CORK under TLS
+    void          Coalesce      (bool on) { coalesce = on; }
+
+    std::size_t   Size          () const;
+    std::size_t   Sent          () const { return sent; }
+    bool          HasFile       () const;
+    // only zero-copy completions are pending: socket is waited for POLLERR, not for POLLOUT
+    bool          WaitsCompletion() const { return current == segments.size() && zerocopy_completed != zerocopy_sent; }
+
+    void          CopyTo        (std::vector<uint8_t> & dst) const;
+    // up to `size` first bytes in memory (status line), file segments stop it
+    std::size_t   Peek          (void * dst, std::size_t size) const;
+    // takes next bytes as they were sent: `Read` copies them, files are read by parts
+    void          Skip          (std::size_t size);
+    std::size_t   Read          (void * dst, std::size_t size);
+    flush_result  Flush         (int fd, ssl_st * ssl);
+
+    ~Response_Chain();
+};
@@ -0,0 +1,77 @@
+#include <socket_options.h>
+
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+namespace {
+  bool SetOption(int fd, int level, int name, int value, const char * field){
+    if (setsockopt(fd, level, name, &value, sizeof(value)) == 0){
+      return true;
+    }
+    std::cerr << "\n\033[1;35mWarning!!! " << field << " cannot be applied: " << strerror(errno) << "\033[0m\n\n";
+    return false;
+  }
+}
+
+bool Socket_Options::TuneListener(int fd, const parse_info & info){
+  bool done = true;
+
+  // receive buffer bigger than 64K needs window scaling, which is negotiated in SYN: set before listen
+  if (info.send_buffer){
+    done &= SetOption(fd, SOL_SOCKET, SO_SNDBUF, info.send_buffer, "send-buffer");
+  }
+  if (info.receive_buffer){
+    done &= SetOption(fd, SOL_SOCKET, SO_RCVBUF, info.receive_buffer, "receive-buffer");
+  }
+  if (info.tcp_nodelay){
+    done &= SetOption(fd, IPPROTO_TCP, TCP_NODELAY, 1, "TCP-nodelay");
+  }
+  if (info.defer_accept){
+    done &= SetOption(fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, info.defer_accept, "defer-accept");
+  }
+  if (info.tcp_fastopen){
+    done &= SetOption(fd, IPPROTO_TCP, TCP_FASTOPEN, info.tcp_fastopen, "TCP-fastopen");
+  }
+  return done;
+}
+
+int Socket_Options::Accept(int listen_fd){
+  int fd;
+  do{
+    fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+  } while (fd < 0 && errno == EINTR);
+  return fd;
+}
+
+bool Socket_Options::IsLoopback(int fd){
+  sockaddr_storage addr;
+  socklen_t        len = sizeof(addr);
+  if (getpeername(fd, reinterpret_cast<sockaddr *>(&addr), &len) < 0){
+    return false;
+  }
+
+  if (addr.ss_family == AF_INET){
+    return (ntohl(reinterpret_cast<sockaddr_in *>(&addr)->sin_addr.s_addr) >> 24) == IN_LOOPBACKNET;
+  }
+  if (addr.ss_family == AF_INET6){
+    const in6_addr & ip = reinterpret_cast<sockaddr_in6 *>(&addr)->sin6_addr;
+    return IN6_IS_ADDR_LOOPBACK(&ip) || (IN6_IS_ADDR_V4MAPPED(&ip) && ip.s6_addr[12] == IN_LOOPBACKNET);
+  }
+  return false;
+}
+
+void Socket_Options::Cork(int fd){
+  int on = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_CORK, &on, sizeof(on));
+}
+
+void Socket_Options::Uncork(int fd){
+  int off = 0;
+  setsockopt(fd, IPPROTO_TCP, TCP_CORK, &off, sizeof(off));
+}
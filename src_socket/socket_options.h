@@ -0,0 +1,33 @@
+#pragma once
+
+#include <config.h>
+
+// Options of listening sockets. Accepted sockets inherit buffers and
+// TCP_NODELAY from listener, so they cost no syscalls per connection;
+// accept4 returns them with flags already set.
+//
+//  listen-backlog   queue of completed connections (kernel caps it by somaxconn)
+//  accept-batch     connections accepted by one wake up of event loop
+//  defer-accept     listener wakes up when request arrives, not after handshake
+//  TCP-fastopen     request comes in SYN, queue of pending Fast Open handshakes
+//  TCP-nodelay      last partial segment of respond is not delayed
+//  send-buffer      SO_SNDBUF/SO_RCVBUF of every connection, 0 - autotuning
+//  receive-buffer
+//  TCP-cork         is applied per respond by Response_Chain, not here
+class Socket_Options{
+
+  public:
+
+    // false - option which was set cannot be applied, the reason is printed
+    static bool   TuneListener  (int fd, const parse_info & info);
+
+    // accepted socket, non-blocking and close-on-exec; -1 - errno is set
+    static int    Accept        (int listen_fd);
+
+    // peer is 127.0.0.0/8 or ::1 (also as v4-mapped address)
+    static bool   IsLoopback    (int fd);
+
+    // header and body of respond leave in full segments: TCP_CORK is on until Uncork
+    static void   Cork          (int fd);
+    static void   Uncork        (int fd);
+};
@@ -0,0 +1,164 @@
+#include <tls.h>
+
+TLS_Context::TLS_Context(parse_info & info){
+  ctx = SSL_CTX_new(TLS_server_method());
+  if (!ctx){
+    PrintErrors("SSL_CTX_new");
+    exit(EXIT_FAILURE);
+  }
+
+  SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+
+  if (SSL_CTX_use_certificate_chain_file(ctx, info.tls_certificate.c_str()) != 1){
+    PrintErrors(("certificate " + info.tls_certificate).c_str());
+    exit(EXIT_FAILURE);
+  }
+
+  if (SSL_CTX_use_PrivateKey_file(ctx, info.tls_private_key.c_str(), SSL_FILETYPE_PEM) != 1){
+    PrintErrors(("private key " + info.tls_private_key).c_str());
+    exit(EXIT_FAILURE);
+  }
+
+  if (SSL_CTX_check_private_key(ctx) != 1){
+    PrintErrors("private key does not match the certificate");
+    exit(EXIT_FAILURE);
+  }
+
+  // session resumption: server side cache (session id) and stateless tickets
+  SSL_CTX_set_session_id_context(ctx, session_id_context, std::strlen(reinterpret_cast<const char *>(session_id_context)));
+  SSL_CTX_set_timeout(ctx, info.tls_session_timeout);
+
+  if (info.tls_session_cache){
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+    SSL_CTX_sess_set_cache_size(ctx, info.tls_session_cache);
+  }
+  else{
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+  }
+
+  if (!info.tls_session_tickets){
+    SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+  }
+
+  // worker may write response with several SSL_write calls, buffer can move between them
+  SSL_CTX_set_mode(ctx, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER | SSL_MODE_ENABLE_PARTIAL_WRITE);
+
+  if (info.http2){
+    SSL_CTX_set_alpn_select_cb(ctx, SelectALPN, nullptr);
+  }
+
+#ifdef SSL_OP_ENABLE_KTLS
+  if (info.tls_kernel_offload){
+    SSL_CTX_set_options(ctx, SSL_OP_ENABLE_KTLS);
+  }
+#else
+  if (info.tls_kernel_offload){
+    std::cerr << "\n\033[1;35mWarning!!! OpenSSL built without kTLS support, TLS kernel offload is ignored.\033[0m\n";
+  }
+#endif
+}
+
+SSL * TLS_Context::NewSession(int fd){
+  SSL * ssl = SSL_new(ctx);
+  if (!ssl){
+    PrintErrors("SSL_new");
+    return nullptr;
+  }
+
+  if (SSL_set_fd(ssl, fd) != 1){
+    PrintErrors("SSL_set_fd");
+    SSL_free(ssl);
+    return nullptr;
+  }
+
+  SSL_set_accept_state(ssl);
+  return ssl;
+}
+
+int TLS_Context::Handshake(SSL * ssl, short & events){
+  ERR_clear_error();
+
+  int rc = SSL_do_handshake(ssl);
+  if (rc == 1){
+    return 1;
+  }
+
+  switch(SSL_get_error(ssl, rc)){
+    case SSL_ERROR_WANT_READ:
+      events = POLLIN;
+      return 0;
+    case SSL_ERROR_WANT_WRITE:
+      events = POLLOUT;
+      return 0;
+    case SSL_ERROR_ZERO_RETURN:
+      return -1;
+    case SSL_ERROR_SYSCALL:
+      // client has gone in the middle of handshake, nothing to report
+      if (!ERR_peek_error() && (errno == 0 || errno == ECONNRESET || errno == EPIPE)){
+        return -1;
+      }
+      PrintErrors("handshake");
+      return -1;
+#ifdef SSL_R_UNEXPECTED_EOF_WHILE_READING
+    case SSL_ERROR_SSL:
+      // OpenSSL 3 reports closed connection as protocol error
+      if (ERR_GET_REASON(ERR_peek_error()) == SSL_R_UNEXPECTED_EOF_WHILE_READING){
+        ERR_clear_error();
+        return -1;
+      }
+      PrintErrors("handshake");
+      return -1;
+#endif
+    default:
+      PrintErrors("handshake");
+      return -1;
+  }
+}
+
+bool TLS_Context::IsKernelSend(SSL * ssl){
+#ifdef SSL_OP_ENABLE_KTLS
+  return BIO_get_ktls_send(SSL_get_wbio(ssl));
+#else
+  return false;
+#endif
+}
+
+bool TLS_Context::IsResumed(SSL * ssl){
+  return SSL_session_reused(ssl);
+}
+
+bool TLS_Context::IsHTTP2(SSL * ssl){
+  const unsigned char * proto;
+  unsigned int          len;
+
+  SSL_get0_alpn_selected(ssl, &proto, &len);
+  return len == 2 && !std::memcmp(proto, "h2", 2);
+}
+
+int TLS_Context::SelectALPN(SSL * ssl, const unsigned char ** out, unsigned char * outlen,
+                            const unsigned char * in, unsigned int inlen, void * arg){
+  // server preference: h2, then http/1.1
+  static const unsigned char protocols[] = "\x02h2\x08http/1.1";
+
+  if (SSL_select_next_proto(const_cast<unsigned char **>(out), outlen, protocols, sizeof(protocols) - 1, in, inlen) != OPENSSL_NPN_NEGOTIATED){
+    return SSL_TLSEXT_ERR_NOACK;
+  }
+  return SSL_TLSEXT_ERR_OK;
+}
+
+void TLS_Context::PrintErrors(const char * what){
+  std::cerr << "\n\033[1;31mError!!! TLS: " << what << "! \033[0m";
+
+  unsigned long err;
+  char          buf[256];
+  while ((err = ERR_get_error())){
+    ERR_error_string_n(err, buf, sizeof(buf));
+    std::cerr << "\033[1;35m" << buf << "\033[0m ";
+  }
+  std::cerr << "\n\n";
+}
+
+TLS_Context::~TLS_Context(){
+  if (ctx)
+    SSL_CTX_free(ctx);
+}
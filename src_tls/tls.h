@@ -0,0 +1,47 @@
+#pragma once
+
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/poll.h>
+
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+
+#include <config.h>
+
+// Server side TLS context: certificate, session resumption (cache + tickets)
+// and kernel TLS offload. Handshakes are driven by the event loop in
+// non-blocking mode, after that connection is served by worker as usual.
+class TLS_Context{
+
+    SSL_CTX *   ctx;
+
+    const unsigned char * session_id_context = reinterpret_cast< const unsigned char * >("HTTP_SERV");
+
+    inline void PrintErrors (const char * what);
+
+    static int  SelectALPN  (SSL * ssl, const unsigned char ** out, unsigned char * outlen,
+                             const unsigned char * in, unsigned int inlen, void * arg);
+
+  public:
+
+    TLS_Context() = delete;
+    TLS_Context(parse_info & info);
+
+    SSL *       NewSession  (int fd);
+
+    // returns  1 - handshake is completed,
+    //          0 - need more io, `events` is set to what poll must wait for,
+    //         -1 - handshake failed, session must be freed
+    int         Handshake   (SSL * ssl, short & events);
+
+    static bool IsKernelSend(SSL * ssl);
+    static bool IsResumed   (SSL * ssl);
+    static bool IsHTTP2     (SSL * ssl);
+
+    ~TLS_Context();
+};
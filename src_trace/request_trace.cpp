@@ -0,0 +1,97 @@
+#include <request_trace.h>
+
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <time.h>
+
+#ifdef HTTP_SERVER_WITH_SDT
+unsigned short http_server_accept_semaphore    = 0;
+unsigned short http_server_dequeue_semaphore   = 0;
+unsigned short http_server_parse_semaphore     = 0;
+unsigned short http_server_resolve_semaphore   = 0;
+unsigned short http_server_build_semaphore     = 0;
+unsigned short http_server_send_semaphore      = 0;
+#endif
+
+static const char * stage_names[TRACE_STAGES] = {"accept", "dequeue", "parsed", "resolved", "built", "sent"};
+
+static std::uint64_t NowNs(){
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+void request_trace::Mark(trace_stage stage, std::uint64_t bytes){
+  stage_ns[stage]    = NowNs();
+  stage_bytes[stage] = bytes;
+}
+
+void request_trace::SetPath(std::string_view _path){
+  std::size_t size = std::min(_path.size(), sizeof(path) - 1);
+  std::memcpy(path, _path.data(), size);
+  path[size] = '\0';
+}
+
+Request_Tracer::Request_Tracer(std::uint32_t _sample_rate, std::size_t ring_size) :
+  ring(ring_size), next(0), committed(0), accepted(0), sample_rate(_sample_rate){
+}
+
+std::shared_ptr<request_trace> Request_Tracer::Start(int fd){
+  std::uint64_t id = accepted.fetch_add(1, std::memory_order_relaxed);
+  if (!sample_rate || ring.empty() || id % sample_rate){
+    return nullptr;
+  }
+
+  auto trace = std::make_shared<request_trace>();
+  std::memset(trace.get(), 0, sizeof(request_trace));
+  trace->id = id;
+  trace->fd = fd;
+  trace->Mark(TRACE_ACCEPT);
+  return trace;
+}
+
+void Request_Tracer::Commit(const request_trace & trace){
+  std::lock_guard<std::mutex> lk(mtx);
+  ring[next] = trace;
+  next = (next + 1) % ring.size();
+  ++committed;
+}
+
+void Request_Tracer::WriteJSON(std::string & dst){
+  std::lock_guard<std::mutex> lk(mtx);
+
+  char buff[160];
+  snprintf(buff, sizeof(buff), "{\"sample_rate\":%u,\"accepted\":%llu,\"sampled\":%llu,\"traces\":[",
+           sample_rate, static_cast<unsigned long long>(accepted.load()), static_cast<unsigned long long>(committed));
+  dst.append(buff);
+
+  std::size_t count = std::min<std::uint64_t>(committed, ring.size());
+  std::size_t first = (next + ring.size() - count) % ring.size();
+
+  for (std::size_t i = 0; i < count; ++i){
+    const request_trace & trace = ring[(first + i) % ring.size()];
+
+    snprintf(buff, sizeof(buff), "%s{\"id\":%llu,\"fd\":%d,\"worker\":%u,\"failed\":%s,\"path\":\"",
+             i ? "," : "", static_cast<unsigned long long>(trace.id), trace.fd, trace.worker, trace.failed ? "true" : "false");
+    dst.append(buff);
+
+    for (const char * c = trace.path; *c; ++c){
+      if (*c == '"' || *c == '\\') dst.push_back('\\');
+      if (static_cast<unsigned char>(*c) < 0x20) continue;
+      dst.push_back(*c);
+    }
+    dst.append("\",\"stages\":{");
+
+    bool comma = false;
+    for (int stage = 0; stage < TRACE_STAGES; ++stage){
+      if (!trace.stage_ns[stage]) continue;
+      snprintf(buff, sizeof(buff), "%s\"%s\":{\"us\":%.3f,\"bytes\":%llu}", comma ? "," : "", stage_names[stage],
+               (trace.stage_ns[stage] - trace.stage_ns[TRACE_ACCEPT]) / 1000.0, static_cast<unsigned long long>(trace.stage_bytes[stage]));
+      dst.append(buff);
+      comma = true;
+    }
+    dst.append("}}");
+  }
+  dst.append("]}\n");
+}
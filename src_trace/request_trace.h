@@ -0,0 +1,87 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+// Static tracepoints of request path for bpftrace/perf (provider http_server):
+//   accept(fd, is_tls)  dequeue(fd, worker)  parse(fd, path, request bytes)
+//   resolve(fd, path, file bytes)  build(fd, response bytes)  send(fd, sent bytes, failed)
+// With sys/sdt.h every probe is a test of its semaphore: tracer raises it
+// when it attaches, only then arguments (like respond.Size()) are computed
+// and the nop is reached. Without sys/sdt.h probes are not compiled at all.
+#ifdef HTTP_SERVER_WITH_SDT
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+#define HTTP_PROBE_SEMAPHORE(name)  http_server_##name##_semaphore
+#define HTTP_PROBE(name, ...)                                                 \
+  do{                                                                         \
+    if (__builtin_expect(HTTP_PROBE_SEMAPHORE(name), 0))                      \
+      STAP_PROBEV(http_server, name, ##__VA_ARGS__);                          \
+  } while (0)
+
+// defined in request_trace.cpp, one per probe
+extern "C" unsigned short http_server_accept_semaphore    __attribute__((section(".probes")));
+extern "C" unsigned short http_server_dequeue_semaphore   __attribute__((section(".probes")));
+extern "C" unsigned short http_server_parse_semaphore     __attribute__((section(".probes")));
+extern "C" unsigned short http_server_resolve_semaphore   __attribute__((section(".probes")));
+extern "C" unsigned short http_server_build_semaphore     __attribute__((section(".probes")));
+extern "C" unsigned short http_server_send_semaphore      __attribute__((section(".probes")));
+#else
+#define HTTP_PROBE(name, ...)   do{}while(0)
+#endif
+
+#define TRACE_PATH_SIZE (96)  //longer paths are cut in sampled traces
+
+enum trace_stage{
+  TRACE_ACCEPT,
+  TRACE_DEQUEUE,
+  TRACE_PARSED,
+  TRACE_RESOLVED,
+  TRACE_BUILT,
+  TRACE_SENT,
+  TRACE_STAGES
+};
+
+// timeline of one sampled request, it travels with connection
+struct request_trace{
+    std::uint64_t   id;
+    int             fd;
+    std::uint32_t   worker;
+    bool            failed;
+    std::uint64_t   stage_ns[TRACE_STAGES];     // CLOCK_MONOTONIC, 0 - stage was not reached
+    std::uint64_t   stage_bytes[TRACE_STAGES];
+    char            path[TRACE_PATH_SIZE];
+
+    void  Mark    (trace_stage stage, std::uint64_t bytes = 0);
+    void  SetPath (std::string_view _path);
+};
+
+// Samples 1 of `sample_rate` accepted connections and keeps timelines of
+// the last `ring_size` finished ones, they are read by internal endpoint.
+class Request_Tracer{
+
+    std::mutex                      mtx;
+    std::vector<request_trace>      ring;
+    std::size_t                     next;       // slot for the next finished trace
+    std::uint64_t                   committed;
+    std::atomic<std::uint64_t>      accepted;
+    std::uint32_t                   sample_rate;
+
+  public:
+
+    Request_Tracer() = delete;
+    Request_Tracer(const Request_Tracer &) = delete;
+    Request_Tracer(std::uint32_t _sample_rate, std::size_t ring_size);
+
+    // new timeline started at accept, nullptr - connection is not sampled
+    std::shared_ptr<request_trace>  Start   (int fd);
+    void                            Commit  (const request_trace & trace);
+
+    // ring from the oldest trace, stage times in microseconds since accept
+    void                            WriteJSON (std::string & dst);
+};
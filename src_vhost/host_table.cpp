@@ -0,0 +1,83 @@
+#include <host_table.h>
+
+#include <algorithm>
+#include <cctype>
+#include <strings.h>
+
+#define HOST_TABLE_MAX_SEEDS (1 << 16)  //seeds tried for one table size before it is doubled
+
+// FNV-1a over lowercased bytes, seeded
+std::uint64_t Host_Table::Hash(std::uint64_t seed, std::string_view name){
+  std::uint64_t hash = 14695981039346656037ULL ^ (seed * 0x9E3779B97F4A7C15ULL);
+  for (auto it = name.begin(); it != name.end(); ++it){
+    hash ^= static_cast<uint8_t>(std::tolower(static_cast<unsigned char>(*it)));
+    hash *= 1099511628211ULL;
+  }
+  return hash ^ (hash >> 29);
+}
+
+bool Host_Table::Build(const std::vector<std::pair<std::string, std::uint32_t>> & names){
+  keys.clear();
+  values.clear();
+  mask = 0;
+
+  if (names.empty()){
+    return true;
+  }
+
+  // equal names always collide: no seed would be found after the whole search
+  std::vector<std::string> sorted;
+  for (auto it = names.begin(); it != names.end(); ++it){
+    sorted.push_back(it->first);
+    std::transform(sorted.back().begin(), sorted.back().end(), sorted.back().begin(), [](unsigned char c){ return std::tolower(c); });
+  }
+  std::sort(sorted.begin(), sorted.end());
+  if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end()){
+    return false;
+  }
+
+  // power of two from twice the number of names: a free seed is found fast
+  std::size_t size = 1;
+  while (size < names.size() * 2) size <<= 1;
+
+  for (; size <= names.size() * 64; size <<= 1){
+    for (std::uint64_t s = 1; s <= HOST_TABLE_MAX_SEEDS; ++s){
+      std::vector<bool> used(size, false);
+      bool              collision = false;
+
+      for (auto it = names.begin(); it != names.end() && !collision; ++it){
+        std::size_t slot = Hash(s, it->first) & (size - 1);
+        collision  = used[slot];
+        used[slot] = true;
+      }
+      if (collision){
+        continue;
+      }
+
+      keys.assign(size, std::string());
+      values.assign(size, 0);
+      seed = s;
+      mask = size - 1;
+      for (auto it = names.begin(); it != names.end(); ++it){
+        std::size_t slot = Hash(seed, it->first) & mask;
+        keys[slot]   = it->first;
+        values[slot] = it->second;
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+int Host_Table::Find(std::string_view name) const{
+  if (keys.empty()){
+    return -1;
+  }
+
+  std::size_t         slot = Hash(seed, name) & mask;
+  const std::string & key  = keys[slot];
+  if (key.size() != name.size() || key.empty() || strncasecmp(key.data(), name.data(), name.size()) != 0){
+    return -1;
+  }
+  return values[slot];
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+// Perfect hash of virtual host names, built once at start: seed is searched
+// until every lowercased name gets its own slot, so lookup is one hash of
+// Host header (lowercased on the fly) and one comparison, without allocation.
+class Host_Table{
+
+    std::vector<std::string>    keys;       // lowercased name of slot, empty - free slot
+    std::vector<std::uint32_t>  values;
+    std::uint64_t               seed;
+    std::size_t                 mask;
+
+    static std::uint64_t Hash (std::uint64_t seed, std::string_view name);
+
+  public:
+
+    Host_Table() : seed(0), mask(0) {}
+
+    // names must be lowercased, false - a name repeats or no seed was found
+    bool          Build   (const std::vector<std::pair<std::string, std::uint32_t>> & names);
+
+    // value of `name` compared case-insensitively, -1 - unknown host
+    int           Find    (std::string_view name) const;
+
+    std::size_t   Slots   () const { return keys.size(); }
+};
@@ -0,0 +1,190 @@
+#include <string>
+#include <vector>
+#include <fstream>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "check.h"
+
+// HTTP_SERV built with counting operator new (HTTP_SERVER_ALLOC_STATS):
+// GET of a cached file must not reach heap. Counters are read from the
+// allocations report which SIGUSR2 prints.
+
+namespace {
+  std::uint16_t FreePort(){
+    int         fd   = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    socklen_t   len  = sizeof(addr);
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+    getsockname(fd, reinterpret_cast<sockaddr *>(&addr), &len);
+    close(fd);
+    return ntohs(addr.sin_port);
+  }
+
+  int Connect(std::uint16_t port){
+    int         fd   = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0){
+      close(fd);
+      return -1;
+    }
+    return fd;
+  }
+
+  std::string Get(std::uint16_t port, const std::string & target){
+    int fd = Connect(port);
+    if (fd < 0){
+      return std::string();
+    }
+    std::string request = "GET " + target + " HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+    if (send(fd, request.data(), request.size(), MSG_NOSIGNAL) < 0){
+      close(fd);
+      return std::string();
+    }
+
+    std::string respond;
+    char        buff[4096];
+    ssize_t     rc;
+    while ((rc = recv(fd, buff, sizeof(buff), 0)) > 0){
+      respond.append(buff, rc);
+    }
+    close(fd);
+    return respond;
+  }
+
+  struct alloc_report{
+    long    requests;
+    long    zero_allocation_requests;
+  };
+
+  // "requests: N, heap allocations per request: X, requests without heap allocations: Z, ..."
+  std::vector<alloc_report> ReadReports(const std::string & log_path){
+    std::vector<alloc_report> reports;
+    std::ifstream             log(log_path);
+    std::string               line;
+    while (std::getline(log, line)){
+      if (line.compare(0, 10, "requests: ") || line.find("heap allocations per request") == std::string::npos){
+        continue;
+      }
+      std::size_t  zero   = line.find("requests without heap allocations: ");
+      alloc_report report = {std::atol(line.c_str() + 10), zero == std::string::npos ? -1 : std::atol(line.c_str() + zero + 35)};
+      reports.push_back(report);
+    }
+    return reports;
+  }
+
+  // worker counts request after client has got respond, so report is asked again until it has `requests`
+  bool Report(pid_t pid, const std::string & log_path, long requests, alloc_report & report){
+    for (int attempt = 0; attempt < 100; ++attempt){
+      std::size_t printed = ReadReports(log_path).size();
+      kill(pid, SIGUSR2);
+
+      std::vector<alloc_report> reports;
+      for (int i = 0; i < 100 && (reports = ReadReports(log_path)).size() <= printed; ++i){
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+      if (reports.size() > printed && reports.back().requests >= requests){
+        report = reports.back();
+        return true;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+  }
+}
+
+int main(int argc, char * argv[]){
+  if (argc < 2){
+    std::cerr << "\tUsage: " << argv[0] << " <HTTP_SERV binary with allocation counters>\n";
+    return EXIT_FAILURE;
+  }
+
+  char root[] = "/tmp/alloc_test_XXXXXX";
+  if (!mkdtemp(root)){
+    std::perror("Cannot create root directory ");
+    return EXIT_FAILURE;
+  }
+  std::string   root_path = root;
+  std::string   log_path  = root_path + "/out.log";
+  std::uint16_t port      = FreePort();
+
+  mkdir((root_path + "/www").c_str(), 0755);
+  std::ofstream(root_path + "/www/a.txt") << "cached body";
+  std::ofstream(root_path + "/conf.xml")
+    << "<?xml version=\"1.0\"?>\n<configuration>\n"
+    << "  <IP-address>127.0.0.1</IP-address>\n"
+    << "  <TCP-port>" << port << "</TCP-port>\n"
+    << "  <number-workers>1</number-workers>\n"
+    << "  <root-path>" << root_path << "/www/</root-path>\n"
+    << "  <cache-size>1M</cache-size>\n"
+    << "</configuration>\n";
+
+  pid_t pid = fork();
+  if (pid == 0){
+    int null_fd = open("/dev/null", O_RDWR);
+    int log_fd  = open(log_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    dup2(null_fd, STDIN_FILENO);
+    dup2(log_fd, STDOUT_FILENO);
+    dup2(null_fd, STDERR_FILENO);
+    execl(argv[1], argv[1], (root_path + "/conf.xml").c_str(), static_cast<char *>(nullptr));
+    _exit(127);
+  }
+
+  bool is_listening = false;
+  for (int i = 0; i < 500 && !is_listening; ++i){
+    int fd = Connect(port);
+    is_listening = fd >= 0;
+    if (fd >= 0) close(fd);
+    else std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  CHECK(is_listening);
+
+  if (is_listening){
+    // the first request loads the file into cache and lets worker grow its buffers
+    const int warmup = 3;
+    for (int i = 0; i < warmup; ++i){
+      CHECK(Get(port, "/a.txt").find("cached body") != std::string::npos);
+    }
+    alloc_report before = {0, 0};
+    CHECK(Report(pid, log_path, warmup, before));
+
+    const int cached = 20;
+    for (int i = 0; i < cached; ++i){
+      std::string respond = Get(port, "/a.txt");
+      CHECK(respond.compare(0, 15, "HTTP/1.1 200 OK") == 0);
+      CHECK(respond.find("cached body") != std::string::npos);
+    }
+    alloc_report after = {0, 0};
+    CHECK(Report(pid, log_path, warmup + cached, after));
+
+    CHECK_EQUAL(after.requests - before.requests, cached);
+    CHECK_EQUAL(after.zero_allocation_requests - before.zero_allocation_requests, cached);
+  }
+
+  kill(pid, SIGKILL);
+  waitpid(pid, nullptr, 0);
+
+  unlink(log_path.c_str());
+  unlink((root_path + "/conf.xml").c_str());
+  unlink((root_path + "/www/a.txt").c_str());
+  rmdir((root_path + "/www").c_str());
+  rmdir(root_path.c_str());
+
+  return TestResult("alloc");
+}
@@ -0,0 +1,65 @@
+#include <autoindex.h>
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdlib>
+#include <cstdio>
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "check.h"
+
+// Page cache of Directory_Index: pages past the last one share the copy of
+// the last page, the least recently used page is dropped.
+
+namespace {
+  listing_query Query(std::size_t page){
+    listing_query query = Directory_Index::ParseQuery("format=json");
+    query.page = page;
+    return query;
+  }
+}
+
+int main(){
+  char root[] = "/tmp/autoindex_test_XXXXXX";
+  if (!mkdtemp(root)){
+    std::perror("Cannot create directory ");
+    return EXIT_FAILURE;
+  }
+  std::string directory = std::string(root) + "/";
+  const char * names[]  = {"a", "b", "c", "d", "e"};
+  for (const char * name : names){
+    std::ofstream(directory + name) << name;
+  }
+
+  struct stat _stat = {0};
+  stat(root, &_stat);
+
+  Directory_Index index(2);
+
+  listing_page last = index.Page(directory, _stat.st_mtim, "/", Query(3));
+  CHECK(last != nullptr);
+  CHECK(last && last->find("\"page\":3,\"pages\":3") != std::string::npos);
+  CHECK(index.Page(directory, _stat.st_mtim, "/", Query(999)) == last);
+  CHECK(index.Page(directory, _stat.st_mtim, "/", Query(1000000)) == last);
+  CHECK(index.Page(directory, _stat.st_mtim, "/", Query(2)) != last);
+
+  // the least recently used page is dropped, not the first by key
+  std::vector<listing_page> pages;
+  for (int i = 0; i < AUTOINDEX_CACHE_PAGES; ++i){
+    pages.push_back(index.Page(directory, _stat.st_mtim, "/k" + std::to_string(i) + "/", Query(1)));
+  }
+  CHECK(index.Page(directory, _stat.st_mtim, "/k0/", Query(1)) == pages[0]);
+  index.Page(directory, _stat.st_mtim, "/new/", Query(1));
+  CHECK(index.Page(directory, _stat.st_mtim, "/k0/", Query(1)) == pages[0]);
+  CHECK(index.Page(directory, _stat.st_mtim, "/k1/", Query(1)) != pages[1]);
+
+  for (const char * name : names){
+    unlink((directory + name).c_str());
+  }
+  rmdir(root);
+
+  return TestResult("autoindex");
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <iostream>
+
+// Assertions of unit tests: failed ones are printed and counted, test
+// returns their number, so ctest reports the target as failed.
+
+static int failed_checks = 0;
+
+#define CHECK(condition)                                                              \
+  do{                                                                                 \
+    if (!(condition)){                                                                \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition "\n"; \
+      ++failed_checks;                                                                \
+    }                                                                                 \
+  } while (0)
+
+#define CHECK_EQUAL(actual, expected)                                                 \
+  do{                                                                                 \
+    auto _actual   = (actual);                                                        \
+    auto _expected = (expected);                                                      \
+    if (!(_actual == _expected)){                                                     \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #actual " is `"  \
+                << _actual << "`, expected `" << _expected << "`\n";                  \
+      ++failed_checks;                                                                \
+    }                                                                                 \
+  } while (0)
+
+inline int TestResult(const char * name){
+  std::cout << name << ": " << (failed_checks ? "FAILED" : "passed") << std::endl;
+  return failed_checks;
+}
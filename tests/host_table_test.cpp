@@ -0,0 +1,29 @@
+#include <host_table.h>
+
+#include <chrono>
+
+#include "check.h"
+
+// Host_Table lookup and rejection of repeated names.
+
+int main(){
+  Host_Table table;
+
+  CHECK(table.Build({{"example.com", 1}, {"www.example.com", 1}, {"other.org", 2}}));
+  CHECK_EQUAL(table.Find("example.com"), 1);
+  CHECK_EQUAL(table.Find("WWW.Example.COM"), 1);
+  CHECK_EQUAL(table.Find("other.org"), 2);
+  CHECK_EQUAL(table.Find("unknown.net"), -1);
+  CHECK_EQUAL(table.Find(""), -1);
+
+  // repeated name, also in other case, is refused at once instead of searching every seed
+  auto start = std::chrono::steady_clock::now();
+  CHECK(!table.Build({{"example.com", 1}, {"other.org", 2}, {"example.com", 2}}));
+  CHECK(!table.Build({{"example.com", 1}, {"Example.com", 2}}));
+  CHECK(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(100));
+
+  CHECK(table.Build({}));
+  CHECK_EQUAL(table.Find("example.com"), -1);
+
+  return TestResult("host_table");
+}
@@ -0,0 +1,279 @@
+#include <http2.h>
+
+#include <string>
+#include <vector>
+#include <cstring>
+
+#include "check.h"
+
+// Requests with malformed pseudo-headers and fields are reset by the
+// session with RST_STREAM PROTOCOL_ERROR and never reach the handler.
+// Header blocks over the announced list size, CONTINUATION floods and
+// HPACK references which expand into huge lists close the connection.
+// Body of respond is read by the session in parts of DATA frames.
+
+namespace {
+  const uint8_t DATA          = 0x0;
+  const uint8_t HEADERS       = 0x1;
+  const uint8_t RST_STREAM    = 0x3;
+  const uint8_t SETTINGS      = 0x4;
+  const uint8_t GOAWAY        = 0x7;
+  const uint8_t CONTINUATION  = 0x9;
+  const uint8_t END_STREAM    = 0x1;
+  const uint8_t END_HEADERS   = 0x4;
+
+  const uint16_t MAX_HEADER_LIST_SIZE = 0x6;
+  const int64_t  ENHANCE_YOUR_CALM    = 0xb;
+
+  void PutFrame(std::vector<uint8_t> & dst, uint8_t type, uint8_t flags, uint32_t stream_id, const std::vector<uint8_t> & payload){
+    dst.push_back(payload.size() >> 16);
+    dst.push_back(payload.size() >> 8);
+    dst.push_back(payload.size());
+    dst.push_back(type);
+    dst.push_back(flags);
+    dst.push_back(stream_id >> 24);
+    dst.push_back(stream_id >> 16);
+    dst.push_back(stream_id >> 8);
+    dst.push_back(stream_id);
+    dst.insert(dst.end(), payload.begin(), payload.end());
+  }
+
+  uint32_t GetUint32(const uint8_t * src){
+    return (src[0] << 24) | (src[1] << 16) | (src[2] << 8) | src[3];
+  }
+
+  struct exchange{
+    bool      is_handled;     // handler was called
+    header_list request;      // as handler got it
+    int       headers;        // HEADERS frames of stream 1 sent by server
+    int64_t   reset;          // error code of RST_STREAM of stream 1, -1 - none
+    int64_t   goaway;         // error code of GOAWAY, -1 - none
+    int64_t   max_header_list;// SETTINGS_MAX_HEADER_LIST_SIZE of server, -1 - none
+    std::string data;         // DATA of stream 1
+    std::size_t max_data;     // the largest DATA frame
+    bool      is_data_end;    // the last DATA frame has END_STREAM
+  };
+
+  // client sends preface, empty SETTINGS and `frames`, then closes; handler responds with `body`
+  exchange Run(const std::vector<uint8_t> & frames, const std::string & body = "ok"){
+    std::vector<uint8_t> input(HTTP2_Session::PREFACE, HTTP2_Session::PREFACE + HTTP2_Session::PREFACE_SIZE);
+    PutFrame(input, SETTINGS, 0, 0, {});
+    input.insert(input.end(), frames.begin(), frames.end());
+
+    std::size_t          input_pos = 0;
+    std::vector<uint8_t> output;
+    exchange             result = {false, {}, 0, -1, -1, -1, std::string(), 0, false};
+
+    HTTP2_Transport transport;
+    transport.recv = [&](uint8_t * dst, std::size_t size){
+      std::size_t part = std::min(size, input.size() - input_pos);
+      std::memcpy(dst, input.data() + input_pos, part);
+      input_pos += part;
+      return static_cast<int>(part);
+    };
+    transport.send     = [&](const uint8_t * src, std::size_t size){ output.insert(output.end(), src, src + size); return true; };
+    transport.readable = [&](){ return input_pos < input.size(); };
+
+    std::size_t   body_pos = 0;
+    HTTP2_Handler handler  = [&](const header_list & fields, HTTP2_Respond & respond){
+      std::string head = "HTTP/1.1 200 OK\nContent-Length: " + std::to_string(body.size()) + "\n\n";
+      result.is_handled = true;
+      result.request    = fields;
+      respond.head.assign(head.begin(), head.end());
+      respond.body_size = body.size();
+      respond.read_body = [&](uint8_t * dst, std::size_t size){
+        std::size_t part = std::min(size, body.size() - body_pos);
+        std::memcpy(dst, body.data() + body_pos, part);
+        body_pos += part;
+        return part;
+      };
+    };
+
+    HTTP2_Session session(transport, handler, 100);
+    session.Serve(nullptr, 0);
+
+    for (std::size_t pos = 0; pos + 9 <= output.size();){
+      std::size_t length    = (output[pos] << 16) | (output[pos + 1] << 8) | output[pos + 2];
+      uint8_t     type      = output[pos + 3];
+      uint8_t     flags     = output[pos + 4];
+      uint32_t    stream_id = GetUint32(output.data() + pos + 5);
+      const uint8_t * payload = output.data() + pos + 9;
+
+      if (stream_id == 1 && type == HEADERS){
+        ++result.headers;
+      }
+      if (stream_id == 1 && type == DATA){
+        result.data.append(reinterpret_cast<const char *>(payload), length);
+        result.max_data    = std::max(result.max_data, length);
+        result.is_data_end = flags & END_STREAM;
+      }
+      if (stream_id == 1 && type == RST_STREAM && length == 4){
+        result.reset = GetUint32(payload);
+      }
+      if (type == GOAWAY && length >= 8){
+        result.goaway = GetUint32(payload + 4);
+      }
+      for (std::size_t i = 0; type == SETTINGS && !(flags & 0x1) && i + 6 <= length; i += 6){
+        if (((payload[i] << 8) | payload[i + 1]) == MAX_HEADER_LIST_SIZE){
+          result.max_header_list = GetUint32(payload + i + 2);
+        }
+      }
+      pos += 9 + length;
+    }
+    return result;
+  }
+
+  // one request on stream 1
+  exchange Send(const header_list & request){
+    HPACK_Encoder        encoder;
+    std::vector<uint8_t> block;
+    std::vector<uint8_t> frames;
+    encoder.Encode(request, block);
+    PutFrame(frames, HEADERS, END_STREAM | END_HEADERS, 1, block);
+    return Run(frames);
+  }
+
+  // connection is closed by GOAWAY ENHANCE_YOUR_CALM before handler is called
+  void CheckCalm(const std::vector<uint8_t> & frames, const char * what){
+    exchange result = Run(frames);
+    if (result.is_handled || result.goaway != ENHANCE_YOUR_CALM){
+      std::cerr << "not refused: " << what << "\n";
+    }
+    CHECK(!result.is_handled);
+    CHECK_EQUAL(result.goaway, ENHANCE_YOUR_CALM);
+  }
+
+  header_list Valid(){
+    return {{":method", "GET"}, {":scheme", "https"}, {":path", "/a.txt"}, {":authority", "example.com"},
+            {"accept-encoding", "gzip"}};
+  }
+
+  header_list With(header_list request, const std::string & name, const std::string & value){
+    for (auto it = request.begin(); it != request.end(); ++it){
+      if (it->first == name){
+        it->second = value;
+        return request;
+      }
+    }
+    request.push_back(header_field(name, value));
+    return request;
+  }
+
+  header_list Without(header_list request, const std::string & name){
+    for (auto it = request.begin(); it != request.end(); ++it){
+      if (it->first == name){
+        request.erase(it);
+        break;
+      }
+    }
+    return request;
+  }
+
+  void CheckRejected(const header_list & request, const char * what){
+    exchange result = Send(request);
+    if (result.is_handled || result.reset != 1 || result.headers){
+      std::cerr << "not rejected: " << what << "\n";
+    }
+    CHECK(!result.is_handled);
+    CHECK_EQUAL(result.reset, 1);
+    CHECK_EQUAL(result.headers, 0);
+  }
+}
+
+int main(){
+  exchange result = Send(Valid());
+  CHECK(result.is_handled);
+  CHECK(result.request == Valid());
+  CHECK_EQUAL(result.reset, -1);
+  CHECK_EQUAL(result.headers, 1);
+  CHECK_EQUAL(result.goaway, -1);
+  CHECK_EQUAL(result.max_header_list, 65536);
+  CHECK(result.data == "ok");
+  CHECK(result.is_data_end);
+  CHECK(HTTP2_Session::IsValidRequest(Valid()));
+  CHECK(HTTP2_Session::IsValidRequest(With(With(Valid(), ":method", "OPTIONS"), ":path", "*")));
+  CHECK(HTTP2_Session::IsValidRequest(With(Valid(), "te", "trailers")));
+
+  // injection into synthesized HTTP/1.1 text
+  CheckRejected(With(Valid(), ":path", "/a.txt\r\nX-Injected: 1"),        "CRLF in :path");
+  CheckRejected(With(Valid(), ":path", "/a.txt HTTP/1.1\nHost: other"),  "space and LF in :path");
+  CheckRejected(With(Valid(), ":method", "GET /etc/passwd"),             "space in :method");
+  CheckRejected(With(Valid(), ":authority", "example.com\r\nX: 1"),      "CRLF in :authority");
+  CheckRejected(With(Valid(), "accept-encoding", "gzip\nX-Injected: 1"), "LF in field value");
+  CheckRejected(With(Valid(), "accept-encoding", std::string("gz\0ip", 5)), "NUL in field value");
+
+  // malformed request line
+  CheckRejected(Without(Valid(), ":path"),                               "missing :path");
+  CheckRejected(Without(Valid(), ":method"),                             "missing :method");
+  CheckRejected(Without(Valid(), ":scheme"),                             "missing :scheme");
+  CheckRejected(With(Valid(), ":path", ""),                              "empty :path");
+  CheckRejected(With(Valid(), ":method", ""),                            "empty :method");
+  CheckRejected(With(Valid(), ":path", "a.txt"),                         "relative :path");
+  CheckRejected(With(Valid(), ":path", "*"),                             "asterisk :path of GET");
+
+  // rfc7540 8.1.2
+  header_list repeated = Valid();
+  repeated.push_back(header_field(":path", "/b.txt"));
+  CheckRejected(repeated,                                                "repeated :path");
+  header_list late = Without(Valid(), ":authority");
+  late.push_back(header_field(":authority", "example.com"));
+  CheckRejected(late,                                                    "pseudo-header after field");
+  CheckRejected(With(Valid(), ":protocol", "websocket"),                 "unknown pseudo-header");
+  CheckRejected(With(Valid(), "Accept-Language", "en"),                  "uppercase name");
+  CheckRejected(With(Valid(), "connection", "keep-alive"),               "connection field");
+  CheckRejected(With(Valid(), "transfer-encoding", "chunked"),           "transfer-encoding field");
+  CheckRejected(With(Valid(), "te", "gzip"),                             "te other than trailers");
+
+  // header block which never ends: empty CONTINUATION frames, then big ones
+  // (0xff bytes would be COMPRESSION_ERROR, if the block were decoded)
+  HPACK_Encoder        encoder;
+  std::vector<uint8_t> block;
+  encoder.Encode(Valid(), block);
+
+  std::vector<uint8_t> flood;
+  PutFrame(flood, HEADERS, END_STREAM, 1, block);
+  for (int i = 0; i < 1000; ++i){
+    PutFrame(flood, CONTINUATION, 0, 1, {});
+  }
+  PutFrame(flood, CONTINUATION, END_HEADERS, 1, {});
+  CheckCalm(flood, "empty CONTINUATION flood");
+
+  flood.clear();
+  PutFrame(flood, HEADERS, END_STREAM, 1, block);
+  for (int i = 0; i < 5; ++i){
+    PutFrame(flood, CONTINUATION, 0, 1, std::vector<uint8_t>(16384, 0xff));
+  }
+  PutFrame(flood, CONTINUATION, END_HEADERS, 1, {});
+  CheckCalm(flood, "header block over the list size");
+
+  // 4K value goes into dynamic table once, one byte references repeat it
+  header_list bomb = Valid();
+  for (int i = 0; i < 100; ++i){
+    bomb.push_back(header_field("content-type", std::string(4000, 'x')));
+  }
+  block.clear();
+  encoder = HPACK_Encoder();
+  encoder.Encode(bomb, block);
+  CHECK(block.size() < 8192);
+
+  std::vector<uint8_t> frames;
+  PutFrame(frames, HEADERS, END_STREAM | END_HEADERS, 1, block);
+  CheckCalm(frames, "HPACK references over the list size");
+
+  // body over several DATA frames of default size, within the initial window
+  std::string big(60000, '\0');
+  for (std::size_t i = 0; i < big.size(); ++i){
+    big[i] = static_cast<char>(i * 7 + i / 251);
+  }
+  frames.clear();
+  block.clear();
+  encoder = HPACK_Encoder();
+  encoder.Encode(Valid(), block);
+  PutFrame(frames, HEADERS, END_STREAM | END_HEADERS, 1, block);
+  result = Run(frames, big);
+  CHECK(result.data == big);
+  CHECK_EQUAL(result.max_data, 16384u);
+  CHECK(result.is_data_end);
+
+  return TestResult("http2");
+}
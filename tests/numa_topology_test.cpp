@@ -0,0 +1,36 @@
+#include <numa_topology.h>
+
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "check.h"
+
+// ParseCPUList of worker-cpus and reactor-cpus.
+
+namespace {
+  std::vector<int> Parsed(const std::string & list){
+    std::vector<int> cpus;
+    return NUMA_Topology::ParseCPUList(list, cpus) ? cpus : std::vector<int>({-1});
+  }
+}
+
+int main(){
+  CHECK(Parsed("0") == std::vector<int>({0}));
+  CHECK(Parsed("0-0, 0") == std::vector<int>({0, 0}));
+  CHECK(Parsed("") == std::vector<int>());
+  CHECK(Parsed("1-0") == std::vector<int>({-1}));
+  CHECK(Parsed("-1") == std::vector<int>({-1}));
+  CHECK(Parsed("a") == std::vector<int>({-1}));
+
+  // cpus past the configured ones (and past cpu_set_t) are refused instead of being expanded
+  long configured = sysconf(_SC_NPROCESSORS_CONF);
+  CHECK(Parsed("0-" + std::to_string(configured - 1)).size() == static_cast<std::size_t>(configured));
+  CHECK(Parsed(std::to_string(configured)) == std::vector<int>({-1}));
+  CHECK(Parsed("0-99999999999") == std::vector<int>({-1}));
+  CHECK(Parsed("0,99999999999999999999") == std::vector<int>({-1}));
+  CHECK(Parsed(std::to_string(CPU_SETSIZE)) == std::vector<int>({-1}));
+
+  return TestResult("numa_topology");
+}
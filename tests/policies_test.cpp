@@ -0,0 +1,290 @@
+#include <server_policies.h>
+
+#include <string>
+#include <sstream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+
+#include "check.h"
+
+// Default policies (events, scheduler, allocator, files, logger) and
+// Epoll_Events against their contracts in server_policies.h.
+
+namespace {
+  bool IsOpen(int fd){
+    return fcntl(fd, F_GETFD) != -1;
+  }
+
+  std::string ChainBytes(const Response_Chain & chain){
+    std::vector<uint8_t> bytes;
+    chain.CopyTo(bytes);
+    return std::string(bytes.begin(), bytes.end());
+  }
+
+  std::string TempFile(const std::string & content){
+    char name[] = "/tmp/policies_test_XXXXXX";
+    int  fd     = mkstemp(name);
+    if (fd < 0 || write(fd, content.data(), content.size()) != static_cast<ssize_t>(content.size())){
+      std::perror("Cannot create temporary file ");
+      std::exit(EXIT_FAILURE);
+    }
+    close(fd);
+    return name;
+  }
+
+  void TestQueue(){
+    Condvar_Queue<int> queue;
+
+    queue.Push(1);
+    queue.Push(2);
+    queue.Push(3);
+    CHECK_EQUAL(queue.Pop(), 1);
+    CHECK_EQUAL(queue.Pop(), 2);
+    CHECK_EQUAL(queue.Pop(), 3);
+
+    // Pop sleeps until task is pushed
+    std::atomic<bool> is_popped(false);
+    int               popped = 0;
+    std::thread consumer([&](){
+      popped    = queue.Pop();
+      is_popped = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    CHECK(!is_popped);
+    queue.Push(7);
+    consumer.join();
+    CHECK_EQUAL(popped, 7);
+
+    queue.Push(4);
+    queue.Push(5);
+    std::vector<int> drained;
+    queue.Drain([&](int task){ drained.push_back(task); });
+    CHECK_EQUAL(drained.size(), 2u);
+    CHECK(drained == std::vector<int>({4, 5}));
+
+    // drained queue is empty, not closed
+    queue.Drain([&](int){ CHECK(false); });
+    queue.Push(6);
+    CHECK_EQUAL(queue.Pop(), 6);
+  }
+
+  void TestFiles(){
+    const std::string content  = "hello, sendfile";
+    const std::string pathname = TempFile(content);
+    Request_Arena     arena(4096);
+
+    off_t size = 0;
+    CHECK_EQUAL(Sendfile_Files::Open("/nonexistent/policies_test", size), -1);
+
+    // body is a file segment, chain owns descriptor
+    int fd = Sendfile_Files::Open(pathname.c_str(), size);
+    CHECK(fd >= 0);
+    CHECK_EQUAL(size, static_cast<off_t>(content.size()));
+    {
+      Response_Chain chain(&arena);
+      chain.Append("head:");
+      Sendfile_Files::Attach(fd, size, chain, true);
+      CHECK(chain.HasFile());
+      CHECK(IsOpen(fd));
+      CHECK_EQUAL(ChainBytes(chain), "head:" + content);
+
+      // sendfile path of Flush
+      int pair[2];
+      CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+      CHECK(chain.Flush(pair[0], nullptr) == Response_Chain::FLUSH_DONE);
+      char buff[64] = {0};
+      CHECK_EQUAL(std::string(buff, read(pair[1], buff, sizeof(buff))), "head:" + content);
+      close(pair[0]);
+      close(pair[1]);
+    }
+    CHECK(!IsOpen(fd));
+
+    // body is copied into respond, descriptor is closed at once
+    fd = Sendfile_Files::Open(pathname.c_str(), size);
+    {
+      Response_Chain chain(&arena);
+      Sendfile_Files::Attach(fd, size, chain, false);
+      CHECK(!IsOpen(fd));
+      CHECK(!chain.HasFile());
+      CHECK_EQUAL(ChainBytes(chain), content);
+    }
+
+    // file shorter than promised length: the rest is zeros
+    fd = Sendfile_Files::Open(pathname.c_str(), size);
+    {
+      Response_Chain chain(&arena);
+      Sendfile_Files::Attach(fd, size + 3, chain, false);
+      CHECK_EQUAL(ChainBytes(chain), content + std::string(3, '\0'));
+    }
+
+    arena.Reset();
+    unlink(pathname.c_str());
+  }
+
+  void TestAllocator(){
+    Request_Arena arena(1024);
+
+    // requests which fit the block do not reach heap, alignment is kept
+    void * first = arena.allocate(100, 1);
+    void * aligned = arena.allocate(64, 64);
+    CHECK_EQUAL(reinterpret_cast<std::uintptr_t>(aligned) % 64, 0u);
+    {
+      arena_string path("/index.html?query=with+a+few+parameters+to+outgrow+small+string", &arena);
+      byte_buffer  bytes(200, 'x', &arena);
+      CHECK_EQUAL(path.get_allocator().resource(), &arena);
+    }
+    CHECK_EQUAL(arena.Overflows(), 0u);
+
+    // what does not fit continues in heap and is counted
+    void * big = arena.allocate(4096, 8);
+    CHECK(big != nullptr);
+    std::memset(big, 0, 4096);
+    CHECK_EQUAL(arena.Overflows(), 1u);
+
+    // Reset gives the block back from its start; overflow counter is the total of worker
+    arena.Reset();
+    CHECK(arena.allocate(100, 1) == first);
+    CHECK_EQUAL(arena.Overflows(), 1u);
+    arena.Reset();
+  }
+
+  // logger writes to std::cerr, it is caught by a string stream
+  template <class F>
+  std::string CaughtLog(F && f){
+    std::ostringstream   caught;
+    std::streambuf *     saved = std::cerr.rdbuf(caught.rdbuf());
+    f();
+    std::cerr.rdbuf(saved);
+    return caught.str();
+  }
+
+  void TestLogger(){
+    std::string error = CaughtLog([](){ Console_Logger::Error("Function poll failed!", "Bad file descriptor"); });
+    CHECK(error.find("Error!!! Function poll failed!") != std::string::npos);
+    CHECK(error.find("Bad file descriptor") != std::string::npos);
+    CHECK(error.back() == '\n');
+
+    std::string bare = CaughtLog([](){ Console_Logger::Error("Listening socket failed!"); });
+    CHECK(bare.find("Error!!! Listening socket failed!") != std::string::npos);
+    CHECK(bare.find("\033[1;35m") == std::string::npos);
+
+    std::string warning = CaughtLog([](){ Console_Logger::Warning("Worker process 7 exited"); });
+    CHECK(warning.find("Warning!!! Worker process 7 exited") != std::string::npos);
+    CHECK(warning.find("Error") == std::string::npos);
+
+    // policy is reached through the set, as the server does
+    std::string through = CaughtLog([](){ Default_Policies::logger::Warning("through policies"); });
+    CHECK(through.find("through policies") != std::string::npos);
+  }
+
+  struct ready_event{
+    int   fd;
+    short revents;
+  };
+
+  template <class Events>
+  std::vector<ready_event> Collect(Events & events, int timeout){
+    std::vector<ready_event> ready;
+    if (events.Wait(timeout) > 0){
+      events.Ready([&](int fd, short revents){
+        ready.push_back(ready_event{fd, revents});
+        return true;
+      });
+    }
+    return ready;
+  }
+
+  template <class Events>
+  void TestEvents(){
+    int first[2], second[2], third[2];
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, first)  == 0);
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, second) == 0);
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, third)  == 0);
+
+    Events events;
+    events.Add(first[0], POLLIN);
+    CHECK(Collect(events, 0).empty());
+    CHECK(!Events::Readable(first[0]));
+
+    CHECK_EQUAL(write(first[1], "x", 1), 1);
+    std::vector<ready_event> ready = Collect(events, 1000);
+    CHECK_EQUAL(ready.size(), 1u);
+    CHECK(ready.size() && ready[0].fd == first[0] && (ready[0].revents & POLLIN));
+    CHECK(Events::Readable(first[0]));
+
+    // level-triggered: unread byte is reported again, with writability when it is asked
+    events.Modify(first[0], POLLIN | POLLOUT);
+    ready = Collect(events, 1000);
+    CHECK(ready.size() == 1 && (ready[0].revents & POLLIN) && (ready[0].revents & POLLOUT));
+    events.Modify(first[0], POLLIN);
+
+    // descriptor removed under Ready is not reported, added one waits for the next Wait
+    events.Add(second[0], POLLIN);
+    CHECK_EQUAL(write(second[1], "y", 1), 1);
+    CHECK_EQUAL(write(third[1], "z", 1), 1);
+    CHECK_EQUAL(events.Wait(1000), 2);
+
+    int visited = 0;
+    events.Ready([&](int fd, short){
+      ++visited;
+      events.Remove(fd == first[0] ? second[0] : first[0]);
+      events.Add(third[0], POLLIN);
+      return true;
+    });
+    CHECK_EQUAL(visited, 1);
+
+    ready = Collect(events, 1000);
+    CHECK_EQUAL(ready.size(), 2u);
+    for (auto it = ready.begin(); it != ready.end(); ++it){
+      CHECK(it->fd == third[0] || it->fd == first[0] || it->fd == second[0]);
+    }
+
+    // false from callback stops iteration
+    CHECK_EQUAL(events.Wait(1000), 2);
+    visited = 0;
+    events.Ready([&](int, short){ ++visited; return false; });
+    CHECK_EQUAL(visited, 1);
+
+    // worker process of prefork waits on the set inherited from master
+    pid_t pid = fork();
+    if (pid == 0){
+      bool is_ready = Collect(events, 1000).size() == 2;
+      _exit(is_ready ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    int status = -1;
+    CHECK(pid > 0 && waitpid(pid, &status, 0) == pid);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS);
+    CHECK_EQUAL(Collect(events, 1000).size(), 2u);
+
+    // Close closes descriptors of the set only
+    int kept = first[0] == ready[0].fd || first[0] == ready[1].fd ? second[0] : first[0];
+    events.Close();
+    CHECK(!IsOpen(third[0]));
+    CHECK(IsOpen(kept));
+    CHECK(Collect(events, 0).empty());
+
+    close(kept);
+    close(first[1]);
+    close(second[1]);
+    close(third[1]);
+  }
+}
+
+int main(){
+  TestQueue();
+  TestFiles();
+  TestAllocator();
+  TestLogger();
+  TestEvents<Poll_Events>();
+  TestEvents<Epoll_Events>();
+
+  return TestResult("policies");
+}
@@ -0,0 +1,43 @@
+#include <request_path.h>
+
+#include <string>
+
+#include "check.h"
+
+// NormalizePath on decoded paths, as GET_POST_Header_Handler calls it.
+
+namespace {
+  std::string Normalized(std::string path){
+    return NormalizePath(path) ? path : std::string("<rejected>");
+  }
+}
+
+int main(){
+  CHECK_EQUAL(Normalized("/"),                  "/");
+  CHECK_EQUAL(Normalized("/a.txt"),             "/a.txt");
+  CHECK_EQUAL(Normalized("/sub/"),              "/sub/");
+  CHECK_EQUAL(Normalized("/sub"),               "/sub");
+  CHECK_EQUAL(Normalized("//sub///a.txt"),      "/sub/a.txt");
+  CHECK_EQUAL(Normalized("/./sub/./a.txt"),     "/sub/a.txt");
+  CHECK_EQUAL(Normalized("/sub/."),             "/sub/");
+  CHECK_EQUAL(Normalized("/a/b/../c"),          "/a/c");
+  CHECK_EQUAL(Normalized("/a/b/.."),            "/a/");
+  CHECK_EQUAL(Normalized("/a/.."),              "/");
+  CHECK_EQUAL(Normalized("/a/../../"),          "<rejected>");
+  CHECK_EQUAL(Normalized("/.."),                "<rejected>");
+  CHECK_EQUAL(Normalized("/../etc/passwd"),     "<rejected>");
+
+  // `/%2e%2e/%2e%2e/%2e%2e/etc/` and `/..%2f..%2fetc` after UriDecode
+  CHECK_EQUAL(Normalized("/../../../etc/"),     "<rejected>");
+  CHECK_EQUAL(Normalized("/../../etc"),         "<rejected>");
+  CHECK_EQUAL(Normalized("/sub/../../etc/"),    "<rejected>");
+
+  // names which only look like dot segments stay
+  CHECK_EQUAL(Normalized("/..a/.b/..."),        "/..a/.b/...");
+
+  CHECK_EQUAL(Normalized(""),                   "<rejected>");
+  CHECK_EQUAL(Normalized("a.txt"),              "<rejected>");
+  CHECK_EQUAL(Normalized(std::string("/a\0/../b", 8)), "<rejected>");
+
+  return TestResult("request_path");
+}
@@ -0,0 +1,131 @@
+#include <response_chain.h>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+
+#include "check.h"
+
+// Partial writes of Response_Chain: BYTES, MEMORY and FILE segments are
+// flushed into a socket with a small buffer, the rest is moved out of arena
+// in the middle, as ParkConnection does, and the peer gets every byte once.
+// Read after Skip of the head copies the rest by frame sized parts, as
+// HTTP/2 stream does.
+
+namespace {
+  std::string Pattern(std::size_t size, unsigned seed){
+    std::string result(size, '\0');
+    for (std::size_t i = 0; i < size; ++i){
+      seed = seed * 1103515245 + 12345;
+      result[i] = static_cast<char>(seed >> 16);
+    }
+    return result;
+  }
+
+  int TempFile(const std::string & content){
+    char name[] = "/tmp/response_chain_test_XXXXXX";
+    int  fd     = mkstemp(name);
+    if (fd < 0 || write(fd, content.data(), content.size()) != static_cast<ssize_t>(content.size())){
+      std::perror("Cannot create temporary file ");
+      std::exit(EXIT_FAILURE);
+    }
+    unlink(name);
+    return fd;
+  }
+
+  // a part of what is in socket, so the next flush starts in the middle of a segment
+  void Receive(int fd, std::string & dst, std::size_t most){
+    char buff[1500];
+    while (most){
+      ssize_t rc = recv(fd, buff, std::min(most, sizeof(buff)), MSG_DONTWAIT);
+      if (rc <= 0){
+        return;
+      }
+      dst.append(buff, rc);
+      most -= rc;
+    }
+  }
+}
+
+int main(){
+  const std::string head     = Pattern(10000, 1);
+  const std::string slice    = Pattern(70000, 2);
+  const std::string shared   = Pattern(50000, 3);
+  const std::string body     = Pattern(300000, 4);
+  const std::string tail     = Pattern(3000, 5);
+  const std::string expected = head + slice + shared + body.substr(1000, 250000) + tail;
+
+  int pair[2];
+  CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0);
+  int small = 4096;
+  setsockopt(pair[0], SOL_SOCKET, SO_SNDBUF, &small, sizeof(small));
+  setsockopt(pair[1], SOL_SOCKET, SO_RCVBUF, &small, sizeof(small));
+  fcntl(pair[0], F_SETFL, fcntl(pair[0], F_GETFL) | O_NONBLOCK);
+
+  Request_Arena arena(256 << 10);
+  std::unique_ptr<Response_Chain> chain(new Response_Chain(&arena));
+  chain->Append(head);
+  chain->AddStatic(slice);
+  std::shared_ptr<std::string> owner = std::make_shared<std::string>(shared);
+  chain->AddShared(owner->data(), owner->size(), owner);
+  chain->AddFile(TempFile(body), 1000, 250000);
+  chain->Append(tail);
+  CHECK_EQUAL(chain->Size(), expected.size());
+
+  // the first move happens inside MEMORY segments, the second one inside FILE
+  std::string received;
+  std::size_t moves  = 0;
+  int         rounds = 0;
+  Response_Chain::flush_result result;
+  while ((result = chain->Flush(pair[0], nullptr)) == Response_Chain::FLUSH_AGAIN && ++rounds < 100000){
+    bool is_move = (moves == 0 && received.size() > head.size()) ||
+                   (moves == 1 && received.size() > head.size() + slice.size() + shared.size() + 1000);
+    if (is_move){
+      std::unique_ptr<Response_Chain> moved(new Response_Chain(*chain, std::pmr::new_delete_resource()));
+      chain = std::move(moved);
+      ++moves;
+
+      // arena of worker serves the next request, nothing of the moved chain may stay in it
+      arena.Reset();
+      std::memset(arena.allocate(200 << 10, 1), 0xAB, 200 << 10);
+    }
+    Receive(pair[1], received, 2500 + rounds % 3000);
+  }
+  CHECK(result == Response_Chain::FLUSH_DONE);
+  CHECK_EQUAL(moves, 2u);
+  CHECK_EQUAL(chain->Sent(), expected.size());
+
+  close(pair[0]);
+  char buff[4096];
+  ssize_t rc;
+  while ((rc = recv(pair[1], buff, sizeof(buff), 0)) > 0){
+    received.append(buff, rc);
+  }
+  close(pair[1]);
+
+  CHECK_EQUAL(received.size(), expected.size());
+  CHECK(received == expected);
+
+  std::unique_ptr<Response_Chain> frames(new Response_Chain(&arena));
+  frames->Append(head);
+  frames->AddShared(owner->data(), owner->size(), owner);
+  frames->AddFile(TempFile(body), 1000, 250000);
+  frames->Skip(head.size());
+  CHECK_EQUAL(frames->Size(), shared.size() + 250000);
+
+  std::string read;
+  char        frame[16384];
+  std::size_t part;
+  while ((part = frames->Read(frame, sizeof(frame))) > 0){
+    read.append(frame, part);
+  }
+  CHECK(read == shared + body.substr(1000, 250000));
+  CHECK_EQUAL(frames->Size(), 0u);
+
+  return TestResult("response_chain");
+}
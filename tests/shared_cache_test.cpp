@@ -0,0 +1,116 @@
+#include <shared_cache.h>
+
+#include <string>
+#include <vector>
+#include <cstdlib>
+
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "check.h"
+
+// Full data area of Shared_Cache: the older half is reclaimed with its
+// entries, unless a hit still holds it, and pins of a dead worker process
+// are dropped when its slot is attached again.
+
+namespace {
+  std::string Path(char name, std::size_t i){
+    return std::string("/") + name + static_cast<char>('A' + i);
+  }
+
+  struct stat Stat(std::size_t size, long mtime){
+    struct stat _stat = {};
+    _stat.st_size         = size;
+    _stat.st_mtim.tv_sec  = mtime;
+    return _stat;
+  }
+
+  bool Insert(Shared_Cache & cache, const std::string & path, char fill, shared_cache_hit & hit){
+    std::vector<uint8_t> headers(100, 'H');
+    std::vector<uint8_t> body(8000, fill);
+    return cache.Insert(path, Stat(body.size(), 1), headers, body, hit);
+  }
+
+  bool Lookup(Shared_Cache & cache, const std::string & path){
+    shared_cache_hit hit;
+    return cache.Lookup(path, Stat(8000, 1), hit);
+  }
+
+  bool IsFilled(const shared_cache_hit & hit, char fill){
+    for (std::size_t i = 0; i < hit.body_size; ++i){
+      if (hit.body[i] != static_cast<uint8_t>(fill)) return false;
+    }
+    return hit.body_size == 8000;
+  }
+}
+
+int main(){
+  Shared_Cache cache(80 << 10, 64 << 10, 2);
+  CHECK(cache.IsOpen());
+  cache.Attach(0);
+
+  // entry of 3 bytes path takes 8103 bytes, the first reclaim finds the other half empty
+  std::size_t per_half = cache.DataSize() / 2 / 8103;
+  CHECK(per_half >= 2);
+
+  shared_cache_hit held;
+  CHECK(Insert(cache, Path('a', 0), 'a', held));
+  {
+    shared_cache_hit hit;
+    for (std::size_t i = 1; i < 2 * per_half; ++i){
+      CHECK(Insert(cache, Path('a', i), 'a', hit));
+    }
+  }
+  CHECK_EQUAL(cache.Reclaims(), 1u);
+  CHECK(Lookup(cache, Path('a', 0)));
+  CHECK(Lookup(cache, Path('a', 2 * per_half - 1)));
+
+  // the first half is held by `held`: nothing goes in until it is released
+  shared_cache_hit hit;
+  CHECK(!Insert(cache, Path('b', 0), 'b', hit));
+  CHECK_EQUAL(cache.Reclaims(), 1u);
+  CHECK(IsFilled(held, 'a'));
+
+  held = shared_cache_hit();
+  CHECK(Insert(cache, Path('b', 0), 'b', hit));
+  CHECK_EQUAL(cache.Reclaims(), 2u);
+  CHECK(IsFilled(hit, 'b'));
+  CHECK(!Lookup(cache, Path('a', 0)));
+  CHECK(Lookup(cache, Path('a', 2 * per_half - 1)));
+  CHECK(Lookup(cache, Path('b', 0)));
+  CHECK(cache.Used() <= cache.DataSize());
+  hit = shared_cache_hit();
+
+  // worker process dies holding the current half
+  pid_t pid = fork();
+  if (pid == 0){
+    cache.Attach(1);
+    shared_cache_hit leaked;
+    cache.Lookup(Path('b', 0), Stat(8000, 1), leaked);
+    _exit(EXIT_SUCCESS);
+  }
+  waitpid(pid, nullptr, 0);
+
+  // the rest of the current half and the whole other one
+  for (std::size_t i = 0; i < 2 * per_half - 1; ++i){
+    CHECK(Insert(cache, Path('c', i), 'c', hit));
+  }
+  CHECK_EQUAL(cache.Reclaims(), 3u);
+  hit = shared_cache_hit();
+  CHECK(!Insert(cache, Path('d', 0), 'd', hit));
+
+  // its restarted successor takes the slot
+  pid = fork();
+  if (pid == 0){
+    cache.Attach(1);
+    _exit(EXIT_SUCCESS);
+  }
+  waitpid(pid, nullptr, 0);
+
+  CHECK(Insert(cache, Path('d', 0), 'd', hit));
+  CHECK(IsFilled(hit, 'd'));
+  CHECK(!Lookup(cache, Path('b', 0)));
+  CHECK_EQUAL(cache.Reclaims(), 4u);
+
+  return TestResult("shared_cache");
+}
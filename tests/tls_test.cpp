@@ -0,0 +1,248 @@
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+#include <openssl/rsa.h>
+
+#include "check.h"
+
+// HTTPS listener of HTTP_SERV with a throwaway certificate: handshake is
+// completed by the event loop, the second connection resumes the session of
+// the first one, and clients which leave in the middle of handshake are not
+// reported as TLS errors.
+
+namespace {
+  std::uint16_t FreePort(){
+    int         fd   = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    socklen_t   len  = sizeof(addr);
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+    getsockname(fd, reinterpret_cast<sockaddr *>(&addr), &len);
+    close(fd);
+    return ntohs(addr.sin_port);
+  }
+
+  int Connect(std::uint16_t port){
+    int         fd   = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0){
+      close(fd);
+      return -1;
+    }
+    return fd;
+  }
+
+  // self signed certificate for 127.0.0.1, key and certificate are written as PEM
+  bool WriteCertificate(const std::string & certificate_path, const std::string & key_path){
+    EVP_PKEY *     key = nullptr;
+    EVP_PKEY_CTX * ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, nullptr);
+    if (!ctx || EVP_PKEY_keygen_init(ctx) <= 0 || EVP_PKEY_CTX_set_rsa_keygen_bits(ctx, 2048) <= 0 || EVP_PKEY_keygen(ctx, &key) <= 0){
+      EVP_PKEY_CTX_free(ctx);
+      return false;
+    }
+    EVP_PKEY_CTX_free(ctx);
+
+    X509 * cert = X509_new();
+    X509_set_version(cert, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 24 * 60 * 60);
+    X509_set_pubkey(cert, key);
+
+    X509_NAME * name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char *>("127.0.0.1"), -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+
+    bool is_written = X509_sign(cert, key, EVP_sha256()) > 0;
+
+    FILE * cert_file = std::fopen(certificate_path.c_str(), "w");
+    FILE * key_file  = std::fopen(key_path.c_str(), "w");
+    is_written = is_written && cert_file && key_file &&
+                 PEM_write_X509(cert_file, cert) == 1 &&
+                 PEM_write_PrivateKey(key_file, key, nullptr, nullptr, 0, nullptr, nullptr) == 1;
+    if (cert_file) std::fclose(cert_file);
+    if (key_file)  std::fclose(key_file);
+
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    return is_written;
+  }
+
+  // GET over a new TLS connection, `session` is offered for resumption and is
+  // replaced by the session of this connection
+  std::string Get(SSL_CTX * ctx, std::uint16_t port, SSL_SESSION *& session, bool & is_reused){
+    is_reused = false;
+    int fd = Connect(port);
+    if (fd < 0){
+      return std::string();
+    }
+
+    SSL * ssl = SSL_new(ctx);
+    SSL_set_fd(ssl, fd);
+    if (session){
+      SSL_set_session(ssl, session);
+    }
+
+    std::string respond;
+    if (SSL_connect(ssl) == 1){
+      is_reused = SSL_session_reused(ssl);
+
+      std::string request = "GET /a.txt HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+      SSL_write(ssl, request.data(), request.size());
+
+      // TLS 1.3 tickets come after handshake, so session is taken once respond is read
+      char buff[4096];
+      int  rc;
+      while ((rc = SSL_read(ssl, buff, sizeof(buff))) > 0){
+        respond.append(buff, rc);
+      }
+
+      if (session){
+        SSL_SESSION_free(session);
+      }
+      session = SSL_get1_session(ssl);
+
+      // session freed without shutdown is dropped from resumption
+      SSL_shutdown(ssl);
+    }
+
+    SSL_free(ssl);
+    close(fd);
+    return respond;
+  }
+
+  std::string ReadFile(const std::string & path){
+    std::ifstream     file(path);
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+  }
+}
+
+int main(int argc, char * argv[]){
+  if (argc < 2){
+    std::cerr << "\tUsage: " << argv[0] << " <HTTP_SERV binary>\n";
+    return EXIT_FAILURE;
+  }
+
+  char root[] = "/tmp/tls_test_XXXXXX";
+  if (!mkdtemp(root)){
+    std::perror("Cannot create root directory ");
+    return EXIT_FAILURE;
+  }
+  std::string   root_path = root;
+  std::string   log_path  = root_path + "/out.log";
+  std::uint16_t port      = FreePort();
+  std::uint16_t tls_port  = FreePort();
+
+  CHECK(WriteCertificate(root_path + "/cert.pem", root_path + "/key.pem"));
+
+  mkdir((root_path + "/www").c_str(), 0755);
+  std::ofstream(root_path + "/www/a.txt") << "tls body";
+  std::ofstream(root_path + "/conf.xml")
+    << "<?xml version=\"1.0\"?>\n<configuration>\n"
+    << "  <IP-address>127.0.0.1</IP-address>\n"
+    << "  <TCP-port>" << port << "</TCP-port>\n"
+    << "  <number-workers>1</number-workers>\n"
+    << "  <root-path>" << root_path << "/www/</root-path>\n"
+    << "  <TLS-port>" << tls_port << "</TLS-port>\n"
+    << "  <TLS-certificate>" << root_path << "/cert.pem</TLS-certificate>\n"
+    << "  <TLS-private-key>" << root_path << "/key.pem</TLS-private-key>\n"
+    << "  <TLS-kernel-offload>off</TLS-kernel-offload>\n"
+    << "</configuration>\n";
+
+  pid_t pid = fork();
+  if (pid == 0){
+    int null_fd = open("/dev/null", O_RDWR);
+    int log_fd  = open(log_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    dup2(null_fd, STDIN_FILENO);
+    dup2(log_fd, STDOUT_FILENO);
+    dup2(log_fd, STDERR_FILENO);
+    execl(argv[1], argv[1], (root_path + "/conf.xml").c_str(), static_cast<char *>(nullptr));
+    _exit(127);
+  }
+
+  bool is_listening = false;
+  for (int i = 0; i < 500 && !is_listening; ++i){
+    int fd = Connect(tls_port);
+    is_listening = fd >= 0;
+    if (fd >= 0) close(fd);
+    else std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  CHECK(is_listening);
+
+  if (is_listening){
+    SSL_CTX * ctx = SSL_CTX_new(TLS_client_method());
+    SSL_CTX_set_verify(ctx, SSL_VERIFY_NONE, nullptr);
+
+    // clients which go away before and in the middle of handshake
+    for (int i = 0; i < 3; ++i){
+      int fd = Connect(tls_port);
+      if (i > 0){
+        const char hello[] = "\x16\x03\x01\x00\xff\x01\x00\x00\xfb\x03\x03";
+        send(fd, hello, sizeof(hello) - 1, MSG_NOSIGNAL);
+      }
+      if (i > 1){
+        linger reset = {1, 0};
+        setsockopt(fd, SOL_SOCKET, SO_LINGER, &reset, sizeof(reset));
+      }
+      close(fd);
+    }
+
+    SSL_SESSION * session = nullptr;
+    bool          is_reused;
+
+    std::string respond = Get(ctx, tls_port, session, is_reused);
+    CHECK(respond.compare(0, 15, "HTTP/1.1 200 OK") == 0);
+    CHECK(respond.find("tls body") != std::string::npos);
+    CHECK(!is_reused);
+    CHECK(session != nullptr);
+
+    respond = Get(ctx, tls_port, session, is_reused);
+    CHECK(respond.find("tls body") != std::string::npos);
+    CHECK(is_reused);
+
+    if (session){
+      SSL_SESSION_free(session);
+    }
+    SSL_CTX_free(ctx);
+  }
+
+  kill(pid, SIGKILL);
+  waitpid(pid, nullptr, 0);
+
+  CHECK(ReadFile(log_path).find("Error!!! TLS") == std::string::npos);
+
+  unlink(log_path.c_str());
+  unlink((root_path + "/conf.xml").c_str());
+  unlink((root_path + "/cert.pem").c_str());
+  unlink((root_path + "/key.pem").c_str());
+  unlink((root_path + "/www/a.txt").c_str());
+  rmdir((root_path + "/www").c_str());
+  rmdir(root_path.c_str());
+
+  return TestResult("tls");
+}
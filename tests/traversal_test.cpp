@@ -0,0 +1,147 @@
+#include <string>
+#include <fstream>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "check.h"
+
+// Requests which climb above root-path, sent to HTTP_SERV with autoindex
+// on: neither a file nor a listing outside of root may be answered.
+
+namespace {
+  // port which is free at the moment, server binds it a bit later
+  std::uint16_t FreePort(){
+    int         fd   = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    socklen_t   len  = sizeof(addr);
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+    getsockname(fd, reinterpret_cast<sockaddr *>(&addr), &len);
+    close(fd);
+    return ntohs(addr.sin_port);
+  }
+
+  int Connect(std::uint16_t port){
+    int         fd   = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0){
+      close(fd);
+      return -1;
+    }
+    return fd;
+  }
+
+  // server closes connection after respond
+  std::string Get(std::uint16_t port, const std::string & target){
+    int fd = Connect(port);
+    if (fd < 0){
+      return std::string();
+    }
+    std::string request = "GET " + target + " HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+    if (send(fd, request.data(), request.size(), MSG_NOSIGNAL) < 0){
+      close(fd);
+      return std::string();
+    }
+
+    std::string respond;
+    char        buff[4096];
+    ssize_t     rc;
+    while ((rc = recv(fd, buff, sizeof(buff), 0)) > 0){
+      respond.append(buff, rc);
+    }
+    close(fd);
+    return respond;
+  }
+
+  int Status(const std::string & respond){
+    return respond.size() > 12 ? std::atoi(respond.c_str() + 9) : 0;
+  }
+}
+
+int main(int argc, char * argv[]){
+  if (argc < 2){
+    std::cerr << "\tUsage: " << argv[0] << " <HTTP_SERV binary>\n";
+    return EXIT_FAILURE;
+  }
+
+  char root[] = "/tmp/traversal_test_XXXXXX";
+  if (!mkdtemp(root)){
+    std::perror("Cannot create root directory ");
+    return EXIT_FAILURE;
+  }
+  std::string   root_path = root;
+  std::uint16_t port      = FreePort();
+
+  mkdir((root_path + "/www").c_str(), 0755);
+  mkdir((root_path + "/www/sub").c_str(), 0755);
+  std::ofstream(root_path + "/www/a.txt") << "inside";
+  std::ofstream(root_path + "/secret.txt") << "outside";
+  std::ofstream(root_path + "/conf.xml")
+    << "<?xml version=\"1.0\"?>\n<configuration>\n"
+    << "  <IP-address>127.0.0.1</IP-address>\n"
+    << "  <TCP-port>" << port << "</TCP-port>\n"
+    << "  <number-workers>2</number-workers>\n"
+    << "  <root-path>" << root_path << "/www/</root-path>\n"
+    << "  <autoindex>on</autoindex>\n"
+    << "</configuration>\n";
+
+  pid_t pid = fork();
+  if (pid == 0){
+    int null_fd = open("/dev/null", O_RDWR);
+    dup2(null_fd, STDIN_FILENO);
+    dup2(null_fd, STDOUT_FILENO);
+    dup2(null_fd, STDERR_FILENO);
+    execl(argv[1], argv[1], (root_path + "/conf.xml").c_str(), static_cast<char *>(nullptr));
+    _exit(127);
+  }
+
+  bool is_listening = false;
+  for (int i = 0; i < 500 && !is_listening; ++i){
+    int fd = Connect(port);
+    is_listening = fd >= 0;
+    if (fd >= 0) close(fd);
+    else std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  CHECK(is_listening);
+
+  if (is_listening){
+    CHECK_EQUAL(Status(Get(port, "/%2e%2e/%2e%2e/%2e%2e/etc/?format=json")), 403);
+    CHECK_EQUAL(Status(Get(port, "/%2e%2e/secret.txt")), 403);
+    CHECK_EQUAL(Status(Get(port, "/..%2fsecret.txt")), 403);
+    CHECK_EQUAL(Status(Get(port, "/../secret.txt")), 403);
+    CHECK_EQUAL(Status(Get(port, "/sub/%2e%2e/%2e%2e/")), 403);
+
+    // dot segments which stay inside root are resolved
+    std::string respond = Get(port, "/sub/%2e%2e/a.txt");
+    CHECK_EQUAL(Status(respond), 200);
+    CHECK(respond.find("inside") != std::string::npos);
+    CHECK_EQUAL(Status(Get(port, "/sub/./?format=json")), 200);
+  }
+
+  kill(pid, SIGKILL);
+  waitpid(pid, nullptr, 0);
+
+  unlink((root_path + "/conf.xml").c_str());
+  unlink((root_path + "/secret.txt").c_str());
+  unlink((root_path + "/www/a.txt").c_str());
+  rmdir((root_path + "/www/sub").c_str());
+  rmdir((root_path + "/www").c_str());
+  rmdir(root_path.c_str());
+
+  return TestResult("traversal");
+}